@@ -1,55 +1,148 @@
-import { DirEntry, FileStat, FilesystemProvider, Flock, Statfs } from "@mount0/core";
+import { DirEntry, FileStat, FilesystemProvider, Flock, InodeTable, ProviderCapabilities, Statfs } from "@mount0/core";
 
 export interface BaseCacheConfig {
   master: FilesystemProvider;
   slave: FilesystemProvider;
 }
 
+// An open directory: each side is listed through its own handle, and a listing stays
+// on the side its first page came from
+interface CacheDir {
+  flags: number;
+  master?: number;
+  slave?: number;
+  side?: "master" | "slave";
+}
+
+interface CacheInode {
+  master?: number;
+  slave?: number;
+  // Where a file only the slave has reported was seen, to find it on the master later
+  parent?: number;
+  name?: string;
+  // Lookup references taken on each side, which forget hands back
+  masterLookups: number;
+  slaveLookups: number;
+}
+
 export abstract class BaseCacheProvider implements FilesystemProvider {
   protected master: FilesystemProvider;
   protected slave: FilesystemProvider;
-  private inoToMasterIno: Map<number, number> = new Map();
-  private inoToSlaveIno: Map<number, number> = new Map();
-  private masterInoToIno: Map<number, number> = new Map();
-  private slaveInoToIno: Map<number, number> = new Map();
-  private nextIno: number = 2;
+  private inodes = new InodeTable<CacheInode>({ master: 1, slave: 1, masterLookups: 0, slaveLookups: 0 });
+  private dirs = new Map<number, CacheDir>();
+  // Files only the slave has reported, by unresolvedKey(parent, name)
+  private unresolved = new Map<string, number>();
+  private nextDirFh = 1;
 
   constructor(config: BaseCacheConfig) {
     this.master = config.master;
     this.slave = config.slave;
   }
 
-  protected getMasterIno(ino: number): number {
-    return this.inoToMasterIno.get(ino) || ino;
+  // The master's ino for a file. One only the slave has reported so far is looked up
+  // on the master by the name it was seen under; the slave's ino means nothing there.
+  protected async getMasterIno(ino: number): Promise<number> {
+    const inode = this.inodes.get(ino);
+    if (inode?.master !== undefined) return inode.master;
+    if (inode?.parent !== undefined && inode.name !== undefined) {
+      const stat = await this.master.lookup(await this.getMasterIno(inode.parent), inode.name);
+      if (stat) {
+        this.unresolved.delete(unresolvedKey(inode.parent, inode.name));
+        inode.master = stat.ino;
+        inode.masterLookups++;
+        inode.parent = inode.name = undefined;
+        return stat.ino;
+      }
+    }
+    throw { code: "ENOENT", errno: -2 };
   }
 
-  protected getSlaveIno(ino: number): number {
-    return this.inoToSlaveIno.get(ino) || ino;
+  // The slave's ino for a file, if the slave holds it
+  protected findSlaveIno(ino: number): number | undefined {
+    return this.inodes.get(ino)?.slave;
   }
 
-  private setInoMapping(ino: number, masterIno: number, slaveIno?: number): void {
-    this.inoToMasterIno.set(ino, masterIno);
-    this.masterInoToIno.set(masterIno, ino);
-    if (slaveIno !== undefined) {
-      this.inoToSlaveIno.set(ino, slaveIno);
-      this.slaveInoToIno.set(slaveIno, ino);
-    }
+  // The slave's ino for a file, or ENOENT when the slave doesn't hold it
+  protected getSlaveIno(ino: number): number {
+    const slave = this.findSlaveIno(ino);
+    if (slave === undefined) throw { code: "ENOENT", errno: -2 };
+    return slave;
+  }
+
+  // Remembers where a file only the slave has reported lives
+  private seen(ino: number, parent: number, name: string): number {
+    const inode = this.inodes.get(ino);
+    if (inode && inode.master === undefined && name !== "." && name !== "..") {
+      inode.parent = parent;
+      inode.name = name;
+      this.unresolved.set(unresolvedKey(parent, name), ino);
+    }
+    return ino;
+  }
+
+  // Follows a rename or removal of a name seen only on the slave
+  private moved(parent: number, name: string, newparent?: number, newname?: string): void {
+    const key = unresolvedKey(parent, name);
+    const ino = this.unresolved.get(key);
+    if (ino === undefined) return;
+    this.unresolved.delete(key);
+    const inode = this.inodes.get(ino);
+    if (!inode) return;
+    inode.parent = newparent;
+    inode.name = newname;
+    if (newparent !== undefined && newname !== undefined) this.unresolved.set(unresolvedKey(newparent, newname), ino);
+  }
+
+  // Lookups, listings and creates key a file the same way: by the negated slave ino
+  // when the slave holds it, else by its master ino, so one name gets one ino and
+  // the two namespaces cannot collide. lookups says which sides took a reference.
+  private inode(masterIno: number | undefined, slaveIno: number | undefined, lookups: boolean): { key: number; backing: CacheInode } {
+    const key = slaveIno !== undefined ? -slaveIno : masterIno!;
+    const known = this.inodes.get(this.inodes.peek(key) ?? 0);
+    return {
+      key,
+      backing: {
+        master: masterIno ?? known?.master,
+        slave: slaveIno ?? known?.slave,
+        masterLookups: (known?.masterLookups ?? 0) + (lookups && masterIno !== undefined ? 1 : 0),
+        slaveLookups: (known?.slaveLookups ?? 0) + (lookups && slaveIno !== undefined ? 1 : 0),
+      },
+    };
+  }
+
+  private acquireIno(masterIno: number | undefined, slaveIno?: number): number {
+    const { key, backing } = this.inode(masterIno, slaveIno, true);
+    return this.inodes.acquire(key, backing);
+  }
+
+  // readdirplus entries take a lookup reference only when they carry attributes; the
+  // others reach the kernel without a node, exactly like a plain readdir
+  private listedIno(entry: DirEntry, masterIno: number | undefined, slaveIno: number | undefined, plus: boolean): number {
+    const counted = plus && !!entry.stat && entry.name !== "." && entry.name !== "..";
+    const { key, backing } = this.inode(masterIno, slaveIno, counted);
+    return counted ? this.inodes.acquire(key, backing) : this.inodes.assign(key, backing);
+  }
+
+  // Optional ops go to the master; readdirplus lists whichever side holds the directory, so both must support it
+  capabilities(): ProviderCapabilities | undefined {
+    const master = this.master.capabilities?.();
+    const slave = this.slave.capabilities?.();
+    return master && { ...master, readdirplus: !!(master.readdirplus && slave?.readdirplus) };
   }
 
   async lookup(parent: number, name: string): Promise<FileStat | null> {
-    const masterParent = this.getMasterIno(parent);
-    const slaveParent = this.getSlaveIno(parent);
-    const slaveStat = await this.slave.lookup(slaveParent, name);
+    const slaveParent = this.findSlaveIno(parent);
+    const slaveStat = slaveParent !== undefined ? await this.slave.lookup(slaveParent, name) : null;
+    const masterParent = await this.getMasterIno(parent).catch(() => undefined);
     if (slaveStat) {
-      const ino = this.nextIno++;
-      const masterStat = await this.master.lookup(masterParent, name);
-      this.setInoMapping(ino, masterStat?.ino || slaveStat.ino, slaveStat.ino);
-      return { ...slaveStat, ino };
+      const masterStat = masterParent !== undefined ? await this.master.lookup(masterParent, name) : null;
+      const ino = this.acquireIno(masterStat?.ino, slaveStat.ino);
+      return { ...slaveStat, ino: masterStat ? ino : this.seen(ino, parent, name) };
     }
+    if (masterParent === undefined) return null;
     const masterStat = await this.master.lookup(masterParent, name);
     if (masterStat) {
-      const ino = this.nextIno++;
-      this.setInoMapping(ino, masterStat.ino);
+      const ino = this.acquireIno(masterStat.ino);
       return { ...masterStat, ino };
     }
     return null;
@@ -60,175 +153,196 @@ export abstract class BaseCacheProvider implements FilesystemProvider {
       const stat = await this.slave.getattr(1, fh);
       return stat || this.master.getattr(1, fh);
     }
-    const slaveIno = this.getSlaveIno(ino);
-    const stat = await this.slave.getattr(slaveIno, fh);
+    const slaveIno = this.findSlaveIno(ino);
+    const stat = slaveIno !== undefined ? await this.slave.getattr(slaveIno, fh) : null;
     if (stat) {
-      this.setInoMapping(ino, this.getMasterIno(ino), stat.ino);
       return { ...stat, ino };
     }
-    const masterIno = this.getMasterIno(ino);
+    const masterIno = await this.getMasterIno(ino);
     const masterStat = await this.master.getattr(masterIno, fh);
     if (masterStat) {
-      this.setInoMapping(ino, masterStat.ino);
       return { ...masterStat, ino };
     }
     return null;
   }
 
-  async setattr(ino: number, fh: number, to_set: number, attr: FileStat): Promise<void> {
-    const masterIno = this.getMasterIno(ino);
-    await this.master.setattr(masterIno, fh, to_set, attr);
-    const slaveIno = this.getSlaveIno(ino);
+  async setattr(ino: number, fh: number, to_set: number, attr: FileStat): Promise<FileStat | null> {
+    const masterIno = await this.getMasterIno(ino);
+    const stat = await this.master.setattr(masterIno, fh, to_set, attr);
     try {
+      const slaveIno = this.getSlaveIno(ino);
       await this.slave.setattr(slaveIno, fh, to_set, attr);
     } catch {
       // Ignore slave errors
     }
+    return stat ? { ...stat, ino } : null;
   }
 
   async readdir(ino: number, fh: number, size: number, offset: number): Promise<DirEntry[]> {
-    const slaveIno = this.getSlaveIno(ino);
-    const entries = await this.slave.readdir(slaveIno, fh, size, offset);
-    if (entries.length > 0) {
-      return entries.map((entry) => {
-        const ino = this.nextIno++;
-        this.setInoMapping(ino, entry.ino, entry.ino);
-        return { ...entry, ino };
-      });
-    }
-    const masterIno = this.getMasterIno(ino);
-    const masterEntries = await this.master.readdir(masterIno, fh, size, offset);
-    return masterEntries.map((entry) => {
-      const ino = this.nextIno++;
-      this.setInoMapping(ino, entry.ino);
-      return { ...entry, ino };
-    });
+    return this.list(ino, fh, size, offset, false);
   }
 
+  // Lists the slave's copy of the directory, or the master's when the slave's is empty
+  private async list(ino: number, fh: number, size: number, offset: number, plus: boolean): Promise<DirEntry[]> {
+    const dir = this.dirs.get(fh) ?? { flags: 0, master: fh, slave: fh };
+    if (offset === 0) dir.side = undefined;
+    if (dir.side !== "master" && dir.slave !== undefined) {
+      const slaveIno = this.getSlaveIno(ino);
+      const entries = plus ? await this.slave.readdirplus(slaveIno, dir.slave, size, offset) : await this.slave.readdir(slaveIno, dir.slave, size, offset);
+      if (entries.length > 0 || dir.side === "slave") {
+        dir.side = "slave";
+        return entries.map((entry) => this.listed(entry, this.seen(this.listedIno(entry, undefined, entry.ino, plus), ino, entry.name)));
+      }
+    }
+    const masterIno = await this.getMasterIno(ino);
+    dir.master ??= await this.master.opendir(masterIno, dir.flags);
+    dir.side = "master";
+    const masterEntries = plus ? await this.master.readdirplus(masterIno, dir.master, size, offset) : await this.master.readdir(masterIno, dir.master, size, offset);
+    return masterEntries.map((entry) => this.listed(entry, this.listedIno(entry, entry.ino, undefined, plus)));
+  }
+
+  // A listed entry renumbered into this provider's inodes
+  private listed(entry: DirEntry, ino: number): DirEntry {
+    return entry.stat ? { ...entry, ino, stat: { ...entry.stat, ino } } : { ...entry, ino };
+  }
+
+  // The master is only opened once a listing falls back to it
   async opendir(ino: number, flags: number): Promise<number> {
-    const slaveIno = this.getSlaveIno(ino);
+    const dir: CacheDir = { flags };
     try {
-      return await this.slave.opendir(slaveIno, flags);
+      dir.slave = await this.slave.opendir(this.getSlaveIno(ino), flags);
     } catch {
-      const masterIno = this.getMasterIno(ino);
-      return await this.master.opendir(masterIno, flags);
+      dir.master = await this.master.opendir(await this.getMasterIno(ino), flags);
     }
+    const fh = this.nextDirFh++;
+    this.dirs.set(fh, dir);
+    return fh;
   }
 
   async releasedir(ino: number, fh: number): Promise<void> {
-    const slaveIno = this.getSlaveIno(ino);
-    try {
-      await this.slave.releasedir(slaveIno, fh);
-    } catch {
-      // Ignore
+    const dir = this.dirs.get(fh);
+    this.dirs.delete(fh);
+    if (dir?.slave !== undefined) {
+      try {
+        await this.slave.releasedir(this.getSlaveIno(ino), dir.slave);
+      } catch {
+        // Ignore
+      }
     }
-    const masterIno = this.getMasterIno(ino);
-    try {
-      await this.master.releasedir(masterIno, fh);
-    } catch {
-      // Ignore
+    if (dir?.master !== undefined) {
+      try {
+        await this.master.releasedir(await this.getMasterIno(ino), dir.master);
+      } catch {
+        // Ignore
+      }
     }
   }
 
   async fsyncdir(ino: number, fh: number, datasync: number): Promise<void> {
-    const masterIno = this.getMasterIno(ino);
-    await this.master.fsyncdir(masterIno, fh, datasync);
-    const slaveIno = this.getSlaveIno(ino);
-    try {
-      await this.slave.fsyncdir(slaveIno, fh, datasync);
-    } catch {
-      // Ignore
+    const dir = this.dirs.get(fh);
+    if (dir?.master !== undefined) await this.master.fsyncdir(await this.getMasterIno(ino), dir.master, datasync);
+    if (dir?.slave !== undefined) {
+      try {
+        await this.slave.fsyncdir(this.getSlaveIno(ino), dir.slave, datasync);
+      } catch {
+        // Ignore
+      }
     }
   }
 
   async open(ino: number, flags: number, mode?: number): Promise<number> {
-    const slaveIno = this.getSlaveIno(ino);
     try {
+      const slaveIno = this.getSlaveIno(ino);
       return await this.slave.open(slaveIno, flags, mode);
     } catch {
-      const masterIno = this.getMasterIno(ino);
+      const masterIno = await this.getMasterIno(ino);
       return await this.master.open(masterIno, flags, mode);
     }
   }
 
   async read(ino: number, fh: number, buffer: Buffer, offset: number, length: number): Promise<number> {
-    const slaveIno = this.getSlaveIno(ino);
     try {
+      const slaveIno = this.getSlaveIno(ino);
       return await this.slave.read(slaveIno, fh, buffer, offset, length);
     } catch {
-      const masterIno = this.getMasterIno(ino);
+      const masterIno = await this.getMasterIno(ino);
       return await this.master.read(masterIno, fh, buffer, offset, length);
     }
   }
 
   async create(parent: number, name: string, mode: number, flags: number): Promise<{ stat: FileStat; fh: number }> {
-    const masterParent = this.getMasterIno(parent);
+    const masterParent = await this.getMasterIno(parent);
     const masterResult = await this.master.create(masterParent, name, mode, flags);
-    const ino = this.nextIno++;
-    this.setInoMapping(ino, masterResult.stat.ino);
+    let slaveIno: number | undefined;
     try {
       const slaveParent = this.getSlaveIno(parent);
-      const slaveResult = await this.slave.create(slaveParent, name, mode, flags);
-      this.setInoMapping(ino, masterResult.stat.ino, slaveResult.stat.ino);
+      slaveIno = (await this.slave.create(slaveParent, name, mode, flags)).stat.ino;
     } catch {
       // Ignore slave errors
     }
+    const ino = this.acquireIno(masterResult.stat.ino, slaveIno);
     return { stat: { ...masterResult.stat, ino }, fh: masterResult.fh };
   }
 
   async mknod(parent: number, name: string, mode: number, rdev: number): Promise<FileStat> {
-    const masterParent = this.getMasterIno(parent);
+    const masterParent = await this.getMasterIno(parent);
     const stat = await this.master.mknod(masterParent, name, mode, rdev);
-    const ino = this.nextIno++;
-    this.setInoMapping(ino, stat.ino);
+    let slaveIno: number | undefined;
     try {
       const slaveParent = this.getSlaveIno(parent);
-      await this.slave.mknod(slaveParent, name, mode, rdev);
+      slaveIno = (await this.slave.mknod(slaveParent, name, mode, rdev)).ino;
     } catch {
       // Ignore slave errors
     }
+    const ino = this.acquireIno(stat.ino, slaveIno);
     return { ...stat, ino };
   }
 
   async mkdir(parent: number, name: string, mode: number): Promise<FileStat> {
-    const masterParent = this.getMasterIno(parent);
+    const masterParent = await this.getMasterIno(parent);
     const stat = await this.master.mkdir(masterParent, name, mode);
-    const ino = this.nextIno++;
-    this.setInoMapping(ino, stat.ino);
+    let slaveIno: number | undefined;
     try {
       const slaveParent = this.getSlaveIno(parent);
-      await this.slave.mkdir(slaveParent, name, mode);
+      slaveIno = (await this.slave.mkdir(slaveParent, name, mode)).ino;
     } catch {
       // Ignore slave errors
     }
+    const ino = this.acquireIno(stat.ino, slaveIno);
     return { ...stat, ino };
   }
 
-  async unlink(parent: number, name: string): Promise<void> {
-    const masterParent = this.getMasterIno(parent);
-    await this.master.unlink(masterParent, name);
+  async unlink(parent: number, name: string): Promise<number | undefined> {
+    const masterParent = await this.getMasterIno(parent);
+    const removed = await this.master.unlink(masterParent, name);
+    let slaveRemoved: number | undefined;
     try {
       const slaveParent = this.getSlaveIno(parent);
-      await this.slave.unlink(slaveParent, name);
+      slaveRemoved = await this.slave.unlink(slaveParent, name);
     } catch {
       // Ignore slave errors
     }
+    this.moved(parent, name);
+    return (slaveRemoved ? this.inodes.peek(-slaveRemoved) : undefined) ?? (removed ? this.inodes.peek(removed) : undefined);
   }
 
-  async rmdir(parent: number, name: string): Promise<void> {
-    const masterParent = this.getMasterIno(parent);
-    await this.master.rmdir(masterParent, name);
+  async rmdir(parent: number, name: string): Promise<number | undefined> {
+    const masterParent = await this.getMasterIno(parent);
+    const removed = await this.master.rmdir(masterParent, name);
+    let slaveRemoved: number | undefined;
     try {
       const slaveParent = this.getSlaveIno(parent);
-      await this.slave.rmdir(slaveParent, name);
+      slaveRemoved = await this.slave.rmdir(slaveParent, name);
     } catch {
       // Ignore slave errors
     }
+    this.moved(parent, name);
+    return (slaveRemoved ? this.inodes.peek(-slaveRemoved) : undefined) ?? (removed ? this.inodes.peek(removed) : undefined);
   }
 
   async rename(parent: number, name: string, newparent: number, newname: string, flags: number): Promise<void> {
-    const masterParent = this.getMasterIno(parent);
-    const masterNewParent = this.getMasterIno(newparent);
+    const masterParent = await this.getMasterIno(parent);
+    const masterNewParent = await this.getMasterIno(newparent);
     await this.master.rename(masterParent, name, masterNewParent, newname, flags);
     try {
       const slaveParent = this.getSlaveIno(parent);
@@ -237,46 +351,53 @@ export abstract class BaseCacheProvider implements FilesystemProvider {
     } catch {
       // Ignore slave errors
     }
+    if (flags & RENAME_EXCHANGE) {
+      const other = this.unresolved.get(unresolvedKey(newparent, newname));
+      this.moved(parent, name, newparent, newname);
+      if (other !== undefined) this.seen(other, parent, name);
+    } else {
+      this.moved(newparent, newname);
+      this.moved(parent, name, newparent, newname);
+    }
   }
 
   async link(ino: number, newparent: number, newname: string): Promise<FileStat> {
-    const masterIno = this.getMasterIno(ino);
-    const masterNewParent = this.getMasterIno(newparent);
+    const masterIno = await this.getMasterIno(ino);
+    const masterNewParent = await this.getMasterIno(newparent);
     const stat = await this.master.link(masterIno, masterNewParent, newname);
-    const newIno = this.nextIno++;
-    this.setInoMapping(newIno, stat.ino);
+    const newIno = this.acquireIno(stat.ino);
     return { ...stat, ino: newIno };
   }
 
   async symlink(link: string, parent: number, name: string): Promise<FileStat> {
-    const masterParent = this.getMasterIno(parent);
+    const masterParent = await this.getMasterIno(parent);
     const stat = await this.master.symlink(link, masterParent, name);
-    const ino = this.nextIno++;
-    this.setInoMapping(ino, stat.ino);
+    let slaveIno: number | undefined;
     try {
       const slaveParent = this.getSlaveIno(parent);
-      await this.slave.symlink(link, slaveParent, name);
+      slaveIno = (await this.slave.symlink(link, slaveParent, name)).ino;
     } catch {
       // Ignore slave errors
     }
+    const ino = this.acquireIno(stat.ino, slaveIno);
     return { ...stat, ino };
   }
 
   async readlink(ino: number): Promise<string> {
-    const slaveIno = this.getSlaveIno(ino);
     try {
+      const slaveIno = this.getSlaveIno(ino);
       return await this.slave.readlink(slaveIno);
     } catch {
-      const masterIno = this.getMasterIno(ino);
+      const masterIno = await this.getMasterIno(ino);
       return await this.master.readlink(masterIno);
     }
   }
 
   async setxattr(ino: number, name: string, value: Buffer, size: number, flags: number): Promise<void> {
-    const masterIno = this.getMasterIno(ino);
+    const masterIno = await this.getMasterIno(ino);
     await this.master.setxattr(masterIno, name, value, size, flags);
-    const slaveIno = this.getSlaveIno(ino);
     try {
+      const slaveIno = this.getSlaveIno(ino);
       await this.slave.setxattr(slaveIno, name, value, size, flags);
     } catch {
       // Ignore
@@ -284,30 +405,30 @@ export abstract class BaseCacheProvider implements FilesystemProvider {
   }
 
   async getxattr(ino: number, name: string, size: number): Promise<Buffer | number> {
-    const slaveIno = this.getSlaveIno(ino);
     try {
+      const slaveIno = this.getSlaveIno(ino);
       return await this.slave.getxattr(slaveIno, name, size);
     } catch {
-      const masterIno = this.getMasterIno(ino);
+      const masterIno = await this.getMasterIno(ino);
       return await this.master.getxattr(masterIno, name, size);
     }
   }
 
   async listxattr(ino: number, size: number): Promise<Buffer | number> {
-    const slaveIno = this.getSlaveIno(ino);
     try {
+      const slaveIno = this.getSlaveIno(ino);
       return await this.slave.listxattr(slaveIno, size);
     } catch {
-      const masterIno = this.getMasterIno(ino);
+      const masterIno = await this.getMasterIno(ino);
       return await this.master.listxattr(masterIno, size);
     }
   }
 
   async removexattr(ino: number, name: string): Promise<void> {
-    const masterIno = this.getMasterIno(ino);
+    const masterIno = await this.getMasterIno(ino);
     await this.master.removexattr(masterIno, name);
-    const slaveIno = this.getSlaveIno(ino);
     try {
+      const slaveIno = this.getSlaveIno(ino);
       await this.slave.removexattr(slaveIno, name);
     } catch {
       // Ignore
@@ -315,56 +436,56 @@ export abstract class BaseCacheProvider implements FilesystemProvider {
   }
 
   async access(ino: number, mask: number): Promise<void> {
-    const slaveIno = this.getSlaveIno(ino);
     try {
+      const slaveIno = this.getSlaveIno(ino);
       await this.slave.access(slaveIno, mask);
       return;
     } catch {
-      const masterIno = this.getMasterIno(ino);
+      const masterIno = await this.getMasterIno(ino);
       await this.master.access(masterIno, mask);
     }
   }
 
   async statfs(ino: number, fh: number): Promise<Statfs> {
-    const masterIno = this.getMasterIno(ino);
+    const masterIno = await this.getMasterIno(ino);
     return this.master.statfs(masterIno, fh);
   }
 
   async getlk(ino: number, fh: number, lock: Flock): Promise<Flock> {
-    const masterIno = this.getMasterIno(ino);
+    const masterIno = await this.getMasterIno(ino);
     return this.master.getlk(masterIno, fh, lock);
   }
 
   async setlk(ino: number, fh: number, lock: Flock, sleep: number): Promise<void> {
-    const masterIno = this.getMasterIno(ino);
+    const masterIno = await this.getMasterIno(ino);
     return this.master.setlk(masterIno, fh, lock, sleep);
   }
 
   async flock(ino: number, fh: number, op: number): Promise<void> {
-    const masterIno = this.getMasterIno(ino);
+    const masterIno = await this.getMasterIno(ino);
     return this.master.flock(masterIno, fh, op);
   }
 
   async bmap(ino: number, blocksize: number, idx: number): Promise<number> {
-    const masterIno = this.getMasterIno(ino);
+    const masterIno = await this.getMasterIno(ino);
     return this.master.bmap(masterIno, blocksize, idx);
   }
 
   async ioctl(ino: number, fh: number, cmd: number, in_buf: Buffer | null, in_bufsz: number, out_bufsz: number, flags: number): Promise<{ result: number; out_buf?: Buffer }> {
-    const masterIno = this.getMasterIno(ino);
+    const masterIno = await this.getMasterIno(ino);
     return this.master.ioctl(masterIno, fh, cmd, in_buf, in_bufsz, out_bufsz, flags);
   }
 
   async poll(ino: number, fh: number): Promise<number> {
-    const masterIno = this.getMasterIno(ino);
+    const masterIno = await this.getMasterIno(ino);
     return this.master.poll(masterIno, fh);
   }
 
   async fallocate(ino: number, fh: number, offset: number, length: number, mode: number): Promise<void> {
-    const masterIno = this.getMasterIno(ino);
+    const masterIno = await this.getMasterIno(ino);
     await this.master.fallocate(masterIno, fh, offset, length, mode);
-    const slaveIno = this.getSlaveIno(ino);
     try {
+      const slaveIno = this.getSlaveIno(ino);
       await this.slave.fallocate(slaveIno, fh, offset, length, mode);
     } catch {
       // Ignore
@@ -372,33 +493,32 @@ export abstract class BaseCacheProvider implements FilesystemProvider {
   }
 
   async readdirplus(ino: number, fh: number, size: number, offset: number): Promise<DirEntry[]> {
-    return this.readdir(ino, fh, size, offset);
+    return this.list(ino, fh, size, offset, true);
   }
 
   async copy_file_range(ino_in: number, fh_in: number, off_in: number, ino_out: number, fh_out: number, off_out: number, len: number, flags: number): Promise<number> {
-    const masterInoIn = this.getMasterIno(ino_in);
-    const masterInoOut = this.getMasterIno(ino_out);
+    const masterInoIn = await this.getMasterIno(ino_in);
+    const masterInoOut = await this.getMasterIno(ino_out);
     return this.master.copy_file_range(masterInoIn, fh_in, off_in, masterInoOut, fh_out, off_out, len, flags);
   }
 
   async lseek(ino: number, fh: number, off: number, whence: number): Promise<number> {
-    const masterIno = this.getMasterIno(ino);
+    const masterIno = await this.getMasterIno(ino);
     return this.master.lseek(masterIno, fh, off, whence);
   }
 
   async tmpfile(parent: number, mode: number, flags: number): Promise<{ stat: FileStat; fh: number }> {
-    const masterParent = this.getMasterIno(parent);
+    const masterParent = await this.getMasterIno(parent);
     const result = await this.master.tmpfile(masterParent, mode, flags);
-    const ino = this.nextIno++;
-    this.setInoMapping(ino, result.stat.ino);
+    const ino = this.acquireIno(result.stat.ino);
     return { stat: { ...result.stat, ino }, fh: result.fh };
   }
 
   async flush(ino: number, fh: number): Promise<void> {
-    const masterIno = this.getMasterIno(ino);
+    const masterIno = await this.getMasterIno(ino);
     await this.master.flush(masterIno, fh);
-    const slaveIno = this.getSlaveIno(ino);
     try {
+      const slaveIno = this.getSlaveIno(ino);
       await this.slave.flush(slaveIno, fh);
     } catch {
       // Ignore
@@ -406,10 +526,10 @@ export abstract class BaseCacheProvider implements FilesystemProvider {
   }
 
   async fsync(ino: number, fh: number, datasync: number): Promise<void> {
-    const masterIno = this.getMasterIno(ino);
+    const masterIno = await this.getMasterIno(ino);
     await this.master.fsync(masterIno, fh, datasync);
-    const slaveIno = this.getSlaveIno(ino);
     try {
+      const slaveIno = this.getSlaveIno(ino);
       await this.slave.fsync(slaveIno, fh, datasync);
     } catch {
       // Ignore
@@ -417,19 +537,46 @@ export abstract class BaseCacheProvider implements FilesystemProvider {
   }
 
   async release(ino: number, fh: number): Promise<void> {
-    const masterIno = this.getMasterIno(ino);
+    const masterIno = await this.getMasterIno(ino);
     try {
       await this.master.release(masterIno, fh);
     } catch {
       // Ignore
     }
-    const slaveIno = this.getSlaveIno(ino);
     try {
+      const slaveIno = this.getSlaveIno(ino);
       await this.slave.release(slaveIno, fh);
     } catch {
       // Ignore
     }
   }
 
+  async forget(ino: number, nlookup: number): Promise<void> {
+    // Each lookup took at most one reference per side, so a side never holds more
+    // references than the kernel holds on this inode
+    const released = this.inodes.forget(ino, nlookup);
+    const backing = released ?? this.inodes.get(ino);
+    if (!backing) return;
+    if (released?.parent !== undefined && released.name !== undefined) this.unresolved.delete(unresolvedKey(released.parent, released.name));
+    const master = Math.min(nlookup, backing.masterLookups);
+    const slave = Math.min(nlookup, backing.slaveLookups);
+    backing.masterLookups -= master;
+    backing.slaveLookups -= slave;
+    if (backing.master !== undefined && master > 0) await this.master.forget?.(backing.master, master);
+    if (backing.slave !== undefined && slave > 0) await this.slave.forget?.(backing.slave, slave);
+  }
+
+  async forget_multi(forgets: Array<{ ino: number; nlookup: number }>): Promise<void> {
+    for (const forget of forgets) {
+      await this.forget(forget.ino, forget.nlookup);
+    }
+  }
+
   abstract write(ino: number, fh: number, buffer: Buffer, offset: number, length: number): Promise<number>;
 }
+
+const RENAME_EXCHANGE = 2;
+
+function unresolvedKey(parent: number, name: string): string {
+  return `${parent}/${name}`;
+}
@@ -8,10 +8,12 @@ export class WriteBackCacheProvider extends BaseCacheProvider {
   }
 
   async write(ino: number, fh: number, buffer: Buffer, offset: number, length: number): Promise<number> {
-    const slaveIno = this.getSlaveIno(ino);
-    await this.slave.write(slaveIno, fh, buffer, offset, length);
     const masterIno = this.getMasterIno(ino);
-    this.master.write(masterIno, fh, buffer, offset, length).catch(() => {});
+    const slaveIno = this.findSlaveIno(ino);
+    // Without a slave copy there is nothing to write back from
+    if (slaveIno === undefined) return this.master.write(await masterIno, fh, buffer, offset, length);
+    await this.slave.write(slaveIno, fh, buffer, offset, length);
+    masterIno.then((ino) => this.master.write(ino, fh, buffer, offset, length)).catch(() => {});
     return length;
   }
 }
@@ -8,9 +8,9 @@ export class WriteThroughCacheProvider extends BaseCacheProvider {
   }
 
   async write(ino: number, fh: number, buffer: Buffer, offset: number, length: number): Promise<number> {
-    const masterIno = this.getMasterIno(ino);
-    const slaveIno = this.getSlaveIno(ino);
-    await Promise.all([this.master.write(masterIno, fh, buffer, offset, length), this.slave.write(slaveIno, fh, buffer, offset, length).catch(() => {})]);
+    const masterIno = await this.getMasterIno(ino);
+    const slaveIno = this.findSlaveIno(ino);
+    await Promise.all([this.master.write(masterIno, fh, buffer, offset, length), slaveIno === undefined ? undefined : this.slave.write(slaveIno, fh, buffer, offset, length).catch(() => {})]);
     return length;
   }
 }
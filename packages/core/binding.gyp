@@ -22,7 +22,7 @@
           ],
           "cflags": [
             "-D_FILE_OFFSET_BITS=64",
-            "-DFUSE_USE_VERSION=35"
+            "-DFUSE_USE_VERSION=312"
           ]
         }],
         ["OS=='linux'", {
@@ -30,8 +30,9 @@
             "-lfuse3"
           ],
           "cflags": [
+            "-D_DEFAULT_SOURCE",
             "-D_FILE_OFFSET_BITS=64",
-            "-DFUSE_USE_VERSION=35"
+            "-DFUSE_USE_VERSION=312"
           ]
         }],
         ["OS=='win'", {
@@ -0,0 +1,115 @@
+import { Opcode } from "./opcodes";
+
+/**
+ * Requests arrive from the native addon in batches. Each request occupies DESC_STRIDE
+ * slots of a Float64Array: [reqPtr, opcode, extrasBase, a0..a8]. Numeric arguments
+ * live in a0..a8; strings, buffers and objects are appended to a shared extras array
+ * starting at extrasBase. Layouts must match encode_request in src/native/fuse_bindings.c.
+ */
+export const DESC_STRIDE = 12;
+
+const ARGS = 3;
+
+// eslint-disable-next-line @typescript-eslint/no-explicit-any
+type Params = Record<string, any>;
+
+type Decoder = (desc: Float64Array, i: number, extras: unknown[], x: number) => Params;
+
+const none: Decoder = () => ({});
+
+const inoFh: Decoder = (d, i) => ({ ino: d[i], fh: d[i + 1] });
+
+const parentName: Decoder = (d, i, e, x) => ({ parent: d[i], name: e[x] });
+
+const io: Decoder = (d, i) => ({ ino: d[i], fh: d[i + 1], size: d[i + 2], off: d[i + 3] });
+
+const write: Decoder = (d, i, e, x) => ({ ino: d[i], fh: d[i + 1], size: d[i + 2], off: d[i + 3], data: e[x] });
+
+const fsync: Decoder = (d, i) => ({ ino: d[i], fh: d[i + 1], datasync: d[i + 2] });
+
+const open: Decoder = (d, i) => ({ ino: d[i], flags: d[i + 1] });
+
+const lock = (d: Float64Array, i: number) => ({
+  type: d[i + 2],
+  whence: d[i + 3],
+  start: d[i + 4],
+  len: d[i + 5],
+  pid: d[i + 6],
+});
+
+const decoders: Decoder[] = [];
+decoders[Opcode.INIT] = none;
+decoders[Opcode.DESTROY] = none;
+decoders[Opcode.LOOKUP] = parentName;
+decoders[Opcode.FORGET] = (d, i) => ({ ino: d[i], nlookup: d[i + 1] });
+decoders[Opcode.FORGET_MULTI] = (d, i, e, x) => ({ count: d[i], inos: e[x], nlookups: e[x + 1] });
+decoders[Opcode.GETATTR] = inoFh;
+decoders[Opcode.SETATTR] = (d, i, e, x) => ({ ino: d[i], to_set: d[i + 1], fh: d[i + 2], attr: e[x] });
+decoders[Opcode.READLINK] = (d, i) => ({ ino: d[i] });
+decoders[Opcode.MKNOD] = (d, i, e, x) => ({ parent: d[i], mode: d[i + 1], rdev: d[i + 2], name: e[x] });
+decoders[Opcode.MKDIR] = (d, i, e, x) => ({ parent: d[i], mode: d[i + 1], name: e[x] });
+decoders[Opcode.UNLINK] = parentName;
+decoders[Opcode.RMDIR] = parentName;
+decoders[Opcode.SYMLINK] = (d, i, e, x) => ({ parent: d[i], link: e[x], name: e[x + 1] });
+decoders[Opcode.RENAME] = (d, i, e, x) => ({
+  parent: d[i],
+  newparent: d[i + 1],
+  flags: d[i + 2],
+  name: e[x],
+  newname: e[x + 1],
+});
+decoders[Opcode.LINK] = (d, i, e, x) => ({ ino: d[i], newparent: d[i + 1], newname: e[x] });
+decoders[Opcode.OPEN] = open;
+decoders[Opcode.READ] = io;
+decoders[Opcode.WRITE] = write;
+decoders[Opcode.WRITE_BUF] = write;
+decoders[Opcode.FLUSH] = inoFh;
+decoders[Opcode.RELEASE] = inoFh;
+decoders[Opcode.FSYNC] = fsync;
+decoders[Opcode.OPENDIR] = open;
+decoders[Opcode.READDIR] = io;
+decoders[Opcode.READDIRPLUS] = io;
+decoders[Opcode.RELEASEDIR] = inoFh;
+decoders[Opcode.FSYNCDIR] = fsync;
+decoders[Opcode.STATFS] = inoFh;
+decoders[Opcode.SETXATTR] = (d, i, e, x) => ({ ino: d[i], size: d[i + 1], flags: d[i + 2], name: e[x], value: e[x + 1] });
+decoders[Opcode.GETXATTR] = (d, i, e, x) => ({ ino: d[i], size: d[i + 1], name: e[x] });
+decoders[Opcode.LISTXATTR] = (d, i) => ({ ino: d[i], size: d[i + 1] });
+decoders[Opcode.REMOVEXATTR] = (d, i, e, x) => ({ ino: d[i], name: e[x] });
+decoders[Opcode.ACCESS] = (d, i) => ({ ino: d[i], mask: d[i + 1] });
+decoders[Opcode.CREATE] = (d, i, e, x) => ({ parent: d[i], mode: d[i + 1], flags: d[i + 2], name: e[x] });
+decoders[Opcode.GETLK] = (d, i) => ({ ino: d[i], fh: d[i + 1], lock: lock(d, i) });
+decoders[Opcode.SETLK] = (d, i) => ({ ino: d[i], fh: d[i + 1], lock: lock(d, i), sleep: d[i + 7] });
+decoders[Opcode.FLOCK] = (d, i) => ({ ino: d[i], fh: d[i + 1], op: d[i + 2] });
+decoders[Opcode.BMAP] = (d, i) => ({ ino: d[i], blocksize: d[i + 1], idx: d[i + 2] });
+decoders[Opcode.IOCTL] = (d, i, e, x) => ({
+  ino: d[i],
+  cmd: d[i + 1],
+  in_bufsz: d[i + 2],
+  out_bufsz: d[i + 3],
+  flags: d[i + 4],
+  fh: d[i + 5],
+  in_buf: e[x],
+});
+decoders[Opcode.POLL] = inoFh;
+decoders[Opcode.FALLOCATE] = (d, i) => ({ ino: d[i], fh: d[i + 1], offset: d[i + 2], length: d[i + 3], mode: d[i + 4] });
+decoders[Opcode.COPY_FILE_RANGE] = (d, i) => ({
+  ino_in: d[i],
+  fh_in: d[i + 1],
+  off_in: d[i + 2],
+  ino_out: d[i + 3],
+  fh_out: d[i + 4],
+  off_out: d[i + 5],
+  len: d[i + 6],
+  flags: d[i + 7],
+});
+decoders[Opcode.LSEEK] = (d, i) => ({ ino: d[i], fh: d[i + 1], off: d[i + 2], whence: d[i + 3] });
+decoders[Opcode.TMPFILE] = (d, i) => ({ parent: d[i], mode: d[i + 1], flags: d[i + 2] });
+decoders[Opcode.STATX] = (d, i) => ({ ino: d[i], flags: d[i + 1], mask: d[i + 2] });
+decoders[Opcode.RETRIEVE_REPLY] = (d, i, e, x) => ({ ino: d[i], cookie: d[i + 1], offset: d[i + 2], data: e[x] });
+
+/** Decodes the params object for the request starting at desc[base] */
+export function decodeParams(desc: Float64Array, base: number, extras: unknown[]): Params {
+  const decode = decoders[desc[base + 1]] ?? none;
+  return decode(desc, base + ARGS, extras, desc[base + 2]);
+}
@@ -1,24 +1,215 @@
 import { createRequire } from "module";
-import { FilesystemProvider } from "./provider";
+import { DESC_STRIDE, decodeParams } from "./batch";
+import { BufferPool } from "./buffer-pool";
+import { Opcode } from "./opcodes";
+import { PackedStat, createPackedStat, statIno } from "./packed-stat";
+import { FilesystemProvider, KernelNotifier, ProviderCapabilities } from "./provider";
+import { TraceOptions, TraceWriter, interceptReplies } from "./trace";
+import { CachePolicy, DirEntry, FileStat, MountStats, QueueStats } from "./types";
+import { WorkerOptions, WorkerPool } from "./worker-pool";
 
 const requireNative = createRequire(import.meta.url);
-const mount0_fuse = requireNative("../build/Release/mount0_fuse.node");
 
-export class FuseBridge {
-  private provider: FilesystemProvider;
-  private mounted: boolean = false;
+// eslint-disable-next-line @typescript-eslint/no-explicit-any
+type Native = Record<string, (...args: any[]) => any>;
+
+// Loaded on first use, so traces can be replayed where the addon isn't built
+let addon: Native | null = null;
+function loadAddon(): Native {
+  return (addon ??= requireNative("../build/Release/mount0_fuse.node"));
+}
+
+export interface FuseConfig {
+  threads?: number;
+  clone_fd?: boolean;
+  max_idle_threads?: number;
+  entry_timeout?: number;
+  attr_timeout?: number;
+  keep_cache?: boolean;
+  direct_io?: boolean;
+  parallel_direct_writes?: boolean;
+  writeback_cache?: boolean;
+  auto_inval_data?: boolean;
+  native_cache_timeout?: number;
+  native_cache_max_entries?: number;
+  negative_timeout?: number;
+  max_write?: number;
+  max_read?: number;
+  max_readahead?: number;
+  max_pages?: number;
+  max_background?: number;
+  congestion_threshold?: number;
+  batch_size?: number;
+  workers?: number;
+  shard_by_inode?: boolean;
+  queue_metadata?: number;
+  queue_read?: number;
+  queue_write?: number;
+  queue_background?: number;
+  io_uring?: boolean;
+  io_uring_depth?: number;
+  passthrough?: boolean;
+  /** Optional ops to register, see capabilityOps. Defaults to the provider's capabilities. */
+  ops?: number;
+}
 
-  constructor(provider: FilesystemProvider) {
+// Open reply flags, must match OPEN_* in src/native/fuse_bindings.c
+const OPEN_KEEP_CACHE = 0x1;
+const OPEN_DIRECT_IO = 0x2;
+const OPEN_PARALLEL_DIRECT_WRITES = 0x4;
+
+// Optional op bits, must match OPS_* in src/native/fuse_bindings.c
+const CAPABILITY_OPS: Record<keyof ProviderCapabilities, number> = {
+  readdirplus: 0x1,
+  copyFileRange: 0x2,
+  fallocate: 0x4,
+  posixLocks: 0x8,
+  flock: 0x10,
+  lseek: 0x20,
+  bmap: 0x40,
+  ioctl: 0x80,
+  poll: 0x100,
+  xattr: 0x200,
+  tmpfile: 0x400,
+  access: 0x800,
+};
+const OPS_ALL = 0xfff;
+
+/** The native ops mask for a provider's capabilities; all ops when it declares none */
+export function capabilityOps(capabilities: ProviderCapabilities | undefined): number {
+  if (!capabilities) return OPS_ALL;
+  let ops = 0;
+  for (const [name, bit] of Object.entries(CAPABILITY_OPS)) {
+    if (capabilities[name as keyof ProviderCapabilities]) ops |= bit;
+  }
+  return ops;
+}
+
+export class FuseBridge implements KernelNotifier {
+  private provider: FilesystemProvider;
+  // Native mount handle; each bridge owns its own session, loop threads and request queue
+  private handle: unknown = null;
+  private readonly addon: Native;
+  // The addon, or a wrapper around it that records replies while tracing
+  private native: Native;
+  private trace: TraceWriter | null = null;
+  private readPool: BufferPool;
+  private cacheDefaults: CachePolicy = {};
+  private passthrough = false;
+  // notify_retrieve cookie -> pending retrieve(), settled by the kernel's retrieve_reply
+  private retrieves = new Map<number, { resolve: (data: Buffer) => void; reject: (err: Error) => void }>();
+  private nextCookie: number = 1;
+  // Out buffers for lookupPacked/getattrPacked; the native reply copies them synchronously
+  private freeStats: PackedStat[] = [];
+  private workers: WorkerPool | null = null;
+
+  /** native replaces the addon, for running requests without a mount (see replayTrace) */
+  constructor(provider: FilesystemProvider, native?: Native) {
     this.provider = provider;
+    this.addon = native ?? loadAddon();
+    this.native = this.addon;
+    this.readPool = this.createReadPool(0);
+  }
+
+  async mount(mountpoint: string, options: Record<string, string> = {}, config: FuseConfig = {}, workers?: WorkerOptions): Promise<void> {
+    if (this.handle) throw new Error("Already mounted");
+    this.configure(config);
+
+    if (workers) {
+      // Workers build their providers first, so the ops they declare are registered
+      this.workers = await WorkerPool.spawn(workers);
+      config = { ...config, ops: config.ops ?? capabilityOps(this.workers.capabilities), workers: workers.count, shard_by_inode: (workers.sharding ?? "inode") === "inode" };
+    } else {
+      config = { ...config, ops: config.ops ?? capabilityOps(this.provider.capabilities?.()) };
+    }
+    try {
+      this.handle = this.native.mount(mountpoint, { allow_other: "0", ...options }, this.createHandler(), config);
+      if (this.workers) {
+        // The session starts once every worker is attached, so no request is routed to a missing one
+        await this.workers.attach(this.native.mount_id(this.handle), config);
+        this.native.start(this.handle);
+      }
+    } catch (err) {
+      if (this.handle) this.native.unmount(this.handle);
+      this.handle = null;
+      await this.workers?.stop();
+      this.workers = null;
+      throw err;
+    }
+    this.provider.attachNotifier?.(this);
+  }
+
+  /** Serves the requests the native side routes to worker index of mountId. Called inside a worker_thread. */
+  serveWorker(mountId: number, index: number, config: FuseConfig = {}): void {
+    this.native.attach_worker(mountId, index, this.batchHandler(config));
+  }
+
+  /** Configures the bridge and returns the function that takes request batches in the native format */
+  batchHandler(config: FuseConfig = {}): (desc: Float64Array, extras: unknown[], count: number) => void {
+    this.configure(config);
+    return this.createHandler();
+  }
+
+  async unmount(): Promise<void> {
+    if (!this.handle) return;
+    this.provider.attachNotifier?.(null);
+    this.native.unmount(this.handle);
+    this.handle = null;
+    for (const pending of this.retrieves.values()) pending.reject(new Error("Unmounted"));
+    this.retrieves.clear();
+    await this.stopTrace();
+    await this.workers?.stop();
+    this.workers = null;
+  }
+
+  /** Records every request handled on this thread, with its timing and reply, to path */
+  startTrace(path: string, options?: TraceOptions): void {
+    if (this.trace) throw new Error("Already tracing");
+    const trace = new TraceWriter(path, options);
+    this.trace = trace;
+    this.native = interceptReplies(this.addon, (reqPtr, outcome) => trace.reply(reqPtr, outcome));
+  }
+
+  async stopTrace(): Promise<void> {
+    const trace = this.trace;
+    if (!trace) return;
+    this.trace = null;
+    this.native = this.addon;
+    await trace.close();
   }
 
-  async mount(mountpoint: string, options: Record<string, string> = {}): Promise<void> {
-    if (this.mounted) throw new Error("Already mounted");
+  /** Per-lane depth of the native request queue, or null when not mounted */
+  queueStats(): QueueStats | null {
+    return this.handle ? this.native.queue_stats(this.handle) : null;
+  }
+
+  /** Per-operation counters and latency histograms since mount, or null when not mounted */
+  stats(): MountStats | null {
+    if (!this.handle) return null;
+    return { ops: this.native.stats(this.handle), queues: this.native.queue_stats(this.handle), transport: this.native.transport(this.handle) };
+  }
+
+  private configure(config: FuseConfig): void {
+    // Read requests are bounded by max_read, or by max_pages which libfuse derives from max_write
+    this.readPool = this.createReadPool(config.max_read ?? config.max_write ?? (config.max_pages ?? 0) * 4096);
+    this.cacheDefaults = {
+      entryTimeout: config.entry_timeout,
+      attrTimeout: config.attr_timeout,
+      keepCache: config.keep_cache,
+      directIo: config.direct_io,
+      parallelDirectWrites: config.parallel_direct_writes,
+      nativeCacheTimeout: config.native_cache_timeout,
+      negativeTimeout: config.negative_timeout,
+    };
+    this.passthrough = config.passthrough ?? false;
+  }
 
+  // Requests are delivered in batches; each one is dispatched without waiting for the others
+  private createHandler(): (desc: Float64Array, extras: unknown[], count: number) => void {
     // eslint-disable-next-line @typescript-eslint/no-explicit-any
-    const handler = async (reqPtr: number, params: Record<string, any>) => {
+    const dispatch = async (reqPtr: number, opcode: Opcode, params: Record<string, any>) => {
       try {
-        await this.handleOperation(reqPtr, params);
+        await this.handleOperation(reqPtr, opcode, params);
         // eslint-disable-next-line @typescript-eslint/no-explicit-any
       } catch (err: any) {
         let errno: number;
@@ -38,45 +229,141 @@ export class FuseBridge {
           errno = 5;
         }
         if (process.env.MOUNT0_DEBUG === "1") {
-          const op = params?.op || "unknown";
+          const op = Opcode[opcode] ?? "unknown";
           const errMsg = err?.message || (typeof err === "string" ? err : JSON.stringify(err));
           console.error(`[FUSE:error] op=${op}, err=${errMsg}, errno=${err.errno}, code=${err.code}, final_errno=${errno}`);
         }
-        mount0_fuse.reply_err(reqPtr, errno);
+        this.native.reply_err(reqPtr, errno);
       }
     };
 
-    await mount0_fuse.mount(mountpoint, { allow_other: "0", ...options }, handler);
-    this.mounted = true;
+    return (desc: Float64Array, extras: unknown[], count: number) => {
+      for (let k = 0, base = 0; k < count; k++, base += DESC_STRIDE) {
+        if (this.trace) this.trace.request(desc, base, extras, k + 1 < count ? desc[base + DESC_STRIDE + 2] : extras.length);
+        void dispatch(desc[base], desc[base + 1], decodeParams(desc, base, extras));
+      }
+    };
   }
 
-  async unmount(): Promise<void> {
-    if (!this.mounted) return;
-    mount0_fuse.unmount();
-    this.mounted = false;
+  // Kernel notifications. Each runs off the event loop and rejects with errno set on failure.
+  invalInode(ino: number, off: number = 0, len: number = 0): Promise<void> {
+    return this.notify((handle) => this.native.notify_inval_inode(handle, ino, off, len));
+  }
+
+  invalEntry(parent: number, name: string): Promise<void> {
+    return this.notify((handle) => this.native.notify_inval_entry(handle, parent, name));
+  }
+
+  delete(parent: number, child: number, name: string): Promise<void> {
+    return this.notify((handle) => this.native.notify_delete(handle, parent, child, name));
+  }
+
+  store(ino: number, offset: number, data: Buffer): Promise<void> {
+    return this.notify((handle) => this.native.notify_store(handle, ino, offset, data));
+  }
+
+  retrieve(ino: number, offset: number, size: number): Promise<Buffer> {
+    const cookie = this.nextCookie++;
+    return new Promise((resolve, reject) => {
+      this.retrieves.set(cookie, { resolve, reject });
+      this.notify((handle) => this.native.notify_retrieve(handle, ino, offset, size, cookie)).catch((err: Error) => {
+        this.retrieves.delete(cookie);
+        reject(err);
+      });
+    });
+  }
+
+  private notify<T>(send: (handle: unknown) => Promise<T>): Promise<T> {
+    if (!this.handle) return Promise.reject(Object.assign(new Error("Not mounted"), { errno: -107 }));
+    return send(this.handle);
+  }
+
+  private createReadPool(maxRequestSize: number): BufferPool {
+    return new BufferPool({
+      maxSize: Math.max(1024 * 1024, maxRequestSize),
+      allocate: (size) => this.native.alloc_buffer(size),
+    });
+  }
+
+  // Per-inode policy from the provider merged over the mount defaults, or undefined to use the native defaults as-is
+  private cachePolicy(ino: number): CachePolicy | undefined {
+    const override = this.provider.cachePolicy?.(ino);
+    return override ? { ...this.cacheDefaults, ...override } : undefined;
+  }
+
+  private openFlags(policy: CachePolicy | undefined): number | undefined {
+    if (!policy) return undefined;
+    return (
+      (policy.keepCache ? OPEN_KEEP_CACHE : 0) |
+      (policy.directIo ? OPEN_DIRECT_IO : 0) |
+      (policy.parallelDirectWrites ? OPEN_PARALLEL_DIRECT_WRITES : 0)
+    );
+  }
+
+  // Names the native cache may answer lookups for; see FilesystemProvider.countsLookups
+  private cachesNames(parent: number): boolean {
+    return !(this.provider.countsLookups ? this.provider.countsLookups(parent) : this.provider.forget);
+  }
+
+  // With parent and name the native cache can also answer later lookups of this entry
+  private replyEntry(reqPtr: number, stat: FileStat | PackedStat, parent?: number, name?: string): void {
+    const policy = this.cachePolicy(statIno(stat));
+    const cached = parent !== undefined && this.cachesNames(parent);
+    this.native.reply_lookup(reqPtr, stat, policy?.entryTimeout, policy?.attrTimeout, policy?.nativeCacheTimeout, cached ? parent : undefined, cached ? name : undefined);
+  }
+
+  // A missing name; the policy of the parent decides whether the kernel may cache the miss
+  private replyNegativeEntry(reqPtr: number, parent: number): void {
+    this.native.reply_negative_entry(reqPtr, this.cachePolicy(parent)?.negativeTimeout);
+  }
+
+  // readdirplus entries with attributes answer the lookup of each name, so they get the same timeouts
+  private policyEntries(entries: DirEntry[]): DirEntry[] {
+    if (!this.provider.cachePolicy) return entries;
+    return entries.map((e) => {
+      const policy = e.stat && this.cachePolicy(e.stat.ino);
+      return policy ? { ...e, entry_timeout: policy.entryTimeout, attr_timeout: policy.attrTimeout, cache_timeout: policy.nativeCacheTimeout } : e;
+    });
+  }
+
+  private replyAttr(reqPtr: number, ino: number, stat: FileStat | PackedStat): void {
+    const policy = this.cachePolicy(ino);
+    this.native.reply_getattr(reqPtr, stat, policy?.attrTimeout, policy?.nativeCacheTimeout);
+  }
+
+  private replyCreate(reqPtr: number, stat: FileStat, fh: number): void {
+    const policy = this.cachePolicy(stat.ino);
+    this.native.reply_create(reqPtr, stat, fh, this.openFlags(policy), policy?.entryTimeout, policy?.attrTimeout, this.backingFd(stat.ino, fh));
+  }
+
+  private backingFd(ino: number, fh: number): number | undefined {
+    return this.passthrough ? this.provider.backingFd?.(ino, fh) : undefined;
   }
 
   // eslint-disable-next-line @typescript-eslint/no-explicit-any
-  private async handleOperation(reqPtr: number, params: Record<string, any>): Promise<void> {
+  private async handleOperation(reqPtr: number, op: Opcode, params: Record<string, any>): Promise<void> {
     if (!params) throw new Error("params is undefined");
-    const op = params.op;
-
-    if (op === "init" || op === "destroy") {
-      if (op === "init" && this.provider.init) await this.provider.init();
-      else if (op === "destroy" && this.provider.destroy) await this.provider.destroy();
-      return;
-    }
 
     switch (op) {
-      case "forget": {
+      case Opcode.INIT: {
+        if (this.provider.init) await this.provider.init();
+        break;
+      }
+
+      case Opcode.DESTROY: {
+        if (this.provider.destroy) await this.provider.destroy();
+        break;
+      }
+
+      case Opcode.FORGET: {
         if (this.provider.forget) {
           await this.provider.forget(params.ino, params.nlookup);
         }
-        mount0_fuse.reply_none(reqPtr);
+        this.native.reply_none(reqPtr);
         break;
       }
 
-      case "forget_multi": {
+      case Opcode.FORGET_MULTI: {
         if (this.provider.forget_multi) {
           const forgets: Array<{ ino: number; nlookup: number }> = [];
           const inos = params.inos || [];
@@ -86,299 +373,331 @@ export class FuseBridge {
           }
           await this.provider.forget_multi(forgets);
         }
-        mount0_fuse.reply_none(reqPtr);
+        this.native.reply_none(reqPtr);
         break;
       }
 
-      case "retrieve_reply": {
-        if (this.provider.retrieve_reply) {
-          const buf = params.data || Buffer.alloc(0);
+      case Opcode.RETRIEVE_REPLY: {
+        const buf = params.data || Buffer.alloc(0);
+        const pending = this.retrieves.get(params.cookie);
+        if (pending) {
+          this.retrieves.delete(params.cookie);
+          pending.resolve(buf);
+        } else if (this.provider.retrieve_reply) {
           await this.provider.retrieve_reply(params.ino, params.cookie, params.offset, buf);
         }
-        mount0_fuse.reply_none(reqPtr);
+        this.native.reply_none(reqPtr);
         break;
       }
 
       // Core operations
-      case "lookup": {
+      case Opcode.LOOKUP: {
+        if (this.provider.lookupPacked) {
+          const out = this.freeStats.pop() ?? createPackedStat();
+          try {
+            const stat = await this.provider.lookupPacked(params.parent, params.name, out);
+            if (stat) this.replyEntry(reqPtr, stat, params.parent, params.name);
+            else this.replyNegativeEntry(reqPtr, params.parent);
+          } finally {
+            this.freeStats.push(out);
+          }
+          break;
+        }
         const stat = await this.provider.lookup(params.parent, params.name);
-        if (!stat) throw { code: "ENOENT", errno: -2 };
-        mount0_fuse.reply_lookup(reqPtr, stat);
+        if (stat) this.replyEntry(reqPtr, stat, params.parent, params.name);
+        else this.replyNegativeEntry(reqPtr, params.parent);
         break;
       }
 
-      case "getattr": {
+      case Opcode.GETATTR: {
+        if (this.provider.getattrPacked) {
+          const out = this.freeStats.pop() ?? createPackedStat();
+          try {
+            const stat = await this.provider.getattrPacked(params.ino, params.fh, out);
+            if (!stat) throw { code: "ENOENT", errno: -2 };
+            this.replyAttr(reqPtr, params.ino, stat);
+          } finally {
+            this.freeStats.push(out);
+          }
+          break;
+        }
         const stat = await this.provider.getattr(params.ino, params.fh);
         if (!stat) throw { code: "ENOENT", errno: -2 };
-        mount0_fuse.reply_getattr(reqPtr, stat);
+        this.replyAttr(reqPtr, params.ino, stat);
         break;
       }
 
-      case "setattr": {
-        await this.provider.setattr(params.ino, params.fh, params.to_set, params.attr);
-        mount0_fuse.reply_getattr(reqPtr, await this.provider.getattr(params.ino, params.fh));
+      case Opcode.SETATTR: {
+        // Providers that don't return the new attributes are asked for them
+        const updated = await this.provider.setattr(params.ino, params.fh, params.to_set, params.attr);
+        const stat = updated || (await this.provider.getattr(params.ino, params.fh));
+        if (!stat) throw { code: "ENOENT", errno: -2 };
+        this.replyAttr(reqPtr, params.ino, stat);
         break;
       }
 
       // Directory operations
-      case "readdir": {
+      case Opcode.READDIR: {
         const entries = await this.provider.readdir(params.ino, params.fh, params.size, params.off);
-        mount0_fuse.reply_readdir(reqPtr, entries || []);
+        this.native.reply_readdir(reqPtr, entries || [], params.size, params.off);
         break;
       }
 
-      case "opendir": {
+      case Opcode.OPENDIR: {
         const fh = await this.provider.opendir(params.ino, params.flags);
-        mount0_fuse.reply_opendir(reqPtr, fh);
+        this.native.reply_opendir(reqPtr, fh);
         break;
       }
 
-      case "releasedir": {
+      case Opcode.RELEASEDIR: {
         await this.provider.releasedir(params.ino, params.fh);
-        mount0_fuse.reply_releasedir(reqPtr, 0);
+        this.native.reply_releasedir(reqPtr, 0);
         break;
       }
 
-      case "fsyncdir": {
+      case Opcode.FSYNCDIR: {
         await this.provider.fsyncdir(params.ino, params.fh, params.datasync);
-        mount0_fuse.reply_fsyncdir(reqPtr, 0);
+        this.native.reply_fsyncdir(reqPtr, 0);
         break;
       }
 
       // File operations
-      case "open": {
+      case Opcode.OPEN: {
         const fh = await this.provider.open(params.ino, params.flags);
-        mount0_fuse.reply_open(reqPtr, fh);
+        this.native.reply_open(reqPtr, fh, this.openFlags(this.cachePolicy(params.ino)), this.backingFd(params.ino, fh), params.ino);
         break;
       }
 
-      case "read": {
-        const buf = Buffer.alloc(params.size);
-        const bytesRead = await this.provider.read(params.ino, params.fh, buf, params.off, params.size);
-        mount0_fuse.reply_read(reqPtr, buf.subarray(0, bytesRead));
+      case Opcode.READ: {
+        const buf = this.readPool.acquire(params.size);
+        try {
+          const bytesRead = await this.provider.read(params.ino, params.fh, buf, params.off, params.size);
+          this.native.reply_read(reqPtr, buf.subarray(0, bytesRead));
+        } finally {
+          this.readPool.release(buf);
+        }
         break;
       }
 
-      case "write": {
+      case Opcode.WRITE: {
         const buf = params.data || Buffer.alloc(0);
         const bytesWritten = await this.provider.write(params.ino, params.fh, buf, params.off, params.size);
-        mount0_fuse.reply_write(reqPtr, bytesWritten);
+        this.native.reply_write(reqPtr, bytesWritten);
         break;
       }
 
-      case "write_buf": {
+      case Opcode.WRITE_BUF: {
         const buf = params.data || Buffer.alloc(0);
         const bytesWritten = await this.provider.write(params.ino, params.fh, buf, params.off, params.size);
-        mount0_fuse.reply_write(reqPtr, bytesWritten);
+        this.native.reply_write(reqPtr, bytesWritten);
         break;
       }
 
-      case "flush": {
+      case Opcode.FLUSH: {
         await this.provider.flush(params.ino, params.fh);
-        mount0_fuse.reply_flush(reqPtr, 0);
+        this.native.reply_flush(reqPtr, 0);
         break;
       }
 
-      case "fsync": {
+      case Opcode.FSYNC: {
         await this.provider.fsync(params.ino, params.fh, params.datasync);
-        mount0_fuse.reply_fsync(reqPtr, 0);
+        this.native.reply_fsync(reqPtr, 0);
         break;
       }
 
-      case "release": {
+      case Opcode.RELEASE: {
         await this.provider.release(params.ino, params.fh);
-        mount0_fuse.reply_release(reqPtr);
+        this.native.reply_release(reqPtr);
         break;
       }
 
       // Create operations
-      case "create": {
+      case Opcode.CREATE: {
         const result = await this.provider.create(params.parent, params.name, params.mode, params.flags);
-        mount0_fuse.reply_create(reqPtr, result.stat, result.fh);
+        this.replyCreate(reqPtr, result.stat, result.fh);
         break;
       }
 
-      case "mknod": {
+      case Opcode.MKNOD: {
         const stat = await this.provider.mknod(params.parent, params.name, params.mode, params.rdev);
-        mount0_fuse.reply_mknod(reqPtr, stat);
+        this.replyEntry(reqPtr, stat, params.parent, params.name);
         break;
       }
 
-      case "mkdir": {
+      case Opcode.MKDIR: {
         const stat = await this.provider.mkdir(params.parent, params.name, params.mode);
-        mount0_fuse.reply_lookup(reqPtr, stat);
+        this.replyEntry(reqPtr, stat, params.parent, params.name);
         break;
       }
 
       // Remove operations
-      case "unlink": {
-        await this.provider.unlink(params.parent, params.name);
-        mount0_fuse.reply_unlink(reqPtr, 0);
+      case Opcode.UNLINK: {
+        const removed = await this.provider.unlink(params.parent, params.name);
+        this.native.reply_unlink(reqPtr, 0, removed ?? 0);
         break;
       }
 
-      case "rmdir": {
-        await this.provider.rmdir(params.parent, params.name);
-        mount0_fuse.reply_rmdir(reqPtr, 0);
+      case Opcode.RMDIR: {
+        const removed = await this.provider.rmdir(params.parent, params.name);
+        this.native.reply_rmdir(reqPtr, 0, removed ?? 0);
         break;
       }
 
       // Link operations
-      case "link": {
+      case Opcode.LINK: {
         const stat = await this.provider.link(params.ino, params.newparent, params.newname);
-        mount0_fuse.reply_link(reqPtr, stat);
+        this.replyEntry(reqPtr, stat, params.newparent, params.newname);
         break;
       }
 
-      case "symlink": {
+      case Opcode.SYMLINK: {
         const stat = await this.provider.symlink(params.link, params.parent, params.name);
-        mount0_fuse.reply_symlink(reqPtr, stat);
+        this.replyEntry(reqPtr, stat, params.parent, params.name);
         break;
       }
 
-      case "readlink": {
+      case Opcode.READLINK: {
         const link = await this.provider.readlink(params.ino);
-        mount0_fuse.reply_readlink(reqPtr, link);
+        this.native.reply_readlink(reqPtr, link);
         break;
       }
 
       // Rename
-      case "rename": {
+      case Opcode.RENAME: {
         await this.provider.rename(params.parent, params.name, params.newparent, params.newname, params.flags);
-        mount0_fuse.reply_rename(reqPtr, 0);
+        this.native.reply_rename(reqPtr, 0);
         break;
       }
 
       // Extended attributes
-      case "setxattr": {
+      case Opcode.SETXATTR: {
         const value = params.value || Buffer.alloc(0);
         await this.provider.setxattr(params.ino, params.name, value, params.size, params.flags);
-        mount0_fuse.reply_setxattr(reqPtr, 0);
+        this.native.reply_setxattr(reqPtr, 0);
         break;
       }
 
-      case "getxattr": {
+      case Opcode.GETXATTR: {
         const result = await this.provider.getxattr(params.ino, params.name, params.size);
         if (typeof result === "number") {
-          mount0_fuse.reply_xattr(reqPtr, result);
+          this.native.reply_xattr(reqPtr, result);
         } else {
-          mount0_fuse.reply_getxattr(reqPtr, result);
+          this.native.reply_getxattr(reqPtr, result);
         }
         break;
       }
 
-      case "listxattr": {
+      case Opcode.LISTXATTR: {
         const result = await this.provider.listxattr(params.ino, params.size);
         if (typeof result === "number") {
-          mount0_fuse.reply_xattr(reqPtr, result);
+          this.native.reply_xattr(reqPtr, result);
         } else {
-          mount0_fuse.reply_listxattr(reqPtr, result);
+          this.native.reply_listxattr(reqPtr, result);
         }
         break;
       }
 
-      case "removexattr": {
+      case Opcode.REMOVEXATTR: {
         await this.provider.removexattr(params.ino, params.name);
-        mount0_fuse.reply_removexattr(reqPtr, 0);
+        this.native.reply_removexattr(reqPtr, 0);
         break;
       }
 
       // Other operations
-      case "access": {
+      case Opcode.ACCESS: {
         await this.provider.access(params.ino, params.mask);
-        mount0_fuse.reply_access(reqPtr, 0);
+        this.native.reply_access(reqPtr, 0);
         break;
       }
 
-      case "statfs": {
+      case Opcode.STATFS: {
         const statfs = await this.provider.statfs(params.ino, params.fh);
-        mount0_fuse.reply_statfs(reqPtr, statfs);
+        this.native.reply_statfs(reqPtr, statfs);
         break;
       }
 
       // Locking
-      case "getlk": {
+      case Opcode.GETLK: {
         const lock = await this.provider.getlk(params.ino, params.fh, params.lock);
-        mount0_fuse.reply_getlk(reqPtr, lock);
+        this.native.reply_getlk(reqPtr, lock);
         break;
       }
 
-      case "setlk": {
+      case Opcode.SETLK: {
         await this.provider.setlk(params.ino, params.fh, params.lock, params.sleep);
-        mount0_fuse.reply_setlk(reqPtr, 0);
+        this.native.reply_setlk(reqPtr, 0);
         break;
       }
 
-      case "flock": {
+      case Opcode.FLOCK: {
         await this.provider.flock(params.ino, params.fh, params.op);
-        mount0_fuse.reply_flock(reqPtr, 0);
+        this.native.reply_flock(reqPtr, 0);
         break;
       }
 
       // Advanced operations
-      case "bmap": {
+      case Opcode.BMAP: {
         const idx = await this.provider.bmap(params.ino, params.blocksize, params.idx);
-        mount0_fuse.reply_bmap(reqPtr, idx);
+        this.native.reply_bmap(reqPtr, idx);
         break;
       }
 
-      case "ioctl": {
+      case Opcode.IOCTL: {
         const inBuf = params.in_buf || null;
         const result = await this.provider.ioctl(params.ino, params.fh, params.cmd, inBuf, params.in_bufsz, params.out_bufsz, params.flags);
-        mount0_fuse.reply_ioctl(reqPtr, result.result, result.out_buf);
+        this.native.reply_ioctl(reqPtr, result.result, result.out_buf);
         break;
       }
 
-      case "poll": {
+      case Opcode.POLL: {
         const revents = await this.provider.poll(params.ino, params.fh);
-        mount0_fuse.reply_poll(reqPtr, revents);
+        this.native.reply_poll(reqPtr, revents);
         break;
       }
 
-      case "fallocate": {
+      case Opcode.FALLOCATE: {
         await this.provider.fallocate(params.ino, params.fh, params.offset, params.length, params.mode);
-        mount0_fuse.reply_fallocate(reqPtr, 0);
+        this.native.reply_fallocate(reqPtr, 0);
         break;
       }
 
-      case "readdirplus": {
+      case Opcode.READDIRPLUS: {
         const entries = await this.provider.readdirplus(params.ino, params.fh, params.size, params.off);
-        mount0_fuse.reply_readdirplus(reqPtr, entries || []);
+        this.native.reply_readdirplus(reqPtr, this.policyEntries(entries || []), params.size, params.off, this.cachesNames(params.ino) ? params.ino : undefined);
         break;
       }
 
-      case "statx": {
+      case Opcode.STATX: {
         if (this.provider.statx) {
-          await this.provider.statx(params.ino, params.flags, params.mask);
-          const stat = await this.provider.getattr(params.ino, 0);
-          if (stat) mount0_fuse.reply_getattr(reqPtr, stat);
-          else mount0_fuse.reply_err(reqPtr, 2);
+          const stat = await this.provider.statx(params.ino, params.flags, params.mask);
+          if (stat) this.replyAttr(reqPtr, params.ino, stat);
+          else this.native.reply_err(reqPtr, 2);
         } else {
-          mount0_fuse.reply_err(reqPtr, 38);
+          this.native.reply_err(reqPtr, 38);
         }
         break;
       }
 
-      case "copy_file_range": {
+      case Opcode.COPY_FILE_RANGE: {
         const bytesWritten = await this.provider.copy_file_range(params.ino_in, params.fh_in, params.off_in, params.ino_out, params.fh_out, params.off_out, params.len, params.flags);
-        mount0_fuse.reply_copy_file_range(reqPtr, bytesWritten);
+        this.native.reply_copy_file_range(reqPtr, bytesWritten);
         break;
       }
 
-      case "lseek": {
+      case Opcode.LSEEK: {
         const off = await this.provider.lseek(params.ino, params.fh, params.off, params.whence);
-        mount0_fuse.reply_lseek(reqPtr, off);
+        this.native.reply_lseek(reqPtr, off);
         break;
       }
 
-      case "tmpfile": {
+      case Opcode.TMPFILE: {
         const result = await this.provider.tmpfile(params.parent, params.mode, params.flags);
-        mount0_fuse.reply_tmpfile(reqPtr, result.stat, result.fh);
+        this.replyCreate(reqPtr, result.stat, result.fh);
         break;
       }
 
       default:
-        throw new Error(`Unknown operation: ${op}`);
+        throw new Error(`Unknown operation: ${Opcode[op] ?? op}`);
     }
   }
 }
@@ -0,0 +1,69 @@
+export interface BufferPoolOptions {
+  /** Smallest size class in bytes (default 4 KiB) */
+  minSize?: number;
+  /** Largest pooled size class in bytes; bigger requests are allocated unpooled (default 1 MiB) */
+  maxSize?: number;
+  /** Maximum number of free buffers kept per size class (default 64) */
+  maxPerClass?: number;
+  /** Allocator for new backing memory. Must not need zero-filling (default Buffer.allocUnsafeSlow) */
+  allocate?: (size: number) => Buffer;
+}
+
+/**
+ * Size-classed pool of uninitialized buffers for read replies.
+ *
+ * Size classes are powers of two between minSize and maxSize. acquire() returns
+ * a view of exactly the requested length over a pooled backing store; release()
+ * hands the backing store back once the reply has been sent. Buffers are not
+ * zero-filled, so callers must only expose the bytes a provider actually wrote.
+ */
+export class BufferPool {
+  private readonly minShift: number;
+  private readonly maxShift: number;
+  private readonly maxPerClass: number;
+  private readonly allocate: (size: number) => Buffer;
+  private readonly free: ArrayBuffer[][] = [];
+  private readonly owned = new WeakSet<ArrayBuffer>();
+
+  constructor(options: BufferPoolOptions = {}) {
+    this.minShift = Math.ceil(Math.log2(Math.max(options.minSize ?? 4096, 1)));
+    this.maxShift = Math.max(this.minShift, Math.ceil(Math.log2(Math.max(options.maxSize ?? 1024 * 1024, 1))));
+    this.maxPerClass = options.maxPerClass ?? 64;
+    this.allocate = options.allocate ?? Buffer.allocUnsafeSlow;
+    for (let shift = this.minShift; shift <= this.maxShift; shift++) {
+      this.free.push([]);
+    }
+  }
+
+  acquire(size: number): Buffer {
+    const cls = this.classOf(size);
+    if (cls < 0) return this.allocate(size);
+
+    const backing = this.free[cls].pop();
+    if (backing) return Buffer.from(backing, 0, size);
+
+    const buf = this.allocate(2 ** (cls + this.minShift));
+    if (buf.byteOffset === 0 && buf.buffer.byteLength === buf.length) {
+      this.owned.add(buf.buffer as ArrayBuffer);
+    }
+    return Buffer.from(buf.buffer, buf.byteOffset, size);
+  }
+
+  release(buf: Buffer): void {
+    const backing = buf.buffer as ArrayBuffer;
+    if (!this.owned.has(backing)) return;
+    const list = this.free[this.classOf(backing.byteLength)];
+    if (list.length < this.maxPerClass) list.push(backing);
+  }
+
+  /** Number of free buffers currently held, across all size classes */
+  get size(): number {
+    return this.free.reduce((n, list) => n + list.length, 0);
+  }
+
+  private classOf(size: number): number {
+    if (size > 2 ** this.maxShift) return -1;
+    const shift = size <= 2 ** this.minShift ? this.minShift : Math.ceil(Math.log2(size));
+    return shift - this.minShift;
+  }
+}
@@ -0,0 +1,48 @@
+import { DirEntry } from "./types";
+
+// struct fuse_dirent is 24 bytes plus the name, padded to 8 bytes. fuse_direntplus
+// prepends a 128-byte fuse_entry_out.
+const DIRENT_HEADER = 24;
+const DIRENTPLUS_HEADER = 128 + DIRENT_HEADER;
+
+/** Bytes an entry occupies in a readdir (or readdirplus) reply */
+export function direntSize(name: string, plus = false): number {
+  const len = (plus ? DIRENTPLUS_HEADER : DIRENT_HEADER) + Buffer.byteLength(name);
+  return (len + 7) & ~7;
+}
+
+/** The entries starting at index off that fit in a reply buffer of size bytes */
+export function fitEntries(entries: DirEntry[], off: number, size: number, plus = false): DirEntry[] {
+  let end = off;
+  let used = 0;
+  while (end < entries.length) {
+    used += direntSize(entries[end].name, plus);
+    if (used > size) break;
+    end++;
+  }
+  return entries.slice(off, end);
+}
+
+/**
+ * Directory listings snapshotted per open directory handle.
+ *
+ * A readdir at offset 0 (or on a handle without a snapshot) lists the directory once;
+ * later calls page through the snapshot by index, so the offsets the kernel hands back
+ * stay stable cookies and a large directory is not re-listed for every reply.
+ */
+export class DirectoryCursors {
+  private readonly snapshots = new Map<number, DirEntry[]>();
+
+  async read(fh: number, off: number, size: number, list: () => Promise<DirEntry[]>, plus = false): Promise<DirEntry[]> {
+    let entries = off === 0 ? undefined : this.snapshots.get(fh);
+    if (!entries) {
+      entries = await list();
+      this.snapshots.set(fh, entries);
+    }
+    return fitEntries(entries, off, size, plus);
+  }
+
+  release(fh: number): void {
+    this.snapshots.delete(fh);
+  }
+}
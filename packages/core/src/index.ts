@@ -1,3 +1,11 @@
-export { Mount0, MountOptions, mount0 } from "./mount0";
-export { FilesystemProvider, Flock, Statfs } from "./provider";
-export { DirEntry, FileHandle, FileStat } from "./types";
+export { DirectoryCursors, direntSize, fitEntries } from "./dir-cursor";
+export { InodeTable } from "./inode-table";
+export { Mount0, MountCachePolicy, MountOptions, mount0 } from "./mount0";
+export { Opcode } from "./opcodes";
+export { PackedStat, STAT_FIELDS, StatField, createPackedStat, isPackedStat, packStat, statIno, unpackStat } from "./packed-stat";
+export { FilesystemProvider, Flock, KernelNotifier, ProviderCapabilities, Statfs } from "./provider";
+export { ReplayOptions, ReplayResult, replayTrace } from "./replay";
+export { RouteOptions } from "./router";
+export { ReplyOutcome, TraceOptions, TraceRecord, TraceWriter, readTrace } from "./trace";
+export { CachePolicy, DirEntry, FileHandle, FileStat, LaneStats, MountStats, OpStats, PhaseStats, QueueLane, QueueStats } from "./types";
+export { ProviderFactory, WorkerOptions, WorkerPool } from "./worker-pool";
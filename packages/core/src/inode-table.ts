@@ -0,0 +1,104 @@
+// Entries the kernel holds no reference to (handed out by a plain readdir, or
+// allocated and never looked up) are kept for d_ino stability up to this many.
+const UNREFERENCED_LIMIT = 4096;
+
+interface InodeSlot<T> {
+  key: number;
+  backing: T;
+  nlookup: number;
+}
+
+/**
+ * Inode numbers for a provider that wraps other providers.
+ *
+ * Each inode is identified by a numeric key derived from the wrapped provider's
+ * inode (its backing), so looking the same file up twice hands the kernel the
+ * same ino. Lookups are counted the way the kernel counts nlookup and an entry
+ * is dropped once forget brings it back to zero. Inode 1 is pinned to root.
+ */
+export class InodeTable<T = number> {
+  private readonly slots = new Map<number, InodeSlot<T>>();
+  private readonly byKey = new Map<number, number>();
+  private readonly unreferenced = new Set<number>();
+  private nextIno = 2;
+
+  constructor(root: T) {
+    this.slots.set(1, { key: 1, backing: root, nlookup: 1 });
+    this.byKey.set(1, 1);
+  }
+
+  get size(): number {
+    return this.slots.size;
+  }
+
+  /** The backing of ino, or undefined when the kernel has forgotten it */
+  get(ino: number): T | undefined {
+    return this.slots.get(ino)?.backing;
+  }
+
+  /** The ino already handed out for key, if any */
+  peek(key: number): number | undefined {
+    return this.byKey.get(key);
+  }
+
+  /** The ino for key, allocated if needed, without taking a lookup reference (readdir) */
+  assign(key: number, backing: T): number {
+    const ino = this.byKey.get(key);
+    if (ino !== undefined) {
+      this.slots.get(ino)!.backing = backing;
+      return ino;
+    }
+    return this.allocate(key, backing, 0);
+  }
+
+  /** The ino for key, taking one lookup reference (lookup, create, readdirplus entries) */
+  acquire(key: number, backing: T): number {
+    const ino = this.byKey.get(key);
+    if (ino === undefined) return this.allocate(key, backing, 1);
+    const slot = this.slots.get(ino)!;
+    slot.backing = backing;
+    if (slot.nlookup++ === 0) this.unreferenced.delete(ino);
+    return ino;
+  }
+
+  /** The ino for a directory entry: entries handed out with attributes (plus), other than . and .., take a lookup reference */
+  entry(name: string, key: number, backing: T, plus: boolean): number {
+    return plus && name !== "." && name !== ".." ? this.acquire(key, backing) : this.assign(key, backing);
+  }
+
+  /** Updates the backing of a known ino, e.g. once a secondary provider has a copy */
+  update(ino: number, backing: T): void {
+    const slot = this.slots.get(ino);
+    if (slot) slot.backing = backing;
+  }
+
+  /** Drops nlookup references; returns the backing when the entry is released */
+  forget(ino: number, nlookup: number): T | undefined {
+    const slot = this.slots.get(ino);
+    if (!slot || ino === 1) return undefined;
+    slot.nlookup = Math.max(0, slot.nlookup - nlookup);
+    if (slot.nlookup > 0) return undefined;
+    this.release(ino, slot);
+    return slot.backing;
+  }
+
+  private allocate(key: number, backing: T, nlookup: number): number {
+    const ino = this.nextIno++;
+    this.slots.set(ino, { key, backing, nlookup });
+    this.byKey.set(key, ino);
+    if (nlookup === 0) {
+      this.unreferenced.add(ino);
+      if (this.unreferenced.size > UNREFERENCED_LIMIT) {
+        const oldest = this.unreferenced.values().next().value as number;
+        this.release(oldest, this.slots.get(oldest)!);
+      }
+    }
+    return ino;
+  }
+
+  private release(ino: number, slot: InodeSlot<T>): void {
+    this.slots.delete(ino);
+    this.unreferenced.delete(ino);
+    if (this.byKey.get(slot.key) === ino) this.byKey.delete(slot.key);
+  }
+}
@@ -1,20 +1,76 @@
 import { FuseBridge } from "./bridge";
-import { FilesystemProvider } from "./provider";
-import { RouterProvider } from "./router";
+import { FilesystemProvider, KernelNotifier } from "./provider";
+import { RouteOptions, RouterProvider } from "./router";
+import { TraceOptions } from "./trace";
+import { CachePolicy, MountStats, QueueLane, QueueStats } from "./types";
+import { WorkerOptions } from "./worker-pool";
+
+export interface MountCachePolicy extends CachePolicy {
+  /** Let the kernel buffer writes and flush them in the background (FUSE_CAP_WRITEBACK_CACHE) */
+  writebackCache?: boolean;
+  /** Invalidate cached pages when the file's mtime or size changes (FUSE_CAP_AUTO_INVAL_DATA) */
+  autoInvalData?: boolean;
+  /** Maximum number of attribute and name entries held by the native cache (default 65536) */
+  nativeCacheMaxEntries?: number;
+}
 
 export interface MountOptions {
   options?: Record<string, string>;
+  /** Number of FUSE worker threads. 1 (default) runs the single-threaded session loop. */
+  threads?: number;
+  /** Give each worker thread its own /dev/fuse file descriptor (only used when threads > 1). */
+  cloneFd?: boolean;
+  /** Maximum number of idle worker threads kept around by libfuse. */
+  maxIdleThreads?: number;
+  /** Largest write request in bytes. The kernel and libfuse cap requests at 256 pages (1 MiB) by default. */
+  maxWrite?: number;
+  /** Largest read request in bytes. Also passed as the max_read mount option. */
+  maxRead?: number;
+  /** Maximum readahead in bytes. The kernel may lower it. */
+  maxReadahead?: number;
+  /** Request size in pages. Used to derive maxWrite when maxWrite is not set. */
+  maxPages?: number;
+  /** Maximum number of outstanding background requests. */
+  maxBackground?: number;
+  /** Number of background requests at which the kernel considers the filesystem congested. */
+  congestionThreshold?: number;
+  /** Maximum number of requests handed to JavaScript per event loop turn (default 64, max 1024). */
+  batchSize?: number;
+  /** Mount-wide kernel caching policy. Routes can override it via handle(path, provider, { cache }). */
+  cache?: MountCachePolicy;
+  /**
+   * Requests each lane may queue before FUSE threads wait for JavaScript to catch up
+   * (0 = unbounded). Defaults: metadata 4096, read 1024, write 256, background 4096.
+   * The last loop thread reading from the kernel never waits, so setting them runs at
+   * least two threads.
+   */
+  queueLimits?: Partial<Record<QueueLane, number>>;
+  /** Serve requests from worker_threads instead of the routes registered with handle() */
+  workers?: WorkerOptions;
+  /**
+   * Receive requests over per-core io_uring queues instead of reading /dev/fuse (needs
+   * libfuse 3.18 and a kernel loaded with fuse.enable_uring=1; otherwise /dev/fuse is used).
+   */
+  ioUring?: boolean;
+  /** Ring entries per io_uring queue. Defaults to libfuse's choice. */
+  ioUringDepth?: number;
+  /**
+   * Let the kernel read and write files directly through the descriptors providers return
+   * from backingFd(), for routes added with { passthrough: true } (Linux 6.9+, needs
+   * CAP_SYS_ADMIN). Turns off the writeback cache when the kernel accepts it.
+   */
+  passthrough?: boolean;
 }
 
 export class Mount0 {
   private bridge: FuseBridge | null = null;
   private router: RouterProvider | null = null;
 
-  handle(path: string, provider: FilesystemProvider): this {
+  handle(path: string, provider: FilesystemProvider, options?: RouteOptions): this {
     if (!this.router) {
       this.router = new RouterProvider([]);
     }
-    this.router.handle(path, provider);
+    this.router.handle(path, provider, options);
     return this;
   }
 
@@ -26,12 +82,72 @@ export class Mount0 {
   }
 
   async mount(mountpoint: string, options?: MountOptions): Promise<void> {
-    if (!this.router || this.router.providers.length === 0) {
+    if (!options?.workers && (!this.router || this.router.providers.length === 0)) {
       throw new Error("No provider set. Call handle() first.");
     }
 
-    this.bridge = new FuseBridge(this.router);
-    await this.bridge.mount(mountpoint, options?.options || {});
+    this.bridge = new FuseBridge(this.router ?? new RouterProvider([]));
+    await this.bridge.mount(mountpoint, options?.options || {}, {
+      threads: options?.queueLimits ? Math.max(options.threads ?? 1, 2) : options?.threads,
+      clone_fd: options?.cloneFd,
+      max_idle_threads: options?.maxIdleThreads,
+      entry_timeout: options?.cache?.entryTimeout,
+      attr_timeout: options?.cache?.attrTimeout,
+      keep_cache: options?.cache?.keepCache,
+      direct_io: options?.cache?.directIo,
+      parallel_direct_writes: options?.cache?.parallelDirectWrites,
+      writeback_cache: options?.cache?.writebackCache,
+      auto_inval_data: options?.cache?.autoInvalData,
+      native_cache_timeout: options?.cache?.nativeCacheTimeout,
+      native_cache_max_entries: options?.cache?.nativeCacheMaxEntries,
+      negative_timeout: options?.cache?.negativeTimeout,
+      max_write: options?.maxWrite,
+      max_read: options?.maxRead,
+      max_readahead: options?.maxReadahead,
+      max_pages: options?.maxPages,
+      max_background: options?.maxBackground,
+      congestion_threshold: options?.congestionThreshold,
+      batch_size: options?.batchSize,
+      queue_metadata: options?.queueLimits?.metadata,
+      queue_read: options?.queueLimits?.read,
+      queue_write: options?.queueLimits?.write,
+      queue_background: options?.queueLimits?.background,
+      io_uring: options?.ioUring,
+      io_uring_depth: options?.ioUringDepth,
+      passthrough: options?.passthrough,
+    }, options?.workers);
+  }
+
+  /** Per-lane depth of the native request queue, or null when not mounted */
+  queueStats(): QueueStats | null {
+    return this.bridge?.queueStats() ?? null;
+  }
+
+  /**
+   * Request counts and latency percentiles per operation, split into time queued in the
+   * addon, time in JavaScript and time spent replying. Null when not mounted.
+   */
+  stats(): MountStats | null {
+    return this.bridge?.stats() ?? null;
+  }
+
+  /**
+   * Records every request that reaches JavaScript to a trace file until stopTrace() or
+   * unmount(), for replaying with replayTrace() or mount0-replay. Requests answered from
+   * the native cache, and with workers anything served by a worker, are not recorded.
+   */
+  startTrace(path: string, options?: TraceOptions): void {
+    if (!this.bridge) throw new Error("Not mounted");
+    this.bridge.startTrace(path, options);
+  }
+
+  async stopTrace(): Promise<void> {
+    await this.bridge?.stopTrace();
+  }
+
+  /** Kernel cache notifications for the current mount, or null when not mounted */
+  get notifier(): KernelNotifier | null {
+    return this.bridge;
   }
 
   async unmount(): Promise<void> {
@@ -1,6 +1,6 @@
 #include <node_api.h>
 #ifndef FUSE_USE_VERSION
-#define FUSE_USE_VERSION 35
+#define FUSE_USE_VERSION 312
 #endif
 #include <fuse3/fuse_lowlevel.h>
 #include <fuse3/fuse_opt.h>
@@ -13,19 +13,184 @@
 #include <sys/mount.h>
 #endif
 #include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <time.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <unistd.h>
 
-static napi_threadsafe_function tsfn = NULL;
-static struct fuse_session *g_session = NULL;
-static pthread_t fuse_thread;
-static int fuse_running = 0;
+// Open reply flags, shared with FuseBridge
+#define OPEN_KEEP_CACHE 0x1
+#define OPEN_DIRECT_IO 0x2
+#define OPEN_PARALLEL_DIRECT_WRITES 0x4
+
+// Optional ops a provider declares it implements, shared with FuseBridge. Ops left
+// out are not registered: libfuse answers ENOSYS, which the kernel remembers, or
+// falls back on its own (local locks, generic llseek, splice copies, plain readdir).
+#define OPS_READDIRPLUS 0x1
+#define OPS_COPY_FILE_RANGE 0x2
+#define OPS_FALLOCATE 0x4
+#define OPS_POSIX_LOCKS 0x8
+#define OPS_FLOCK 0x10
+#define OPS_LSEEK 0x20
+#define OPS_BMAP 0x40
+#define OPS_IOCTL 0x80
+#define OPS_POLL 0x100
+#define OPS_XATTR 0x200
+#define OPS_TMPFILE 0x400
+#define OPS_ACCESS 0x800
+#define OPS_ALL 0xfff
+
+// Requests wait in one bounded lane per class, so bulk data can't queue unbounded
+// memory or delay interactive metadata operations. Lane order matches QueueLane in
+// src/types.ts.
+enum req_lane { LANE_METADATA, LANE_READ, LANE_WRITE, LANE_BACKGROUND, LANE_COUNT };
+
+static const char *const lane_names[LANE_COUNT] = { "metadata", "read", "write", "background" };
+
+// Requests taken from each lane per round of a drain
+static const uint32_t lane_weights[LANE_COUNT] = { 8, 4, 2, 1 };
+
+// Mount settings, read from the config object passed to mount()
+struct mount_config {
+  uint32_t threads;          // 1 = single-threaded fuse_session_loop
+  uint32_t clone_fd;         // give each worker its own /dev/fuse fd
+  int32_t max_idle_threads;  // -1 = libfuse default
+  double entry_timeout;      // default entry/attr timeouts in seconds
+  double attr_timeout;
+  uint32_t open_flags;       // default OPEN_* flags for open/create replies
+  int32_t writeback_cache;   // -1 = libfuse default, 0 = off, 1 = on
+  int32_t auto_inval_data;
+  uint32_t max_write;        // request size limits in bytes, 0 = libfuse default
+  uint32_t max_read;
+  uint32_t max_readahead;
+  uint32_t max_pages;        // used for max_write when max_write is unset
+  uint32_t max_background;   // 0 = libfuse default
+  uint32_t congestion_threshold;
+  uint32_t batch_size;       // max requests handed to JS per threadsafe call
+  double cache_timeout;      // native attr/dentry cache lifetime in seconds, 0 = off
+  uint32_t cache_max_entries;
+  double negative_timeout;   // how long the kernel caches failed lookups, 0 = off
+  uint32_t workers;          // worker_threads requests are spread over, 0 = main thread only
+  uint32_t shard_by_inode;   // 1 = same inode to the same worker, 0 = round-robin
+  uint32_t queue_limits[LANE_COUNT];  // queued requests per lane before FUSE threads wait, 0 = unbounded
+  uint32_t io_uring;         // 1 = ask for FUSE-over-io_uring, falling back to /dev/fuse reads
+  uint32_t io_uring_depth;   // ring entries per per-core queue, 0 = libfuse default
+  uint32_t passthrough;      // 1 = negotiate FUSE_CAP_PASSTHROUGH for replies with a backing fd
+  uint32_t ops;              // OPS_* the provider implements
+};
+
+#define MAX_BATCH_SIZE 1024
+#define MAX_WORKERS 256
+
+// libfuse 3.18 can take requests from per-core io_uring queues instead of reading
+// /dev/fuse; its ring threads call the same lowlevel ops as the classic loop
+#ifdef FUSE_CAP_OVER_IO_URING
+#define HAVE_FUSE_IO_URING 1
+#else
+#define HAVE_FUSE_IO_URING 0
+#endif
+
+// Kernel passthrough (6.9+, libfuse 3.17): open replies name a backing fd and the
+// kernel reads and writes it directly. macFUSE has no equivalent.
+#if defined(FUSE_CAP_PASSTHROUGH) && !defined(__APPLE__)
+#define HAVE_FUSE_PASSTHROUGH 1
+#else
+#define HAVE_FUSE_PASSTHROUGH 0
+#endif
+#define MOUNT_CONFIG_DEFAULTS { 1, 0, -1, 1.0, 1.0, 0, -1, -1, 0, 0, 0, 0, 0, 0, 64, 0, 65536, 0, 0, 1, { 4096, 1024, 256, 4096 }, 0, 0, 0, OPS_ALL }
+
+// MOUNT0_DEBUG is read once, so it has to be set before the first mount
+static int is_debug_enabled(void) {
+  static atomic_int enabled = -1;
+  int val = atomic_load_explicit(&enabled, memory_order_relaxed);
+  if (val < 0) {
+    const char *debug = getenv("MOUNT0_DEBUG");
+    val = debug && debug[0] == '1' && debug[1] == '\0';
+    atomic_store_explicit(&enabled, val, memory_order_relaxed);
+  }
+  return val;
+}
+
+static void __attribute__((unused)) debug_log(const char *op, const char *fmt, ...) {
+  if (!is_debug_enabled()) return;
+  fprintf(stderr, "[FUSE:%s] ", op);
+  va_list args;
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+  fprintf(stderr, "\n");
+}
+
+// Opcodes shared with src/opcodes.ts; the order must match the Opcode enum there.
+#define FUSE_OPS(X) \
+  X(INIT, "init") \
+  X(DESTROY, "destroy") \
+  X(LOOKUP, "lookup") \
+  X(FORGET, "forget") \
+  X(FORGET_MULTI, "forget_multi") \
+  X(GETATTR, "getattr") \
+  X(SETATTR, "setattr") \
+  X(READLINK, "readlink") \
+  X(MKNOD, "mknod") \
+  X(MKDIR, "mkdir") \
+  X(UNLINK, "unlink") \
+  X(RMDIR, "rmdir") \
+  X(SYMLINK, "symlink") \
+  X(RENAME, "rename") \
+  X(LINK, "link") \
+  X(OPEN, "open") \
+  X(READ, "read") \
+  X(WRITE, "write") \
+  X(WRITE_BUF, "write_buf") \
+  X(FLUSH, "flush") \
+  X(RELEASE, "release") \
+  X(FSYNC, "fsync") \
+  X(OPENDIR, "opendir") \
+  X(READDIR, "readdir") \
+  X(READDIRPLUS, "readdirplus") \
+  X(RELEASEDIR, "releasedir") \
+  X(FSYNCDIR, "fsyncdir") \
+  X(STATFS, "statfs") \
+  X(SETXATTR, "setxattr") \
+  X(GETXATTR, "getxattr") \
+  X(LISTXATTR, "listxattr") \
+  X(REMOVEXATTR, "removexattr") \
+  X(ACCESS, "access") \
+  X(CREATE, "create") \
+  X(GETLK, "getlk") \
+  X(SETLK, "setlk") \
+  X(FLOCK, "flock") \
+  X(BMAP, "bmap") \
+  X(IOCTL, "ioctl") \
+  X(POLL, "poll") \
+  X(FALLOCATE, "fallocate") \
+  X(COPY_FILE_RANGE, "copy_file_range") \
+  X(LSEEK, "lseek") \
+  X(TMPFILE, "tmpfile") \
+  X(STATX, "statx") \
+  X(RETRIEVE_REPLY, "retrieve_reply")
+
+#define OP_ENUM(id, name) OP_##id,
+enum fuse_op { FUSE_OPS(OP_ENUM) OP_COUNT };
+#undef OP_ENUM
+
+#define OP_NAME(id, name) name,
+static const char *const op_names[OP_COUNT] = { FUSE_OPS(OP_NAME) };
+#undef OP_NAME
+
+// Room for two NAME_MAX names, enough for rename and most symlinks without a heap copy
+#define REQ_INLINE_STRS 512
 
 struct req_data {
+  _Atomic(struct req_data *) next;  // req_queue link
   fuse_req_t req;
-  char op[24];
+  enum fuse_op op;
+  uint64_t queued_ns;
+  uint64_t attr_gen;
   union {
     struct { fuse_ino_t parent; char *name; } lookup;
     struct { fuse_ino_t ino; uint64_t fh; } getattr;
@@ -74,457 +239,1201 @@ struct req_data {
     struct { fuse_ino_t ino; uint64_t nlookup; } forget;
     struct { size_t count; fuse_ino_t *inos; uint64_t *nlookups; } forget_multi;
   } u;
+  // Names are copied into this arena when they fit; see req_strdup
+  size_t strs_used;
+  char strs[REQ_INLINE_STRS];
 };
 
-static int is_debug_enabled(void) {
-  const char *debug = getenv("MOUNT0_DEBUG");
-  return debug && debug[0] == '1' && debug[1] == '\0';
+// Request descriptors are recycled rather than calloc'd per callback. FUSE threads
+// allocate from a thread-local cache that refills from a shared free list in one
+// lock; the JS thread hands whole batches back the same way.
+#define REQ_THREAD_CACHE 256
+#define REQ_SLAB_MAX 4096
+
+struct req_slab {
+  pthread_mutex_t lock;
+  struct req_data *free;
+  size_t nfree;
+};
+
+struct req_cache {
+  struct req_data *free;
+  size_t nfree;
+};
+
+static struct req_slab g_slab = { PTHREAD_MUTEX_INITIALIZER, NULL, 0 };
+static pthread_key_t req_cache_key;
+static pthread_once_t req_cache_once = PTHREAD_ONCE_INIT;
+
+static struct req_data *req_link(struct req_data *d) {
+  return atomic_load_explicit(&d->next, memory_order_relaxed);
 }
 
-static void __attribute__((unused)) debug_log(const char *op, const char *fmt, ...) {
-  if (!is_debug_enabled()) return;
-  fprintf(stderr, "[FUSE:%s] ", op);
-  va_list args;
-  va_start(args, fmt);
-  vfprintf(stderr, fmt, args);
-  va_end(args);
-  fprintf(stderr, "\n");
+static void req_set_link(struct req_data *d, struct req_data *next) {
+  atomic_store_explicit(&d->next, next, memory_order_relaxed);
 }
 
-static void fuse_serialize_stat(napi_env env, const struct stat *st, napi_value stat_obj);
-static void fuse_parse_stat(napi_env env, napi_value stat_obj, struct stat *st);
+// Returns a chain of n descriptors to the shared list, freeing whatever exceeds REQ_SLAB_MAX
+static void req_slab_put(struct req_data *head, struct req_data *tail, size_t n) {
+  if (!head) return;
+  pthread_mutex_lock(&g_slab.lock);
+  if (g_slab.nfree + n <= REQ_SLAB_MAX) {
+    req_set_link(tail, g_slab.free);
+    g_slab.free = head;
+    g_slab.nfree += n;
+    head = NULL;
+  }
+  pthread_mutex_unlock(&g_slab.lock);
+  while (head) {
+    struct req_data *next = req_link(head);
+    free(head);
+    head = next;
+  }
+}
 
-static void fuse_serialize_flock(napi_env env, const struct flock *lock, napi_value lock_obj) {
-  napi_value val;
-  napi_create_int32(env, lock->l_type, &val);
-  napi_set_named_property(env, lock_obj, "type", val);
-  napi_create_int32(env, lock->l_whence, &val);
-  napi_set_named_property(env, lock_obj, "whence", val);
-  napi_create_int64(env, (int64_t)lock->l_start, &val);
-  napi_set_named_property(env, lock_obj, "start", val);
-  napi_create_int64(env, (int64_t)lock->l_len, &val);
-  napi_set_named_property(env, lock_obj, "len", val);
-  napi_create_int32(env, lock->l_pid, &val);
-  napi_set_named_property(env, lock_obj, "pid", val);
+// Worker threads come and go (max_idle_threads), so a dying thread returns its cache
+static void req_cache_destroy(void *arg) {
+  struct req_cache *c = arg;
+  struct req_data *tail = c->free;
+  while (tail && req_link(tail)) tail = req_link(tail);
+  req_slab_put(c->free, tail, c->nfree);
+  free(c);
 }
 
-static void call_js(napi_env env, napi_value js_cb, void *context, void *data) {
-  struct req_data *d = (struct req_data *)data;
-  if (!env || !js_cb || !d) return;
-  
-  napi_value req_ptr = NULL, params, val;
-  if (d->req != NULL) {
-    napi_create_double(env, (double)(uintptr_t)d->req, &req_ptr);
-  } else {
-    napi_create_double(env, 0.0, &req_ptr);
+static void req_cache_key_init(void) {
+  pthread_key_create(&req_cache_key, req_cache_destroy);
+}
+
+static struct req_cache *req_thread_cache(void) {
+  pthread_once(&req_cache_once, req_cache_key_init);
+  struct req_cache *c = pthread_getspecific(req_cache_key);
+  if (!c) {
+    c = calloc(1, sizeof(*c));
+    if (c) pthread_setspecific(req_cache_key, c);
   }
-  napi_create_object(env, &params);
-  
-  napi_create_string_utf8(env, d->op, NAPI_AUTO_LENGTH, &val);
-  napi_set_named_property(env, params, "op", val);
-  
-  if (strcmp(d->op, "lookup") == 0) {
-    napi_create_double(env, (double)d->u.lookup.parent, &val);
-    napi_set_named_property(env, params, "parent", val);
-    if (d->u.lookup.name) {
-      napi_create_string_utf8(env, d->u.lookup.name, NAPI_AUTO_LENGTH, &val);
-      napi_set_named_property(env, params, "name", val);
-      free(d->u.lookup.name);
-    }
-  } else if (strcmp(d->op, "getattr") == 0) {
-    napi_create_double(env, (double)d->u.getattr.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.getattr.fh, &val);
-    napi_set_named_property(env, params, "fh", val);
-  } else if (strcmp(d->op, "readdir") == 0) {
-    napi_create_double(env, (double)d->u.readdir.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.readdir.fh, &val);
-    napi_set_named_property(env, params, "fh", val);
-    napi_create_double(env, (double)d->u.readdir.size, &val);
-    napi_set_named_property(env, params, "size", val);
-    napi_create_double(env, (double)d->u.readdir.off, &val);
-    napi_set_named_property(env, params, "off", val);
-  } else if (strcmp(d->op, "open") == 0) {
-    napi_create_double(env, (double)d->u.open.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_uint32(env, d->u.open.flags, &val);
-    napi_set_named_property(env, params, "flags", val);
-  } else if (strcmp(d->op, "read") == 0) {
-    napi_create_double(env, (double)d->u.read.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.read.fh, &val);
-    napi_set_named_property(env, params, "fh", val);
-    napi_create_double(env, (double)d->u.read.size, &val);
-    napi_set_named_property(env, params, "size", val);
-    napi_create_double(env, (double)d->u.read.off, &val);
-    napi_set_named_property(env, params, "off", val);
-  } else if (strcmp(d->op, "write") == 0 || strcmp(d->op, "write_buf") == 0) {
-    napi_create_double(env, (double)d->u.write.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.write.fh, &val);
-    napi_set_named_property(env, params, "fh", val);
-    napi_create_double(env, (double)d->u.write.size, &val);
-    napi_set_named_property(env, params, "size", val);
-    napi_create_double(env, (double)d->u.write.off, &val);
-    napi_set_named_property(env, params, "off", val);
-    if (d->u.write.data_len > 0 && d->u.write.data) {
-      napi_create_buffer_copy(env, d->u.write.data_len, d->u.write.data, NULL, &val);
-      napi_set_named_property(env, params, "data", val);
-      free(d->u.write.data);
-    }
-  } else if (strcmp(d->op, "release") == 0) {
-    napi_create_double(env, (double)d->u.release.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.release.fh, &val);
-    napi_set_named_property(env, params, "fh", val);
-  } else if (strcmp(d->op, "create") == 0) {
-    napi_create_double(env, (double)d->u.create.parent, &val);
-    napi_set_named_property(env, params, "parent", val);
-    if (d->u.create.name) {
-      napi_create_string_utf8(env, d->u.create.name, NAPI_AUTO_LENGTH, &val);
-      napi_set_named_property(env, params, "name", val);
-      free(d->u.create.name);
-    }
-    napi_create_uint32(env, d->u.create.mode, &val);
-    napi_set_named_property(env, params, "mode", val);
-    napi_create_uint32(env, d->u.create.flags, &val);
-    napi_set_named_property(env, params, "flags", val);
-  } else if (strcmp(d->op, "unlink") == 0 || strcmp(d->op, "rmdir") == 0) {
-    napi_create_double(env, (double)d->u.unlink.parent, &val);
-    napi_set_named_property(env, params, "parent", val);
-    if (d->u.unlink.name) {
-      napi_create_string_utf8(env, d->u.unlink.name, NAPI_AUTO_LENGTH, &val);
-      napi_set_named_property(env, params, "name", val);
-      free(d->u.unlink.name);
+  return c;
+}
+
+static struct req_data *req_alloc(fuse_req_t req, enum fuse_op op) {
+  struct req_cache *c = req_thread_cache();
+  struct req_data *d = NULL;
+  if (c) {
+    if (!c->free) {
+      pthread_mutex_lock(&g_slab.lock);
+      // Take at most REQ_THREAD_CACHE so one thread doesn't starve the others
+      struct req_data *head = g_slab.free, *tail = head;
+      size_t n = 0;
+      while (tail && ++n < REQ_THREAD_CACHE && req_link(tail)) tail = req_link(tail);
+      if (tail) {
+        g_slab.free = req_link(tail);
+        g_slab.nfree -= n;
+        req_set_link(tail, NULL);
+      }
+      pthread_mutex_unlock(&g_slab.lock);
+      c->free = head;
+      c->nfree = n;
     }
-  } else if (strcmp(d->op, "mkdir") == 0) {
-    napi_create_double(env, (double)d->u.mkdir.parent, &val);
-    napi_set_named_property(env, params, "parent", val);
-    if (d->u.mkdir.name) {
-      napi_create_string_utf8(env, d->u.mkdir.name, NAPI_AUTO_LENGTH, &val);
-      napi_set_named_property(env, params, "name", val);
-      free(d->u.mkdir.name);
+    d = c->free;
+    if (d) {
+      c->free = req_link(d);
+      c->nfree--;
     }
-    napi_create_uint32(env, d->u.mkdir.mode, &val);
-    napi_set_named_property(env, params, "mode", val);
-  } else if (strcmp(d->op, "rename") == 0) {
-    napi_create_double(env, (double)d->u.rename.parent, &val);
-    napi_set_named_property(env, params, "parent", val);
-    if (d->u.rename.name) {
-      napi_create_string_utf8(env, d->u.rename.name, NAPI_AUTO_LENGTH, &val);
-      napi_set_named_property(env, params, "name", val);
-      free(d->u.rename.name);
+  }
+  if (!d) d = malloc(sizeof(*d));
+  if (!d) return NULL;
+  // The string arena is left uninitialized; strs_used bounds what is valid
+  memset(d, 0, offsetof(struct req_data, strs));
+  d->req = req;
+  d->op = op;
+  return d;
+}
+
+// Copies s into the request's inline arena, falling back to the heap for long strings
+static char *req_strdup(struct req_data *d, const char *s) {
+  size_t len = strlen(s) + 1;
+  if (len > sizeof(d->strs) - d->strs_used) return strdup(s);
+  char *p = d->strs + d->strs_used;
+  memcpy(p, s, len);
+  d->strs_used += len;
+  return p;
+}
+
+static void req_strfree(struct req_data *d, char *s) {
+  if (s < d->strs || s >= d->strs + sizeof(d->strs)) free(s);
+}
+
+// Property names used when marshalling requests and replies. They are created
+// once per env and kept as references so call_js doesn't re-intern them.
+#define PROP_KEYS(X) \
+  X(PARENT, "parent") X(NAME, "name") X(INO, "ino") X(FH, "fh") X(SIZE, "size") \
+  X(OFF, "off") X(FLAGS, "flags") X(DATA, "data") X(MODE, "mode") X(NEWPARENT, "newparent") \
+  X(NEWNAME, "newname") X(TO_SET, "to_set") X(ATTR, "attr") X(DATASYNC, "datasync") \
+  X(LINK, "link") X(RDEV, "rdev") X(MASK, "mask") X(VALUE, "value") X(LOCK, "lock") \
+  X(SLEEP, "sleep") X(OP, "op") X(BLOCKSIZE, "blocksize") X(IDX, "idx") X(CMD, "cmd") \
+  X(IN_BUFSZ, "in_bufsz") X(OUT_BUFSZ, "out_bufsz") X(IN_BUF, "in_buf") X(OFFSET, "offset") \
+  X(LENGTH, "length") X(INO_IN, "ino_in") X(FH_IN, "fh_in") X(OFF_IN, "off_in") \
+  X(INO_OUT, "ino_out") X(FH_OUT, "fh_out") X(OFF_OUT, "off_out") X(LEN, "len") \
+  X(WHENCE, "whence") X(COUNT, "count") X(INOS, "inos") X(NLOOKUPS, "nlookups") \
+  X(NLOOKUP, "nlookup") X(COOKIE, "cookie") X(DEV, "dev") X(NLINK, "nlink") X(UID, "uid") \
+  X(GID, "gid") X(BLKSIZE, "blksize") X(BLOCKS, "blocks") X(ATIME, "atime") \
+  X(MTIME, "mtime") X(CTIME, "ctime") X(TYPE, "type") X(START, "start") X(PID, "pid") \
+  X(STAT, "stat")
+
+#define KEY_ENUM(id, name) KEY_##id,
+enum prop_key { PROP_KEYS(KEY_ENUM) PROP_KEY_COUNT };
+#undef KEY_ENUM
+
+#define KEY_NAME(id, name) name,
+static const char *const key_names[PROP_KEY_COUNT] = { PROP_KEYS(KEY_NAME) };
+#undef KEY_NAME
+
+struct shard;
+
+// A request handed to JS on this thread and not yet replied to
+struct inflight {
+  fuse_req_t req;
+  struct shard *shard;
+  enum fuse_op op;
+  uint64_t delivered_ns;
+  uint64_t attr_gen;         // attr cache generation when the request arrived
+  fuse_ino_t changes_ino;    // inode whose attributes the request changes, or 0
+};
+
+struct addon_data {
+  napi_ref keys[PROP_KEY_COUNT];
+  // Scratch space for directory replies, reused across replies on this thread
+  char *dirbuf;
+  size_t dirbuf_size;
+  // Open-addressed by request pointer; requests are delivered and replied to on the same thread
+  struct inflight *inflight;
+  uint32_t inflight_mask;
+  uint32_t inflight_count;
+  // The reply being made, set by reply_req() for timed_reply()
+  struct inflight replying;
+  uint64_t reply_start_ns;
+  int reply_failed;
+};
+
+static struct addon_data *get_addon_data(napi_env env) {
+  struct addon_data *ad = NULL;
+  napi_get_instance_data(env, (void **)&ad);
+  return ad;
+}
+
+static napi_value get_key(napi_env env, struct addon_data *ad, enum prop_key k) {
+  napi_value key;
+  if (ad && napi_get_reference_value(env, ad->keys[k], &key) == napi_ok && key) {
+    return key;
+  }
+  napi_create_string_utf8(env, key_names[k], NAPI_AUTO_LENGTH, &key);
+  return key;
+}
+
+// Target object for put_value/put_i64
+struct marshal {
+  napi_env env;
+  struct addon_data *ad;
+  napi_value obj;
+};
+
+static void put_value(const struct marshal *m, enum prop_key k, napi_value val) {
+  napi_set_property(m->env, m->obj, get_key(m->env, m->ad, k), val);
+}
+
+static void put_i64(const struct marshal *m, enum prop_key k, int64_t v) {
+  napi_value val;
+  napi_create_int64(m->env, v, &val);
+  put_value(m, k, val);
+}
+
+static void free_external_buffer(napi_env env, void *data, void *hint) {
+  (void)env;
+  (void)hint;
+  free(data);
+}
+
+static int64_t get_i64(napi_env env, struct addon_data *ad, napi_value obj, enum prop_key k) {
+  napi_value val;
+  int64_t num_val = 0;
+  if (napi_get_property(env, obj, get_key(env, ad, k), &val) == napi_ok) {
+    napi_get_value_int64(env, val, &num_val);
+  }
+  return num_val;
+}
+
+static void fuse_serialize_stat(const struct marshal *m, const struct stat *st);
+static void fuse_parse_stat(napi_env env, napi_value stat_obj, struct stat *st);
+
+// Requests are queued on an intrusive MPSC queue (Vyukov) by the FUSE threads
+// and drained on the JS thread in batches. Only the first push after a drain
+// goes through napi_call_threadsafe_function.
+struct req_queue {
+  _Atomic(struct req_data *) head;
+  struct req_data *tail;  // consumer side, JS thread only
+  struct req_data stub;
+};
+
+static void req_queue_init(struct req_queue *q) {
+  atomic_store_explicit(&q->stub.next, NULL, memory_order_relaxed);
+  atomic_store_explicit(&q->head, &q->stub, memory_order_relaxed);
+  q->tail = &q->stub;
+}
+
+static void req_queue_push(struct req_queue *q, struct req_data *d) {
+  atomic_store_explicit(&d->next, NULL, memory_order_relaxed);
+  struct req_data *prev = atomic_exchange_explicit(&q->head, d, memory_order_acq_rel);
+  atomic_store_explicit(&prev->next, d, memory_order_release);
+}
+
+// Returns NULL when empty, or while a producer is between its exchange and link
+static struct req_data *req_queue_pop(struct req_queue *q) {
+  struct req_data *tail = q->tail;
+  struct req_data *next = atomic_load_explicit(&tail->next, memory_order_acquire);
+  if (tail == &q->stub) {
+    if (!next) return NULL;
+    q->tail = next;
+    tail = next;
+    next = atomic_load_explicit(&next->next, memory_order_acquire);
+  }
+  if (next) {
+    q->tail = next;
+    return tail;
+  }
+  if (tail != atomic_load_explicit(&q->head, memory_order_acquire)) return NULL;
+  req_queue_push(q, &q->stub);
+  next = atomic_load_explicit(&tail->next, memory_order_acquire);
+  if (next) {
+    q->tail = next;
+    return tail;
+  }
+  return NULL;
+}
+
+static int req_queue_pending(struct req_queue *q) {
+  struct req_data *head = atomic_load_explicit(&q->head, memory_order_acquire);
+  return head != q->tail || atomic_load_explicit(&q->tail->next, memory_order_acquire) != NULL;
+}
+
+// Optional userspace attribute/dentry cache. lookup and getattr hits are answered on
+// the FUSE thread without a round trip to JS. Entries come from lookup, getattr and
+// readdirplus replies. Requests that may change an inode and the kernel notifications
+// JS sends drop its entries and stamp its generation; a reply is only cached when its
+// inode wasn't stamped after the request was queued, so one that raced a change (or
+// whose own request changed it) never goes back in.
+#define ATTR_CACHE_BUCKETS 4096
+
+struct cached_attr {
+  struct cached_attr *next;
+  fuse_ino_t ino;
+  struct stat st;
+  double attr_timeout;       // timeout handed to the kernel on a hit
+  double expires;
+};
+
+struct cached_dentry {
+  struct cached_dentry *next;
+  fuse_ino_t parent;
+  uint64_t hash;
+  fuse_ino_t ino;
+  double entry_timeout;
+  double expires;
+  char name[];
+};
+
+// Replies to lookup, getattr and readdirplus can race a change to the same inode: JS
+// may read the attributes before a write lands and reply after it was acknowledged.
+// Every change stamps its inode's slot in gens from clock, when it arrives and again
+// when it is replied to, and a reply is only stored if none of its inodes was stamped
+// after the request arrived. Slots are shared by inodes of a bucket, which at worst
+// skips a store.
+struct attr_cache {
+  pthread_rwlock_t lock;
+  atomic_size_t count;       // read without the lock to skip empty caches
+  size_t max_entries;
+  atomic_uint_fast64_t clock;
+  atomic_uint_fast64_t gens[ATTR_CACHE_BUCKETS];
+  struct cached_attr *attrs[ATTR_CACHE_BUCKETS];
+  struct cached_dentry *dentries[ATTR_CACHE_BUCKETS];
+};
+
+// Per-op latency histograms, log-linear like HdrHistogram: four sub-buckets per power
+// of two from 1us to 2^36 ns (~69s), everything under 1us in bucket 0
+#define HIST_MIN_SHIFT 10
+#define HIST_MAX_SHIFT 36
+#define HIST_SUB_BITS 2
+#define HIST_BUCKETS (1 + (HIST_MAX_SHIFT - HIST_MIN_SHIFT) * (1 << HIST_SUB_BITS))
+
+// queue: FUSE thread to JS, js: delivery to the reply call, reply: inside the reply call
+enum req_phase { PHASE_QUEUE, PHASE_JS, PHASE_REPLY, PHASE_COUNT };
+static const char *const phase_names[PHASE_COUNT] = { "queue", "js", "reply" };
+
+struct histogram {
+  atomic_uint_fast64_t count;
+  atomic_uint_fast64_t sum_ns;
+  atomic_uint_fast64_t max_ns;
+  atomic_uint_fast64_t buckets[HIST_BUCKETS];
+};
+
+struct op_stats {
+  atomic_uint_fast64_t errors;
+  struct histogram phases[PHASE_COUNT];
+};
+
+struct mount_ctx;
+
+// A JS thread that requests are delivered to, with its own lanes: the thread that
+// called mount(), or a worker_thread attached with attach_worker()
+struct shard {
+  struct mount_ctx *mount;
+  napi_threadsafe_function tsfn;
+  struct req_queue lanes[LANE_COUNT];
+  atomic_int drain_scheduled;
+  // OP_COUNT entries, written only from this shard's JS thread
+  struct op_stats *stats;
+};
+
+// Admission state of one lane, summed over the mount's shards
+struct lane_state {
+  atomic_uint depth;         // admitted and not yet replied to, queued or in JS
+  atomic_uint inflight;      // the part of depth handed to JS
+  atomic_uint waiting;       // FUSE threads blocked until the lane has room
+  atomic_uint_fast64_t throttled;  // times a FUSE thread had to wait
+};
+
+// Backing ids registered for open files, keyed by (ino, fh) and hashed by ino alone so
+// backing_open() can tell whether any handle of an inode bypasses JS. The kernel only
+// takes its own reference once the open completes, so an id is closed at release.
+#define BACKING_BUCKETS 256
+
+struct backing_file {
+  uint64_t ino;
+  uint64_t fh;
+  int id;
+  struct backing_file *next;
+};
+
+struct backing_table {
+  pthread_mutex_t lock;
+  struct backing_file *buckets[BACKING_BUCKETS];
+};
+
+enum loop_state { LOOP_RUNNING, LOOP_DONE, LOOP_ORPHANED };
+
+// Everything one mount owns. FUSE callbacks find it through fuse_req_userdata, the
+// JS side holds it as an external returned by mount() and passes it to unmount()
+// and the notify_* calls. It is freed once the mount's threadsafe functions have
+// been finalized and JS has dropped the handle.
+struct mount_ctx {
+  struct mount_config config;
+  struct fuse_session *session;
+  // Held for reading while a notification uses session, and for writing while it is destroyed
+  pthread_rwlock_t session_lock;
+  pthread_t thread;          // joined by unmount(), or left to finish on its own
+  int thread_started;
+  atomic_int loop_state;     // enum loop_state
+  atomic_int running;
+  napi_ref self;             // keeps the handle alive until the main tsfn is finalized
+  atomic_int refs;           // the handle plus one per attached worker
+  uint32_t id;               // workers attach by id, since the handle can't cross isolates
+  struct mount_ctx *next_live;
+  struct shard main;
+  struct shard *workers;     // config.workers entries
+  atomic_uint next_worker;   // round-robin cursor
+  struct lane_state lanes[LANE_COUNT];
+  pthread_mutex_t admit_lock;
+  pthread_cond_t admit_cond;
+  uint32_t admit_waiters;    // FUSE threads blocked in lane_admit, under admit_lock
+  atomic_int closing;        // set by unmount(); admission stops waiting
+  atomic_int io_uring;       // set at INIT when the kernel took the io_uring transport
+  atomic_int passthrough;    // set at INIT when the kernel accepted FUSE_CAP_PASSTHROUGH
+  struct backing_table backing;
+  struct attr_cache cache;
+};
+
+// Live mounts, for attach_worker()
+static pthread_mutex_t g_mounts_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct mount_ctx *g_mounts = NULL;
+static uint32_t g_next_mount_id = 1;
+
+static struct mount_ctx *req_mount(fuse_req_t req) {
+  return (struct mount_ctx *)fuse_req_userdata(req);
+}
+
+static struct attr_cache *req_cache(fuse_req_t req) {
+  return &req_mount(req)->cache;
+}
+
+static const struct mount_config *req_config(fuse_req_t req) {
+  return &req_mount(req)->config;
+}
+
+static struct backing_file **backing_bucket(struct backing_table *t, uint64_t ino) {
+  return &t->buckets[((ino * 0x9E3779B97F4A7C15ULL) >> 32) % BACKING_BUCKETS];
+}
+
+static void backing_put(struct backing_table *t, uint64_t ino, uint64_t fh, int id) {
+  struct backing_file *b = malloc(sizeof(*b));
+  if (!b) return;
+  b->ino = ino;
+  b->fh = fh;
+  b->id = id;
+  pthread_mutex_lock(&t->lock);
+  struct backing_file **head = backing_bucket(t, ino);
+  b->next = *head;
+  *head = b;
+  pthread_mutex_unlock(&t->lock);
+}
+
+// Removes the id registered for (ino, fh), or returns 0 if there is none
+static int backing_take(struct backing_table *t, uint64_t ino, uint64_t fh) {
+  int id = 0;
+  pthread_mutex_lock(&t->lock);
+  for (struct backing_file **p = backing_bucket(t, ino); *p; p = &(*p)->next) {
+    if ((*p)->ino == ino && (*p)->fh == fh) {
+      struct backing_file *b = *p;
+      *p = b->next;
+      id = b->id;
+      free(b);
+      break;
     }
-    napi_create_double(env, (double)d->u.rename.newparent, &val);
-    napi_set_named_property(env, params, "newparent", val);
-    if (d->u.rename.newname) {
-      napi_create_string_utf8(env, d->u.rename.newname, NAPI_AUTO_LENGTH, &val);
-      napi_set_named_property(env, params, "newname", val);
-      free(d->u.rename.newname);
+  }
+  pthread_mutex_unlock(&t->lock);
+  return id;
+}
+
+// Whether some open handle of ino reads and writes through a backing id
+static bool backing_open(struct backing_table *t, uint64_t ino) {
+  bool found = false;
+  pthread_mutex_lock(&t->lock);
+  for (struct backing_file *b = *backing_bucket(t, ino); b && !found; b = b->next) found = b->ino == ino;
+  pthread_mutex_unlock(&t->lock);
+  return found;
+}
+
+// Ids still registered die with the session's /dev/fuse fd; only the entries are freed
+static void backing_clear(struct backing_table *t) {
+  for (int i = 0; i < BACKING_BUCKETS; i++) {
+    while (t->buckets[i]) {
+      struct backing_file *b = t->buckets[i];
+      t->buckets[i] = b->next;
+      free(b);
     }
-    napi_create_uint32(env, d->u.rename.flags, &val);
-    napi_set_named_property(env, params, "flags", val);
-  } else if (strcmp(d->op, "setattr") == 0) {
-    napi_create_double(env, (double)d->u.setattr.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_int32(env, d->u.setattr.to_set, &val);
-    napi_set_named_property(env, params, "to_set", val);
-    napi_value attr_obj;
-    napi_create_object(env, &attr_obj);
-    fuse_serialize_stat(env, &d->u.setattr.attr, attr_obj);
-    napi_set_named_property(env, params, "attr", attr_obj);
-    napi_create_double(env, (double)d->u.setattr.fh, &val);
-    napi_set_named_property(env, params, "fh", val);
-  } else if (strcmp(d->op, "flush") == 0) {
-    napi_create_double(env, (double)d->u.flush.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.flush.fh, &val);
-    napi_set_named_property(env, params, "fh", val);
-  } else if (strcmp(d->op, "fsync") == 0) {
-    napi_create_double(env, (double)d->u.fsync.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.fsync.fh, &val);
-    napi_set_named_property(env, params, "fh", val);
-    napi_create_int32(env, d->u.fsync.datasync, &val);
-    napi_set_named_property(env, params, "datasync", val);
-  } else if (strcmp(d->op, "opendir") == 0) {
-    napi_create_double(env, (double)d->u.opendir.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_uint32(env, d->u.opendir.flags, &val);
-    napi_set_named_property(env, params, "flags", val);
-  } else if (strcmp(d->op, "releasedir") == 0) {
-    napi_create_double(env, (double)d->u.releasedir.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.releasedir.fh, &val);
-    napi_set_named_property(env, params, "fh", val);
-  } else if (strcmp(d->op, "fsyncdir") == 0) {
-    napi_create_double(env, (double)d->u.fsyncdir.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.fsyncdir.fh, &val);
-    napi_set_named_property(env, params, "fh", val);
-    napi_create_int32(env, d->u.fsyncdir.datasync, &val);
-    napi_set_named_property(env, params, "datasync", val);
-  } else if (strcmp(d->op, "readlink") == 0) {
-    napi_create_double(env, (double)d->u.readlink.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-  } else if (strcmp(d->op, "symlink") == 0) {
-    if (d->u.symlink.link) {
-      napi_create_string_utf8(env, d->u.symlink.link, NAPI_AUTO_LENGTH, &val);
-      napi_set_named_property(env, params, "link", val);
-      free(d->u.symlink.link);
+  }
+}
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Stats have a single writer, so a relaxed load and store is enough; stats() reads
+// them from whichever thread asks
+static void counter_add(atomic_uint_fast64_t *c, uint64_t n) {
+  atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+static unsigned hist_bucket(uint64_t ns) {
+  if (ns < (1ull << HIST_MIN_SHIFT)) return 0;
+  if (ns >= (1ull << HIST_MAX_SHIFT)) return HIST_BUCKETS - 1;
+  unsigned e = 63 - (unsigned)__builtin_clzll(ns);
+  unsigned sub = (unsigned)(ns >> (e - HIST_SUB_BITS)) & ((1u << HIST_SUB_BITS) - 1);
+  return 1 + (e - HIST_MIN_SHIFT) * (1u << HIST_SUB_BITS) + sub;
+}
+
+// Largest value that lands in bucket b
+static uint64_t hist_bucket_max(unsigned b) {
+  if (b == 0) return (1ull << HIST_MIN_SHIFT) - 1;
+  b--;
+  unsigned e = HIST_MIN_SHIFT + b / (1u << HIST_SUB_BITS);
+  unsigned sub = b % (1u << HIST_SUB_BITS);
+  return (1ull << e) + ((uint64_t)(sub + 1) << (e - HIST_SUB_BITS)) - 1;
+}
+
+static void hist_record(struct histogram *h, uint64_t ns) {
+  counter_add(&h->count, 1);
+  counter_add(&h->sum_ns, ns);
+  if (ns > atomic_load_explicit(&h->max_ns, memory_order_relaxed)) {
+    atomic_store_explicit(&h->max_ns, ns, memory_order_relaxed);
+  }
+  counter_add(&h->buckets[hist_bucket(ns)], 1);
+}
+
+static uint32_t inflight_slot(const struct addon_data *ad, fuse_req_t req) {
+  return (uint32_t)(((uint64_t)(uintptr_t)req * 11400714819323198485ULL) >> 32) & ad->inflight_mask;
+}
+
+static void inflight_insert(struct addon_data *ad, const struct inflight *e) {
+  uint32_t i = inflight_slot(ad, e->req);
+  while (ad->inflight[i].req && ad->inflight[i].req != e->req) i = (i + 1) & ad->inflight_mask;
+  if (!ad->inflight[i].req) ad->inflight_count++;
+  ad->inflight[i] = *e;
+}
+
+// Remembers a delivered request until its reply. Entries for requests that are never
+// replied to from JS stay until the pointer is reused. Returns 0 if out of memory.
+static int inflight_put(struct addon_data *ad, const struct inflight *e) {
+  if ((ad->inflight_count + 1) * 2 > ad->inflight_mask + 1 || !ad->inflight) {
+    uint32_t size = ad->inflight ? (ad->inflight_mask + 1) * 2 : 256;
+    struct inflight *table = calloc(size, sizeof(*table));
+    if (!table) return 0;
+    struct inflight *old = ad->inflight;
+    uint32_t old_size = old ? ad->inflight_mask + 1 : 0;
+    ad->inflight = table;
+    ad->inflight_mask = size - 1;
+    ad->inflight_count = 0;
+    for (uint32_t i = 0; i < old_size; i++) {
+      if (old[i].req) inflight_insert(ad, &old[i]);
     }
-    napi_create_double(env, (double)d->u.symlink.parent, &val);
-    napi_set_named_property(env, params, "parent", val);
-    if (d->u.symlink.name) {
-      napi_create_string_utf8(env, d->u.symlink.name, NAPI_AUTO_LENGTH, &val);
-      napi_set_named_property(env, params, "name", val);
-      free(d->u.symlink.name);
+    free(old);
+  }
+  inflight_insert(ad, e);
+  return 1;
+}
+
+// Removes req's entry into out, shifting later entries of its probe run back
+static int inflight_take(struct addon_data *ad, fuse_req_t req, struct inflight *out) {
+  if (!ad->inflight || !req) return 0;
+  uint32_t i = inflight_slot(ad, req);
+  while (ad->inflight[i].req != req) {
+    if (!ad->inflight[i].req) return 0;
+    i = (i + 1) & ad->inflight_mask;
+  }
+  *out = ad->inflight[i];
+  for (uint32_t j = (i + 1) & ad->inflight_mask; ad->inflight[j].req; j = (j + 1) & ad->inflight_mask) {
+    uint32_t home = inflight_slot(ad, ad->inflight[j].req);
+    // Move j into the hole unless its home slot lies cyclically in (i, j]
+    if (((j - home) & ad->inflight_mask) >= ((j - i) & ad->inflight_mask)) {
+      ad->inflight[i] = ad->inflight[j];
+      i = j;
     }
-  } else if (strcmp(d->op, "link") == 0) {
-    napi_create_double(env, (double)d->u.link.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.link.newparent, &val);
-    napi_set_named_property(env, params, "newparent", val);
-    if (d->u.link.newname) {
-      napi_create_string_utf8(env, d->u.link.newname, NAPI_AUTO_LENGTH, &val);
-      napi_set_named_property(env, params, "newname", val);
-      free(d->u.link.newname);
+  }
+  ad->inflight[i].req = NULL;
+  ad->inflight_count--;
+  return 1;
+}
+
+static int shard_pending(struct shard *sh) {
+  for (int l = 0; l < LANE_COUNT; l++) {
+    if (req_queue_pending(&sh->lanes[l])) return 1;
+  }
+  return 0;
+}
+
+// Asks the shard's JS thread to drain its lanes unless a drain is already pending
+static napi_status schedule_drain(struct shard *sh) {
+  int expected = 0;
+  if (!atomic_compare_exchange_strong_explicit(&sh->drain_scheduled, &expected, 1, memory_order_acq_rel, memory_order_acquire)) {
+    return napi_ok;
+  }
+  napi_status status = napi_call_threadsafe_function(sh->tsfn, NULL, napi_tsfn_nonblocking);
+  if (status != napi_ok) {
+    atomic_store_explicit(&sh->drain_scheduled, 0, memory_order_release);
+  }
+  return status;
+}
+
+// Batch descriptor layout, shared with src/batch.ts: DESC_STRIDE doubles per
+// request holding the request pointer, opcode, index of the request's first
+// entry in the extras array, then up to DESC_ARGS numeric arguments.
+// Strings, buffers and objects go to the extras array in a fixed order per op.
+#define DESC_STRIDE 12
+#define DESC_ARGS (DESC_STRIDE - 3)
+
+struct batch_writer {
+  napi_env env;
+  struct addon_data *ad;
+  napi_value extras;
+  uint32_t nextras;
+};
+
+static void push_extra(struct batch_writer *w, napi_value val) {
+  napi_set_element(w->env, w->extras, w->nextras++, val);
+}
+
+static void push_undefined(struct batch_writer *w) {
+  napi_value val;
+  napi_get_undefined(w->env, &val);
+  push_extra(w, val);
+}
+
+// Takes ownership of s
+static void push_str(struct batch_writer *w, const char *s) {
+  if (!s) {
+    push_undefined(w);
+    return;
+  }
+  napi_value val;
+  napi_create_string_utf8(w->env, s, NAPI_AUTO_LENGTH, &val);
+  push_extra(w, val);
+}
+
+// Takes ownership of data. The malloc'd payload is handed to JS as an external
+// buffer and freed by its finalizer; runtimes that don't allow external buffers
+// get a copy instead.
+static void push_buffer(struct batch_writer *w, void *data, size_t len) {
+  if (!data || len == 0) {
+    free(data);
+    push_undefined(w);
+    return;
+  }
+  napi_value val;
+  if (napi_create_external_buffer(w->env, len, data, free_external_buffer, NULL, &val) != napi_ok) {
+    napi_create_buffer_copy(w->env, len, data, NULL, &val);
+    free(data);
+  }
+  push_extra(w, val);
+}
+
+static void push_f64_array(struct batch_writer *w, size_t count, const uint64_t *src, const fuse_ino_t *inos) {
+  napi_value ab, arr;
+  double *out = NULL;
+  napi_create_arraybuffer(w->env, count * sizeof(double), (void **)&out, &ab);
+  for (size_t i = 0; i < count; i++) {
+    out[i] = src ? (double)src[i] : (double)inos[i];
+  }
+  napi_create_typedarray(w->env, napi_float64_array, count, ab, 0, &arr);
+  push_extra(w, arr);
+}
+
+// Writes one request into its descriptor slot and appends its extras
+static void encode_request(struct batch_writer *w, struct req_data *d, double *slot) {
+  double *a = slot + 3;
+  slot[0] = (double)(uintptr_t)d->req;
+  slot[1] = (double)d->op;
+  slot[2] = (double)w->nextras;
+  
+  switch (d->op) {
+    case OP_INIT:
+    case OP_DESTROY:
+      break;
+    case OP_LOOKUP:
+      a[0] = (double)d->u.lookup.parent;
+      push_str(w, d->u.lookup.name);
+      break;
+    case OP_FORGET:
+      a[0] = (double)d->u.forget.ino;
+      a[1] = (double)d->u.forget.nlookup;
+      break;
+    case OP_FORGET_MULTI: {
+      size_t count = (d->u.forget_multi.inos && d->u.forget_multi.nlookups) ? d->u.forget_multi.count : 0;
+      a[0] = (double)count;
+      push_f64_array(w, count, NULL, d->u.forget_multi.inos);
+      push_f64_array(w, count, d->u.forget_multi.nlookups, NULL);
+      break;
     }
-  } else if (strcmp(d->op, "mknod") == 0) {
-    napi_create_double(env, (double)d->u.mknod.parent, &val);
-    napi_set_named_property(env, params, "parent", val);
-    if (d->u.mknod.name) {
-      napi_create_string_utf8(env, d->u.mknod.name, NAPI_AUTO_LENGTH, &val);
-      napi_set_named_property(env, params, "name", val);
-      free(d->u.mknod.name);
+    case OP_GETATTR:
+      a[0] = (double)d->u.getattr.ino;
+      a[1] = (double)d->u.getattr.fh;
+      break;
+    case OP_SETATTR: {
+      a[0] = (double)d->u.setattr.ino;
+      a[1] = (double)d->u.setattr.to_set;
+      a[2] = (double)d->u.setattr.fh;
+      napi_value attr_obj;
+      napi_create_object(w->env, &attr_obj);
+      struct marshal am = { w->env, w->ad, attr_obj };
+      fuse_serialize_stat(&am, &d->u.setattr.attr);
+      push_extra(w, attr_obj);
+      break;
     }
-    napi_create_uint32(env, d->u.mknod.mode, &val);
-    napi_set_named_property(env, params, "mode", val);
-    napi_create_double(env, (double)d->u.mknod.rdev, &val);
-    napi_set_named_property(env, params, "rdev", val);
-  } else if (strcmp(d->op, "access") == 0) {
-    napi_create_double(env, (double)d->u.access.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_int32(env, d->u.access.mask, &val);
-    napi_set_named_property(env, params, "mask", val);
-  } else if (strcmp(d->op, "statfs") == 0) {
-    napi_create_double(env, (double)d->u.statfs.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.statfs.fh, &val);
-    napi_set_named_property(env, params, "fh", val);
-  } else if (strcmp(d->op, "setxattr") == 0) {
-    napi_create_double(env, (double)d->u.setxattr.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    if (d->u.setxattr.name) {
-      napi_create_string_utf8(env, d->u.setxattr.name, NAPI_AUTO_LENGTH, &val);
-      napi_set_named_property(env, params, "name", val);
-      free(d->u.setxattr.name);
+    case OP_READLINK:
+      a[0] = (double)d->u.readlink.ino;
+      break;
+    case OP_MKNOD:
+      a[0] = (double)d->u.mknod.parent;
+      a[1] = (double)d->u.mknod.mode;
+      a[2] = (double)d->u.mknod.rdev;
+      push_str(w, d->u.mknod.name);
+      break;
+    case OP_MKDIR:
+      a[0] = (double)d->u.mkdir.parent;
+      a[1] = (double)d->u.mkdir.mode;
+      push_str(w, d->u.mkdir.name);
+      break;
+    case OP_UNLINK:
+    case OP_RMDIR:
+      a[0] = (double)d->u.unlink.parent;
+      push_str(w, d->u.unlink.name);
+      break;
+    case OP_SYMLINK:
+      a[0] = (double)d->u.symlink.parent;
+      push_str(w, d->u.symlink.link);
+      push_str(w, d->u.symlink.name);
+      break;
+    case OP_RENAME:
+      a[0] = (double)d->u.rename.parent;
+      a[1] = (double)d->u.rename.newparent;
+      a[2] = (double)d->u.rename.flags;
+      push_str(w, d->u.rename.name);
+      push_str(w, d->u.rename.newname);
+      break;
+    case OP_LINK:
+      a[0] = (double)d->u.link.ino;
+      a[1] = (double)d->u.link.newparent;
+      push_str(w, d->u.link.newname);
+      break;
+    case OP_OPEN:
+      a[0] = (double)d->u.open.ino;
+      a[1] = (double)d->u.open.flags;
+      break;
+    case OP_READ:
+      a[0] = (double)d->u.read.ino;
+      a[1] = (double)d->u.read.fh;
+      a[2] = (double)d->u.read.size;
+      a[3] = (double)d->u.read.off;
+      break;
+    case OP_WRITE:
+    case OP_WRITE_BUF:
+      a[0] = (double)d->u.write.ino;
+      a[1] = (double)d->u.write.fh;
+      a[2] = (double)d->u.write.size;
+      a[3] = (double)d->u.write.off;
+      push_buffer(w, d->u.write.data, d->u.write.data_len);
+      d->u.write.data = NULL;
+      break;
+    case OP_FLUSH:
+      a[0] = (double)d->u.flush.ino;
+      a[1] = (double)d->u.flush.fh;
+      break;
+    case OP_RELEASE:
+      a[0] = (double)d->u.release.ino;
+      a[1] = (double)d->u.release.fh;
+      break;
+    case OP_FSYNC:
+      a[0] = (double)d->u.fsync.ino;
+      a[1] = (double)d->u.fsync.fh;
+      a[2] = (double)d->u.fsync.datasync;
+      break;
+    case OP_OPENDIR:
+      a[0] = (double)d->u.opendir.ino;
+      a[1] = (double)d->u.opendir.flags;
+      break;
+    case OP_READDIR:
+    case OP_READDIRPLUS:
+      a[0] = (double)d->u.readdir.ino;
+      a[1] = (double)d->u.readdir.fh;
+      a[2] = (double)d->u.readdir.size;
+      a[3] = (double)d->u.readdir.off;
+      break;
+    case OP_RELEASEDIR:
+      a[0] = (double)d->u.releasedir.ino;
+      a[1] = (double)d->u.releasedir.fh;
+      break;
+    case OP_FSYNCDIR:
+      a[0] = (double)d->u.fsyncdir.ino;
+      a[1] = (double)d->u.fsyncdir.fh;
+      a[2] = (double)d->u.fsyncdir.datasync;
+      break;
+    case OP_STATFS:
+      a[0] = (double)d->u.statfs.ino;
+      a[1] = (double)d->u.statfs.fh;
+      break;
+    case OP_SETXATTR:
+      a[0] = (double)d->u.setxattr.ino;
+      a[1] = (double)d->u.setxattr.size;
+      a[2] = (double)d->u.setxattr.flags;
+      push_str(w, d->u.setxattr.name);
+      push_buffer(w, d->u.setxattr.value, d->u.setxattr.size);
+      d->u.setxattr.value = NULL;
+      break;
+    case OP_GETXATTR:
+      a[0] = (double)d->u.getxattr.ino;
+      a[1] = (double)d->u.getxattr.size;
+      push_str(w, d->u.getxattr.name);
+      break;
+    case OP_LISTXATTR:
+      a[0] = (double)d->u.listxattr.ino;
+      a[1] = (double)d->u.listxattr.size;
+      break;
+    case OP_REMOVEXATTR:
+      a[0] = (double)d->u.removexattr.ino;
+      push_str(w, d->u.removexattr.name);
+      break;
+    case OP_ACCESS:
+      a[0] = (double)d->u.access.ino;
+      a[1] = (double)d->u.access.mask;
+      break;
+    case OP_CREATE:
+      a[0] = (double)d->u.create.parent;
+      a[1] = (double)d->u.create.mode;
+      a[2] = (double)d->u.create.flags;
+      push_str(w, d->u.create.name);
+      break;
+    case OP_GETLK:
+    case OP_SETLK:
+      a[0] = (double)d->u.getlk.ino;
+      a[1] = (double)d->u.getlk.fh;
+      a[2] = (double)d->u.getlk.lock.l_type;
+      a[3] = (double)d->u.getlk.lock.l_whence;
+      a[4] = (double)d->u.getlk.lock.l_start;
+      a[5] = (double)d->u.getlk.lock.l_len;
+      a[6] = (double)d->u.getlk.lock.l_pid;
+      if (d->op == OP_SETLK) a[7] = (double)d->u.setlk.sleep;
+      break;
+    case OP_FLOCK:
+      a[0] = (double)d->u.flock.ino;
+      a[1] = (double)d->u.flock.fh;
+      a[2] = (double)d->u.flock.op;
+      break;
+    case OP_BMAP:
+      a[0] = (double)d->u.bmap.ino;
+      a[1] = (double)d->u.bmap.blocksize;
+      a[2] = (double)d->u.bmap.idx;
+      break;
+    case OP_IOCTL:
+      a[0] = (double)d->u.ioctl.ino;
+      a[1] = (double)d->u.ioctl.cmd;
+      a[2] = (double)d->u.ioctl.in_bufsz;
+      a[3] = (double)d->u.ioctl.out_bufsz;
+      a[4] = (double)d->u.ioctl.flags;
+      a[5] = (double)d->u.ioctl.fh;
+      push_buffer(w, d->u.ioctl.in_buf, d->u.ioctl.in_bufsz);
+      d->u.ioctl.in_buf = NULL;
+      break;
+    case OP_POLL:
+      a[0] = (double)d->u.poll.ino;
+      a[1] = (double)d->u.poll.fh;
+      break;
+    case OP_FALLOCATE:
+      a[0] = (double)d->u.fallocate.ino;
+      a[1] = (double)d->u.fallocate.fh;
+      a[2] = (double)d->u.fallocate.offset;
+      a[3] = (double)d->u.fallocate.length;
+      a[4] = (double)d->u.fallocate.mode;
+      break;
+    case OP_COPY_FILE_RANGE:
+      a[0] = (double)d->u.copy_file_range.ino_in;
+      a[1] = (double)d->u.copy_file_range.fh_in;
+      a[2] = (double)d->u.copy_file_range.off_in;
+      a[3] = (double)d->u.copy_file_range.ino_out;
+      a[4] = (double)d->u.copy_file_range.fh_out;
+      a[5] = (double)d->u.copy_file_range.off_out;
+      a[6] = (double)d->u.copy_file_range.len;
+      a[7] = (double)d->u.copy_file_range.flags;
+      break;
+    case OP_LSEEK:
+      a[0] = (double)d->u.lseek.ino;
+      a[1] = (double)d->u.lseek.fh;
+      a[2] = (double)d->u.lseek.off;
+      a[3] = (double)d->u.lseek.whence;
+      break;
+    case OP_TMPFILE:
+      a[0] = (double)d->u.tmpfile.parent;
+      a[1] = (double)d->u.tmpfile.mode;
+      a[2] = (double)d->u.tmpfile.flags;
+      break;
+    case OP_STATX:
+      a[0] = (double)d->u.statx.ino;
+      a[1] = (double)d->u.statx.flags;
+      a[2] = (double)d->u.statx.mask;
+      break;
+    case OP_RETRIEVE_REPLY:
+      a[0] = (double)d->u.retrieve_reply.ino;
+      a[1] = (double)(uintptr_t)d->u.retrieve_reply.cookie;
+      a[2] = (double)d->u.retrieve_reply.offset;
+      push_buffer(w, d->u.retrieve_reply.data, d->u.retrieve_reply.data_len);
+      d->u.retrieve_reply.data = NULL;
+      break;
+    case OP_COUNT:
+      break;
+  }
+}
+
+// Frees whatever the request still owns: heap names and payloads not yet handed to JS
+static void req_clear(struct req_data *d) {
+  switch (d->op) {
+    case OP_LOOKUP: req_strfree(d, d->u.lookup.name); break;
+    case OP_MKNOD: req_strfree(d, d->u.mknod.name); break;
+    case OP_MKDIR: req_strfree(d, d->u.mkdir.name); break;
+    case OP_UNLINK:
+    case OP_RMDIR: req_strfree(d, d->u.unlink.name); break;
+    case OP_SYMLINK: req_strfree(d, d->u.symlink.link); req_strfree(d, d->u.symlink.name); break;
+    case OP_RENAME: req_strfree(d, d->u.rename.name); req_strfree(d, d->u.rename.newname); break;
+    case OP_LINK: req_strfree(d, d->u.link.newname); break;
+    case OP_WRITE:
+    case OP_WRITE_BUF: free(d->u.write.data); break;
+    case OP_SETXATTR: req_strfree(d, d->u.setxattr.name); free(d->u.setxattr.value); break;
+    case OP_GETXATTR: req_strfree(d, d->u.getxattr.name); break;
+    case OP_REMOVEXATTR: req_strfree(d, d->u.removexattr.name); break;
+    case OP_CREATE: req_strfree(d, d->u.create.name); break;
+    case OP_IOCTL: free(d->u.ioctl.in_buf); break;
+    case OP_FORGET_MULTI: free(d->u.forget_multi.inos); free(d->u.forget_multi.nlookups); break;
+    case OP_RETRIEVE_REPLY: free(d->u.retrieve_reply.data); break;
+    default: break;
+  }
+}
+
+static void free_req_data(struct req_data *d) {
+  req_clear(d);
+  req_slab_put(d, d, 1);
+}
+
+// Requests that were never delivered still need a reply so the kernel doesn't hang
+static void fail_req_data(struct req_data *d) {
+  fuse_req_t req = d->req;
+  enum fuse_op op = d->op;
+  free_req_data(d);
+  if (!req) return;
+  if (op == OP_FORGET || op == OP_FORGET_MULTI || op == OP_RETRIEVE_REPLY) {
+    fuse_reply_none(req);
+  } else {
+    fuse_reply_err(req, EIO);
+  }
+}
+
+// The inode whose cached attributes a request invalidates again once it is replied to
+static fuse_ino_t req_changed_ino(const struct req_data *d) {
+  switch (d->op) {
+    case OP_WRITE: return d->u.write.ino;
+    case OP_WRITE_BUF: return d->u.write_buf.ino;
+    case OP_SETATTR: return d->u.setattr.ino;
+    case OP_FALLOCATE: return d->u.fallocate.ino;
+    case OP_COPY_FILE_RANGE: return d->u.copy_file_range.ino_out;
+    case OP_OPEN: return (d->u.open.flags & O_TRUNC) ? d->u.open.ino : 0;
+    default: return 0;
+  }
+}
+
+static enum req_lane op_lane(enum fuse_op op) {
+  switch (op) {
+    case OP_READ: return LANE_READ;
+    case OP_WRITE:
+    case OP_WRITE_BUF:
+    case OP_FALLOCATE:
+    case OP_COPY_FILE_RANGE: return LANE_WRITE;
+    case OP_FORGET:
+    case OP_FORGET_MULTI:
+    case OP_FSYNC:
+    case OP_FSYNCDIR:
+    case OP_RETRIEVE_REPLY: return LANE_BACKGROUND;
+    default: return LANE_METADATA;
+  }
+}
+
+// Reserves a slot in the request's lane, blocking the calling FUSE thread while the
+// lane is full. Lifecycle requests and retrieve replies are never held back, and
+// nothing waits once unmount() has started. The last loop thread still reading from
+// the kernel never waits either: it takes the slot over the limit, so a full lane
+// can't stall the others (with a single-threaded loop, limits never block).
+static void lane_admit(struct mount_ctx *m, enum fuse_op op) {
+  enum req_lane lane = op_lane(op);
+  struct lane_state *ls = &m->lanes[lane];
+  uint32_t limit = m->config.queue_limits[lane];
+  if (!limit || op == OP_INIT || op == OP_DESTROY || op == OP_RETRIEVE_REPLY) {
+    atomic_fetch_add(&ls->depth, 1);
+    return;
+  }
+  unsigned int depth = atomic_load(&ls->depth);
+  while (depth < limit) {
+    if (atomic_compare_exchange_weak(&ls->depth, &depth, depth + 1)) return;
+  }
+  
+  pthread_mutex_lock(&m->admit_lock);
+  atomic_fetch_add(&ls->waiting, 1);
+  int waited = 0;
+  for (;;) {
+    depth = atomic_load(&ls->depth);
+    if (depth < limit) {
+      if (atomic_compare_exchange_weak(&ls->depth, &depth, depth + 1)) break;
+      continue;
     }
-    if (d->u.setxattr.value) {
-      napi_create_buffer_copy(env, d->u.setxattr.size, d->u.setxattr.value, NULL, &val);
-      napi_set_named_property(env, params, "value", val);
-      free(d->u.setxattr.value);
+    if (atomic_load(&m->closing) || m->admit_waiters + 1 >= m->config.threads) {
+      atomic_fetch_add(&ls->depth, 1);
+      break;
     }
-    napi_create_double(env, (double)d->u.setxattr.size, &val);
-    napi_set_named_property(env, params, "size", val);
-    napi_create_int32(env, d->u.setxattr.flags, &val);
-    napi_set_named_property(env, params, "flags", val);
-  } else if (strcmp(d->op, "getxattr") == 0 || strcmp(d->op, "removexattr") == 0) {
-    napi_create_double(env, (double)d->u.getxattr.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    if (d->u.getxattr.name) {
-      napi_create_string_utf8(env, d->u.getxattr.name, NAPI_AUTO_LENGTH, &val);
-      napi_set_named_property(env, params, "name", val);
-      free(d->u.getxattr.name);
+    if (!waited) atomic_fetch_add(&ls->throttled, 1);
+    waited = 1;
+    m->admit_waiters++;
+    pthread_cond_wait(&m->admit_cond, &m->admit_lock);
+    m->admit_waiters--;
+  }
+  atomic_fetch_sub(&ls->waiting, 1);
+  pthread_mutex_unlock(&m->admit_lock);
+}
+
+// Called as requests leave a lane. The waiting check pairs with lane_admit's
+// increment of waiting before it rechecks depth, so no wakeup is lost.
+static void lane_release(struct mount_ctx *m, enum req_lane lane, uint32_t n) {
+  struct lane_state *ls = &m->lanes[lane];
+  atomic_fetch_sub(&ls->depth, n);
+  if (atomic_load(&ls->waiting)) {
+    pthread_mutex_lock(&m->admit_lock);
+    pthread_cond_broadcast(&m->admit_cond);
+    pthread_mutex_unlock(&m->admit_lock);
+  }
+}
+
+// A delivered request keeps its lane slot until JS replies, so a lane's limit also
+// bounds what a provider can hold in flight (and the payloads it keeps alive)
+static void lane_replied(const struct inflight *e) {
+  struct mount_ctx *m = e->shard->mount;
+  enum req_lane lane = op_lane(e->op);
+  if (atomic_fetch_sub(&m->lanes[lane].inflight, 1) == 0 && is_debug_enabled()) {
+    fprintf(stderr, "[FUSE:lanes] Reply to %s that was not counted in flight\n", op_names[e->op]);
+  }
+  lane_release(m, lane, 1);
+}
+
+// Drops the entries of requests delivered for sh, whose replies can no longer be sent
+static void inflight_purge(struct addon_data *ad, const struct shard *sh) {
+  if (!ad || !ad->inflight) return;
+  for (uint32_t i = 0; i <= ad->inflight_mask;) {
+    struct inflight e;
+    // Taking an entry shifts a later one into slot i, so look at it again
+    if (ad->inflight[i].req && ad->inflight[i].shard == sh && inflight_take(ad, ad->inflight[i].req, &e)) {
+      lane_replied(&e);
+      continue;
     }
-    if (strcmp(d->op, "getxattr") == 0) {
-      napi_create_double(env, (double)d->u.getxattr.size, &val);
-      napi_set_named_property(env, params, "size", val);
+    i++;
+  }
+}
+
+// Lets FUSE threads blocked in lane_admit through, so the session loop can exit
+static void lanes_close(struct mount_ctx *m) {
+  pthread_mutex_lock(&m->admit_lock);
+  atomic_store(&m->closing, 1);
+  pthread_cond_broadcast(&m->admit_cond);
+  pthread_mutex_unlock(&m->admit_lock);
+}
+
+// Fills batch with weighted round-robin over the lanes: each round takes up to
+// lane_weights[l] requests from lane l, so a backlog of writes yields most of
+// every batch to metadata and reads.
+static uint32_t shard_take(struct shard *sh, struct req_data **batch, uint32_t max) {
+  uint32_t count = 0;
+  int progress = 1;
+  while (count < max && progress) {
+    progress = 0;
+    for (int l = 0; l < LANE_COUNT && count < max; l++) {
+      struct req_data *d;
+      for (uint32_t w = 0; w < lane_weights[l] && count < max && (d = req_queue_pop(&sh->lanes[l])) != NULL; w++) {
+        batch[count++] = d;
+        progress = 1;
+      }
     }
-  } else if (strcmp(d->op, "listxattr") == 0) {
-    napi_create_double(env, (double)d->u.listxattr.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.listxattr.size, &val);
-    napi_set_named_property(env, params, "size", val);
-  } else if (strcmp(d->op, "getlk") == 0 || strcmp(d->op, "setlk") == 0) {
-    napi_create_double(env, (double)d->u.getlk.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.getlk.fh, &val);
-    napi_set_named_property(env, params, "fh", val);
-    napi_value lock_obj;
-    napi_create_object(env, &lock_obj);
-    fuse_serialize_flock(env, &d->u.getlk.lock, lock_obj);
-    napi_set_named_property(env, params, "lock", lock_obj);
-    if (strcmp(d->op, "setlk") == 0) {
-      napi_create_int32(env, d->u.setlk.sleep, &val);
-      napi_set_named_property(env, params, "sleep", val);
+  }
+  return count;
+}
+
+static void call_js(napi_env env, napi_value js_cb, void *context, void *data) {
+  (void)data;
+  struct shard *sh = context;
+  
+  if (!env || !js_cb) {
+    // The threadsafe function is being torn down
+    for (int l = 0; l < LANE_COUNT; l++) {
+      struct req_data *d;
+      while ((d = req_queue_pop(&sh->lanes[l])) != NULL) {
+        lane_release(sh->mount, (enum req_lane)l, 1);
+        fail_req_data(d);
+      }
     }
-  } else if (strcmp(d->op, "flock") == 0) {
-    napi_create_double(env, (double)d->u.flock.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.flock.fh, &val);
-    napi_set_named_property(env, params, "fh", val);
-    napi_create_int32(env, d->u.flock.op, &val);
-    napi_set_named_property(env, params, "op", val);
-  } else if (strcmp(d->op, "bmap") == 0) {
-    napi_create_double(env, (double)d->u.bmap.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.bmap.blocksize, &val);
-    napi_set_named_property(env, params, "blocksize", val);
-    napi_create_double(env, (double)d->u.bmap.idx, &val);
-    napi_set_named_property(env, params, "idx", val);
-  } else if (strcmp(d->op, "ioctl") == 0) {
-    napi_create_double(env, (double)d->u.ioctl.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_uint32(env, d->u.ioctl.cmd, &val);
-    napi_set_named_property(env, params, "cmd", val);
-    napi_create_double(env, (double)d->u.ioctl.in_bufsz, &val);
-    napi_set_named_property(env, params, "in_bufsz", val);
-    napi_create_double(env, (double)d->u.ioctl.out_bufsz, &val);
-    napi_set_named_property(env, params, "out_bufsz", val);
-    if (d->u.ioctl.in_bufsz > 0 && d->u.ioctl.in_buf) {
-      napi_create_buffer_copy(env, d->u.ioctl.in_bufsz, d->u.ioctl.in_buf, NULL, &val);
-      napi_set_named_property(env, params, "in_buf", val);
-      free(d->u.ioctl.in_buf);
+    return;
+  }
+  
+  uint32_t batch_size = sh->mount->config.batch_size;
+  struct req_data *batch[batch_size];
+  uint32_t count = shard_take(sh, batch, batch_size);
+  
+  if (count == batch_size) {
+    // More may be waiting; yield to the event loop and drain again
+    if (napi_call_threadsafe_function(sh->tsfn, NULL, napi_tsfn_nonblocking) != napi_ok) {
+      atomic_store_explicit(&sh->drain_scheduled, 0, memory_order_release);
     }
-    napi_create_int32(env, d->u.ioctl.flags, &val);
-    napi_set_named_property(env, params, "flags", val);
-    napi_create_double(env, (double)d->u.ioctl.fh, &val);
-    napi_set_named_property(env, params, "fh", val);
-  } else if (strcmp(d->op, "poll") == 0) {
-    napi_create_double(env, (double)d->u.poll.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.poll.fh, &val);
-    napi_set_named_property(env, params, "fh", val);
-  } else if (strcmp(d->op, "fallocate") == 0) {
-    napi_create_double(env, (double)d->u.fallocate.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.fallocate.fh, &val);
-    napi_set_named_property(env, params, "fh", val);
-    napi_create_double(env, (double)d->u.fallocate.offset, &val);
-    napi_set_named_property(env, params, "offset", val);
-    napi_create_double(env, (double)d->u.fallocate.length, &val);
-    napi_set_named_property(env, params, "length", val);
-    napi_create_int32(env, d->u.fallocate.mode, &val);
-    napi_set_named_property(env, params, "mode", val);
-  } else if (strcmp(d->op, "readdirplus") == 0) {
-    napi_create_double(env, (double)d->u.readdirplus.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.readdirplus.fh, &val);
-    napi_set_named_property(env, params, "fh", val);
-    napi_create_double(env, (double)d->u.readdirplus.size, &val);
-    napi_set_named_property(env, params, "size", val);
-    napi_create_double(env, (double)d->u.readdirplus.off, &val);
-    napi_set_named_property(env, params, "off", val);
-  } else if (strcmp(d->op, "copy_file_range") == 0) {
-    napi_create_double(env, (double)d->u.copy_file_range.ino_in, &val);
-    napi_set_named_property(env, params, "ino_in", val);
-    napi_create_double(env, (double)d->u.copy_file_range.fh_in, &val);
-    napi_set_named_property(env, params, "fh_in", val);
-    napi_create_double(env, (double)d->u.copy_file_range.off_in, &val);
-    napi_set_named_property(env, params, "off_in", val);
-    napi_create_double(env, (double)d->u.copy_file_range.ino_out, &val);
-    napi_set_named_property(env, params, "ino_out", val);
-    napi_create_double(env, (double)d->u.copy_file_range.fh_out, &val);
-    napi_set_named_property(env, params, "fh_out", val);
-    napi_create_double(env, (double)d->u.copy_file_range.off_out, &val);
-    napi_set_named_property(env, params, "off_out", val);
-    napi_create_double(env, (double)d->u.copy_file_range.len, &val);
-    napi_set_named_property(env, params, "len", val);
-    napi_create_int32(env, d->u.copy_file_range.flags, &val);
-    napi_set_named_property(env, params, "flags", val);
-  } else if (strcmp(d->op, "lseek") == 0) {
-    napi_create_double(env, (double)d->u.lseek.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.lseek.fh, &val);
-    napi_set_named_property(env, params, "fh", val);
-    napi_create_double(env, (double)d->u.lseek.off, &val);
-    napi_set_named_property(env, params, "off", val);
-    napi_create_int32(env, d->u.lseek.whence, &val);
-    napi_set_named_property(env, params, "whence", val);
-  } else if (strcmp(d->op, "tmpfile") == 0) {
-    napi_create_double(env, (double)d->u.tmpfile.parent, &val);
-    napi_set_named_property(env, params, "parent", val);
-    napi_create_uint32(env, d->u.tmpfile.mode, &val);
-    napi_set_named_property(env, params, "mode", val);
-    napi_create_uint32(env, d->u.tmpfile.flags, &val);
-    napi_set_named_property(env, params, "flags", val);
-  } else if (strcmp(d->op, "statx") == 0) {
-    napi_create_double(env, (double)d->u.statx.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_int32(env, d->u.statx.flags, &val);
-    napi_set_named_property(env, params, "flags", val);
-    napi_create_int32(env, d->u.statx.mask, &val);
-    napi_set_named_property(env, params, "mask", val);
-  } else if (strcmp(d->op, "forget") == 0) {
-    napi_create_double(env, (double)d->u.forget.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)d->u.forget.nlookup, &val);
-    napi_set_named_property(env, params, "nlookup", val);
-  } else if (strcmp(d->op, "forget_multi") == 0) {
-    napi_create_double(env, (double)d->u.forget_multi.count, &val);
-    napi_set_named_property(env, params, "count", val);
-    napi_value inos_array, nlookups_array;
-    napi_create_array(env, &inos_array);
-    napi_create_array(env, &nlookups_array);
-    if (d->u.forget_multi.inos && d->u.forget_multi.nlookups) {
-      for (size_t i = 0; i < d->u.forget_multi.count; i++) {
-        napi_create_double(env, (double)d->u.forget_multi.inos[i], &val);
-        napi_set_element(env, inos_array, i, val);
-        napi_create_double(env, (double)d->u.forget_multi.nlookups[i], &val);
-        napi_set_element(env, nlookups_array, i, val);
+  } else {
+    atomic_store_explicit(&sh->drain_scheduled, 0, memory_order_release);
+    if (shard_pending(sh)) schedule_drain(sh);
+  }
+  if (count == 0) return;
+  
+  napi_value desc_buffer, desc, extras, count_val;
+  double *slots = NULL;
+  napi_create_arraybuffer(env, (size_t)count * DESC_STRIDE * sizeof(double), (void **)&slots, &desc_buffer);
+  memset(slots, 0, (size_t)count * DESC_STRIDE * sizeof(double));
+  napi_create_typedarray(env, napi_float64_array, (size_t)count * DESC_STRIDE, desc_buffer, 0, &desc);
+  napi_create_array(env, &extras);
+  
+  struct batch_writer w = { env, get_addon_data(env), extras, 0 };
+  uint64_t now = now_ns();
+  uint32_t untracked[LANE_COUNT] = {0};
+  uint32_t delivered = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    struct req_data *d = batch[i];
+    hist_record(&sh->stats[d->op].phases[PHASE_QUEUE], now - d->queued_ns);
+    // Requests JS replies to hold their lane slot until then; the rest leave it now.
+    // JS only gets to reply to tracked requests, so one that can't be tracked is
+    // answered here instead of being delivered.
+    struct inflight e = { d->req, sh, d->op, now, d->attr_gen, req_changed_ino(d) };
+    struct inflight stale;
+    if (w.ad && d->req && inflight_take(w.ad, d->req, &stale)) lane_replied(&stale);
+    if (w.ad && d->req && inflight_put(w.ad, &e)) {
+      atomic_fetch_add(&sh->mount->lanes[op_lane(d->op)].inflight, 1);
+    } else {
+      untracked[op_lane(d->op)]++;
+      if (w.ad && d->req) {
+        if (d->op == OP_FORGET || d->op == OP_FORGET_MULTI) fuse_reply_none(d->req);
+        else fuse_reply_err(d->req, ENOMEM);
+        d->req = NULL;
       }
-      free(d->u.forget_multi.inos);
-      free(d->u.forget_multi.nlookups);
     }
-    napi_set_named_property(env, params, "inos", inos_array);
-    napi_set_named_property(env, params, "nlookups", nlookups_array);
-  } else if (strcmp(d->op, "retrieve_reply") == 0) {
-    napi_create_double(env, (double)d->u.retrieve_reply.ino, &val);
-    napi_set_named_property(env, params, "ino", val);
-    napi_create_double(env, (double)(uintptr_t)d->u.retrieve_reply.cookie, &val);
-    napi_set_named_property(env, params, "cookie", val);
-    napi_create_double(env, (double)d->u.retrieve_reply.offset, &val);
-    napi_set_named_property(env, params, "offset", val);
-    if (d->u.retrieve_reply.data_len > 0 && d->u.retrieve_reply.data) {
-      napi_create_buffer_copy(env, d->u.retrieve_reply.data_len, d->u.retrieve_reply.data, NULL, &val);
-      napi_set_named_property(env, params, "data", val);
-      free(d->u.retrieve_reply.data);
+    if (d->req || d->op == OP_INIT || d->op == OP_DESTROY || d->op == OP_RETRIEVE_REPLY || !w.ad) {
+      encode_request(&w, batch[i], slots + (size_t)delivered++ * DESC_STRIDE);
     }
+    req_clear(batch[i]);
+    req_set_link(batch[i], i + 1 < count ? batch[i + 1] : NULL);
+  }
+  if (count > 0) req_slab_put(batch[0], batch[count - 1], count);
+  for (int l = 0; l < LANE_COUNT; l++) {
+    if (untracked[l]) lane_release(sh->mount, (enum req_lane)l, untracked[l]);
   }
   
-  napi_value argv[] = {req_ptr, params};
-  napi_call_function(env, js_cb, js_cb, 2, argv, NULL);
-  free(d);
+  if (delivered == 0) return;
+  napi_create_uint32(env, delivered, &count_val);
+  napi_value argv[] = {desc, extras, count_val};
+  napi_call_function(env, js_cb, js_cb, 3, argv, NULL);
 }
 
-static void send_to_js(fuse_req_t req, struct req_data *d) {
-  if (napi_call_threadsafe_function(tsfn, d, napi_tsfn_nonblocking) != napi_ok) {
-    free(d);
-    if (is_debug_enabled()) {
-      fprintf(stderr, "[FUSE:send_to_js] Error calling threadsafe function, replying with EIO\n");
-    }
-    fuse_reply_err(req, EIO);
+// The inode a request is about. Entry operations name their parent directory.
+static fuse_ino_t req_ino(const struct req_data *d) {
+  switch (d->op) {
+    case OP_INIT:
+    case OP_DESTROY:
+    case OP_FORGET_MULTI: return 0;
+    case OP_SYMLINK: return d->u.symlink.parent;
+    // Every other request's arguments start with its inode or parent
+    default: return d->u.getattr.ino;
   }
 }
 
-static void fuse_lookup(fuse_req_t req, fuse_ino_t parent, const char *name) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "lookup", sizeof(d->op) - 1);
-  d->u.lookup.parent = parent;
-  d->u.lookup.name = strdup(name);
-  send_to_js(req, d);
+// Lifecycle requests and retrieve replies stay on the main thread, the rest go to a
+// worker when there are any
+static struct shard *route_request(struct mount_ctx *m, const struct req_data *d) {
+  uint32_t n = m->config.workers;
+  if (n == 0 || d->op == OP_INIT || d->op == OP_DESTROY || d->op == OP_RETRIEVE_REPLY) return &m->main;
+  uint32_t i;
+  if (m->config.shard_by_inode) {
+    i = (uint32_t)(((uint64_t)req_ino(d) * 11400714819323198485ULL) >> 32) % n;
+  } else {
+    i = atomic_fetch_add_explicit(&m->next_worker, 1, memory_order_relaxed) % n;
+  }
+  return &m->workers[i];
 }
 
-static void fuse_getattr(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "getattr", sizeof(d->op) - 1);
-  d->u.getattr.ino = ino;
-  d->u.getattr.fh = fi ? fi->fh : 0;
-  send_to_js(req, d);
+static void send_to_mount(struct mount_ctx *m, struct req_data *d) {
+  enum fuse_op op = d->op;
+  struct shard *sh = route_request(m, d);
+  lane_admit(m, op);
+  d->queued_ns = now_ns();
+  d->attr_gen = atomic_load(&m->cache.clock);
+  req_queue_push(&sh->lanes[op_lane(op)], d);
+  if (schedule_drain(sh) != napi_ok && is_debug_enabled()) {
+    fprintf(stderr, "[FUSE:send_to_js] Error calling threadsafe function for %s\n", op_names[op]);
+  }
+}
+
+static void send_to_js(fuse_req_t req, struct req_data *d) {
+  send_to_mount(req_mount(req), d);
 }
 
 #ifdef __APPLE__
@@ -538,32 +1447,342 @@ static void stat_to_darwin_attr(const struct stat *st, struct fuse_darwin_attr *
   attr->size = st->st_size;
   attr->blksize = st->st_blksize;
   attr->blocks = st->st_blocks;
-  attr->atimespec.tv_sec = st->st_atime;
-  attr->mtimespec.tv_sec = st->st_mtime;
-  attr->ctimespec.tv_sec = st->st_ctime;
+  attr->atimespec = st->st_atimespec;
+  attr->mtimespec = st->st_mtimespec;
+  attr->ctimespec = st->st_ctimespec;
+}
+
+static void stat_to_darwin_entry_param(const struct stat *st, struct fuse_darwin_entry_param *e, const struct mount_config *cfg) {
+  e->ino = st->st_ino;
+  stat_to_darwin_attr(st, &e->attr);
+  e->attr_timeout = cfg->attr_timeout;
+  e->entry_timeout = cfg->entry_timeout;
+}
+#endif
+
+static void __attribute__((unused)) stat_to_entry_param(const struct stat *st, struct fuse_entry_param *e, const struct mount_config *cfg) {
+  e->ino = st->st_ino;
+  e->attr = *st;
+  e->attr_timeout = cfg->attr_timeout;
+  e->entry_timeout = cfg->entry_timeout;
+}
+
+static void apply_open_flags(struct fuse_file_info *fi, uint32_t flags) {
+  fi->keep_cache = (flags & OPEN_KEEP_CACHE) ? 1 : 0;
+  fi->direct_io = (flags & OPEN_DIRECT_IO) ? 1 : 0;
+  fi->parallel_direct_writes = (flags & OPEN_PARALLEL_DIRECT_WRITES) ? 1 : 0;
+}
+
+// Registers the provider's backing fd so the kernel serves reads and writes of this
+// open file without asking JS. Without passthrough, or if the kernel refuses the fd
+// (it needs CAP_SYS_ADMIN), the file is served through JS as usual.
+static void attr_cache_drop_attr(struct attr_cache *c, fuse_ino_t ino);
+
+static void attach_backing(fuse_req_t req, struct fuse_file_info *fi, uint64_t ino, int fd) {
+#if HAVE_FUSE_PASSTHROUGH
+  struct mount_ctx *m = req_mount(req);
+  if (fd < 0 || !atomic_load(&m->passthrough)) return;
+  int id = fuse_passthrough_open(req, fd);
+  if (id <= 0) {
+    if (is_debug_enabled()) {
+      fprintf(stderr, "[FUSE:passthrough] Backing fd %d refused for inode %llu: %d\n", fd, (unsigned long long)ino, id);
+    }
+    return;
+  }
+  backing_put(&m->backing, ino, fi->fh, id);
+  // Its size and times now change without passing fuse_write; see mount_cache_attr
+  attr_cache_drop_attr(&m->cache, ino);
+  fi->backing_id = id;
+  // Reads and writes no longer reach JS, so direct_io has nothing to bypass
+  fi->direct_io = 0;
+  fi->parallel_direct_writes = 0;
+#else
+  (void)req;
+  (void)fi;
+  (void)ino;
+  (void)fd;
+#endif
+}
+
+static double monotonic_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t dentry_hash(fuse_ino_t parent, const char *name) {
+  uint64_t h = 14695981039346656037ULL ^ (uint64_t)parent;
+  for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+    h ^= *p;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+static size_t attr_bucket(fuse_ino_t ino) {
+  return (size_t)((ino * 11400714819323198485ULL) >> 52) & (ATTR_CACHE_BUCKETS - 1);
+}
+
+static size_t dentry_bucket(uint64_t hash) {
+  return (size_t)(hash >> 52) & (ATTR_CACHE_BUCKETS - 1);
+}
+
+static bool attr_cache_empty(struct attr_cache *c) {
+  return atomic_load_explicit(&c->count, memory_order_relaxed) == 0;
+}
+
+// Marks ino as changed now, so replies to requests that arrived before are not cached
+static void attr_cache_stamp(struct attr_cache *c, fuse_ino_t ino) {
+  uint64_t gen = atomic_fetch_add(&c->clock, 1) + 1;
+  atomic_uint_fast64_t *slot = &c->gens[attr_bucket(ino)];
+  uint64_t cur = atomic_load(slot);
+  while (cur < gen && !atomic_compare_exchange_weak(slot, &cur, gen)) {}
+}
+
+static bool attr_cache_stale(struct attr_cache *c, fuse_ino_t ino, uint64_t since) {
+  return atomic_load(&c->gens[attr_bucket(ino)]) > since;
+}
+
+// Caller holds the write lock
+static void attr_cache_clear_locked(struct attr_cache *c) {
+  for (size_t i = 0; i < ATTR_CACHE_BUCKETS; i++) {
+    for (struct cached_attr *a = c->attrs[i], *next; a; a = next) {
+      next = a->next;
+      free(a);
+    }
+    for (struct cached_dentry *d = c->dentries[i], *next; d; d = next) {
+      next = d->next;
+      free(d);
+    }
+    c->attrs[i] = NULL;
+    c->dentries[i] = NULL;
+  }
+  atomic_store(&c->count, 0);
+}
+
+static void attr_cache_clear(struct attr_cache *c) {
+  pthread_rwlock_wrlock(&c->lock);
+  attr_cache_clear_locked(c);
+  pthread_rwlock_unlock(&c->lock);
+}
+
+// Caller holds the write lock. Drops expired entries, or everything once the cache is
+// still full after that; the cache only saves round trips, so losing it is harmless.
+static void attr_cache_make_room_locked(struct attr_cache *c, double now) {
+  if (atomic_load(&c->count) < c->max_entries) return;
+  size_t removed = 0;
+  for (size_t i = 0; i < ATTR_CACHE_BUCKETS; i++) {
+    for (struct cached_attr **ap = &c->attrs[i]; *ap;) {
+      struct cached_attr *a = *ap;
+      if (a->expires > now) { ap = &a->next; continue; }
+      *ap = a->next;
+      free(a);
+      removed++;
+    }
+    for (struct cached_dentry **dp = &c->dentries[i]; *dp;) {
+      struct cached_dentry *d = *dp;
+      if (d->expires > now) { dp = &d->next; continue; }
+      *dp = d->next;
+      free(d);
+      removed++;
+    }
+  }
+  atomic_fetch_sub(&c->count, removed);
+  if (atomic_load(&c->count) >= c->max_entries) attr_cache_clear_locked(c);
+}
+
+// since is the generation the request arrived at, see struct attr_cache
+static void attr_cache_put_attr(struct attr_cache *c, const struct stat *st, double attr_timeout, double ttl, uint64_t since) {
+  if (ttl <= 0 || st->st_ino == 0) return;
+  fuse_ino_t ino = st->st_ino;
+  double now = monotonic_now();
+  pthread_rwlock_wrlock(&c->lock);
+  // Checked under the lock: a change stamps before it takes the lock to drop the entry
+  if (attr_cache_stale(c, ino, since)) goto out;
+  struct cached_attr **head = &c->attrs[attr_bucket(ino)];
+  struct cached_attr *a = *head;
+  while (a && a->ino != ino) a = a->next;
+  if (!a) {
+    attr_cache_make_room_locked(c, now);
+    head = &c->attrs[attr_bucket(ino)];
+    a = malloc(sizeof(*a));
+    if (!a) goto out;
+    a->ino = ino;
+    a->next = *head;
+    *head = a;
+    atomic_fetch_add(&c->count, 1);
+  }
+  a->st = *st;
+  a->attr_timeout = attr_timeout;
+  a->expires = now + ttl;
+out:
+  pthread_rwlock_unlock(&c->lock);
+}
+
+// Files open through a backing id are written by the kernel directly, so nothing would
+// drop their attributes; they are only cached while no such handle is open
+static void mount_cache_attr(struct mount_ctx *m, const struct stat *st, double attr_timeout, double ttl, uint64_t since) {
+  if (ttl <= 0 || (atomic_load(&m->passthrough) && backing_open(&m->backing, st->st_ino))) return;
+  attr_cache_put_attr(&m->cache, st, attr_timeout, ttl, since);
+}
+
+static void attr_cache_put_entry(struct attr_cache *c, fuse_ino_t parent, const char *name, fuse_ino_t ino, double entry_timeout, double ttl, uint64_t since) {
+  if (ttl <= 0 || ino == 0 || !name) return;
+  uint64_t hash = dentry_hash(parent, name);
+  double now = monotonic_now();
+  pthread_rwlock_wrlock(&c->lock);
+  if (attr_cache_stale(c, parent, since) || attr_cache_stale(c, ino, since)) goto out;
+  struct cached_dentry **head = &c->dentries[dentry_bucket(hash)];
+  struct cached_dentry *d = *head;
+  while (d && !(d->hash == hash && d->parent == parent && strcmp(d->name, name) == 0)) d = d->next;
+  if (!d) {
+    attr_cache_make_room_locked(c, now);
+    head = &c->dentries[dentry_bucket(hash)];
+    size_t len = strlen(name) + 1;
+    d = malloc(sizeof(*d) + len);
+    if (!d) goto out;
+    d->parent = parent;
+    d->hash = hash;
+    memcpy(d->name, name, len);
+    d->next = *head;
+    *head = d;
+    atomic_fetch_add(&c->count, 1);
+  }
+  d->ino = ino;
+  d->entry_timeout = entry_timeout;
+  d->expires = now + ttl;
+out:
+  pthread_rwlock_unlock(&c->lock);
+}
+
+// Caller holds the lock
+static const struct cached_attr *attr_cache_find_attr(struct attr_cache *c, fuse_ino_t ino, double now) {
+  const struct cached_attr *a = c->attrs[attr_bucket(ino)];
+  while (a && a->ino != ino) a = a->next;
+  return a && a->expires > now ? a : NULL;
+}
+
+static bool attr_cache_get_attr(struct attr_cache *c, fuse_ino_t ino, struct stat *st, double *attr_timeout) {
+  if (attr_cache_empty(c)) return false;
+  double now = monotonic_now();
+  pthread_rwlock_rdlock(&c->lock);
+  const struct cached_attr *a = attr_cache_find_attr(c, ino, now);
+  if (a) {
+    *st = a->st;
+    *attr_timeout = a->attr_timeout;
+  }
+  pthread_rwlock_unlock(&c->lock);
+  return a != NULL;
+}
+
+// A dentry hit also needs the child's attributes to build the entry reply
+static bool attr_cache_get_entry(struct attr_cache *c, fuse_ino_t parent, const char *name, struct stat *st, double *entry_timeout, double *attr_timeout) {
+  if (attr_cache_empty(c)) return false;
+  uint64_t hash = dentry_hash(parent, name);
+  double now = monotonic_now();
+  bool hit = false;
+  pthread_rwlock_rdlock(&c->lock);
+  const struct cached_dentry *d = c->dentries[dentry_bucket(hash)];
+  while (d && !(d->hash == hash && d->parent == parent && strcmp(d->name, name) == 0)) d = d->next;
+  if (d && d->expires > now) {
+    const struct cached_attr *a = attr_cache_find_attr(c, d->ino, now);
+    if (a) {
+      *st = a->st;
+      *entry_timeout = d->entry_timeout;
+      *attr_timeout = a->attr_timeout;
+      hit = true;
+    }
+  }
+  pthread_rwlock_unlock(&c->lock);
+  return hit;
+}
+
+// Caller holds the write lock
+static void attr_cache_drop_attr_locked(struct attr_cache *c, fuse_ino_t ino) {
+  for (struct cached_attr **ap = &c->attrs[attr_bucket(ino)]; *ap; ap = &(*ap)->next) {
+    if ((*ap)->ino != ino) continue;
+    struct cached_attr *a = *ap;
+    *ap = a->next;
+    free(a);
+    atomic_fetch_sub(&c->count, 1);
+    return;
+  }
+}
+
+static void attr_cache_drop_attr(struct attr_cache *c, fuse_ino_t ino) {
+  attr_cache_stamp(c, ino);
+  if (attr_cache_empty(c)) return;
+  pthread_rwlock_wrlock(&c->lock);
+  attr_cache_drop_attr_locked(c, ino);
+  pthread_rwlock_unlock(&c->lock);
+}
+
+// Drops the dentry for name, the attributes of the inode it named, and the parent's
+// attributes, since the directory's mtime and the child's ctime/nlink change with it
+static void attr_cache_drop_entry(struct attr_cache *c, fuse_ino_t parent, const char *name) {
+  attr_cache_stamp(c, parent);
+  if (attr_cache_empty(c)) return;
+  uint64_t hash = dentry_hash(parent, name);
+  pthread_rwlock_wrlock(&c->lock);
+  for (struct cached_dentry **dp = &c->dentries[dentry_bucket(hash)]; *dp; dp = &(*dp)->next) {
+    struct cached_dentry *d = *dp;
+    if (!(d->hash == hash && d->parent == parent && strcmp(d->name, name) == 0)) continue;
+    *dp = d->next;
+    attr_cache_stamp(c, d->ino);
+    attr_cache_drop_attr_locked(c, d->ino);
+    free(d);
+    atomic_fetch_sub(&c->count, 1);
+    break;
+  }
+  attr_cache_drop_attr_locked(c, parent);
+  pthread_rwlock_unlock(&c->lock);
+}
+
+static void fuse_lookup(fuse_req_t req, fuse_ino_t parent, const char *name) {
+  struct stat st;
+  double entry_timeout, attr_timeout;
+  if (attr_cache_get_entry(req_cache(req), parent, name, &st, &entry_timeout, &attr_timeout)) {
+#ifdef __APPLE__
+    struct fuse_darwin_entry_param e = {0};
+    stat_to_darwin_entry_param(&st, &e, req_config(req));
+#else
+    struct fuse_entry_param e = {0};
+    stat_to_entry_param(&st, &e, req_config(req));
+#endif
+    e.entry_timeout = entry_timeout;
+    e.attr_timeout = attr_timeout;
+    fuse_reply_entry(req, &e);
+    return;
+  }
+  struct req_data *d = req_alloc(req, OP_LOOKUP);
+  d->u.lookup.parent = parent;
+  d->u.lookup.name = req_strdup(d, name);
+  send_to_js(req, d);
 }
 
-static void stat_to_darwin_entry_param(const struct stat *st, struct fuse_darwin_entry_param *e) {
-  e->ino = st->st_ino;
-  stat_to_darwin_attr(st, &e->attr);
-  e->attr_timeout = 1.0;
-  e->entry_timeout = 1.0;
-}
+static void fuse_getattr(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
+  struct stat st;
+  double attr_timeout;
+  if (attr_cache_get_attr(req_cache(req), ino, &st, &attr_timeout)) {
+#ifdef __APPLE__
+    struct fuse_darwin_attr attr = {0};
+    stat_to_darwin_attr(&st, &attr);
+    fuse_reply_attr(req, &attr, attr_timeout);
+#else
+    fuse_reply_attr(req, &st, attr_timeout);
 #endif
-
-static void __attribute__((unused)) stat_to_entry_param(const struct stat *st, struct fuse_entry_param *e) {
-  e->ino = st->st_ino;
-  e->attr = *st;
-  e->attr_timeout = 1.0;
-  e->entry_timeout = 1.0;
+    return;
+  }
+  struct req_data *d = req_alloc(req, OP_GETATTR);
+  d->u.getattr.ino = ino;
+  d->u.getattr.fh = fi ? fi->fh : 0;
+  send_to_js(req, d);
 }
 
 // dirbuf global removed to ensure thread-safety during parallel readdir calls
 
 static void fuse_readdir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "readdir", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_READDIR);
   d->u.readdir.ino = ino;
   d->u.readdir.fh = fi ? fi->fh : 0;
   d->u.readdir.size = size;
@@ -572,27 +1791,32 @@ static void fuse_readdir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
 }
 
 static void fuse_open(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "open", sizeof(d->op) - 1);
+  if (fi && (fi->flags & O_TRUNC)) attr_cache_drop_attr(req_cache(req), ino);
+  struct req_data *d = req_alloc(req, OP_OPEN);
   d->u.open.ino = ino;
   d->u.open.flags = fi ? fi->flags : 0;
   send_to_js(req, d);
 }
 
 static void fuse_release(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "release", sizeof(d->op) - 1);
+#if HAVE_FUSE_PASSTHROUGH
+  struct mount_ctx *m = req_mount(req);
+  if (atomic_load(&m->passthrough) && fi) {
+    int id = backing_take(&m->backing, ino, fi->fh);
+    if (id > 0) {
+      fuse_passthrough_close(req, id);
+      attr_cache_drop_attr(&m->cache, ino);
+    }
+  }
+#endif
+  struct req_data *d = req_alloc(req, OP_RELEASE);
   d->u.release.ino = ino;
   d->u.release.fh = fi ? fi->fh : 0;
   send_to_js(req, d);
 }
 
 static void fuse_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "read", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_READ);
   d->u.read.ino = ino;
   d->u.read.fh = fi ? fi->fh : 0;
   d->u.read.size = size;
@@ -601,9 +1825,8 @@ static void fuse_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off, st
 }
 
 static void fuse_write(fuse_req_t req, fuse_ino_t ino, const char *buf, size_t size, off_t off, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "write", sizeof(d->op) - 1);
+  attr_cache_drop_attr(req_cache(req), ino);
+  struct req_data *d = req_alloc(req, OP_WRITE);
   d->u.write.ino = ino;
   d->u.write.fh = fi ? fi->fh : 0;
   d->u.write.size = size;
@@ -615,61 +1838,56 @@ static void fuse_write(fuse_req_t req, fuse_ino_t ino, const char *buf, size_t s
 }
 
 static void fuse_create(fuse_req_t req, fuse_ino_t parent, const char *name, mode_t mode, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "create", sizeof(d->op) - 1);
+  attr_cache_drop_entry(req_cache(req), parent, name);
+  struct req_data *d = req_alloc(req, OP_CREATE);
   d->u.create.parent = parent;
-  d->u.create.name = strdup(name);
+  d->u.create.name = req_strdup(d, name);
   d->u.create.mode = mode;
   d->u.create.flags = fi ? fi->flags : 0;
   send_to_js(req, d);
 }
 
 static void fuse_unlink(fuse_req_t req, fuse_ino_t parent, const char *name) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "unlink", sizeof(d->op) - 1);
+  attr_cache_drop_entry(req_cache(req), parent, name);
+  struct req_data *d = req_alloc(req, OP_UNLINK);
   d->u.unlink.parent = parent;
-  d->u.unlink.name = strdup(name);
+  d->u.unlink.name = req_strdup(d, name);
   send_to_js(req, d);
 }
 
 static void fuse_mkdir(fuse_req_t req, fuse_ino_t parent, const char *name, mode_t mode) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "mkdir", sizeof(d->op) - 1);
+  attr_cache_drop_entry(req_cache(req), parent, name);
+  struct req_data *d = req_alloc(req, OP_MKDIR);
   d->u.mkdir.parent = parent;
-  d->u.mkdir.name = strdup(name);
+  d->u.mkdir.name = req_strdup(d, name);
   d->u.mkdir.mode = mode;
   send_to_js(req, d);
 }
 
 static void fuse_rmdir(fuse_req_t req, fuse_ino_t parent, const char *name) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "rmdir", sizeof(d->op) - 1);
+  attr_cache_drop_entry(req_cache(req), parent, name);
+  struct req_data *d = req_alloc(req, OP_RMDIR);
   d->u.rmdir.parent = parent;
-  d->u.rmdir.name = strdup(name);
+  d->u.rmdir.name = req_strdup(d, name);
   send_to_js(req, d);
 }
 
 static void fuse_rename(fuse_req_t req, fuse_ino_t parent, const char *name, fuse_ino_t newparent, const char *newname, unsigned int flags) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "rename", sizeof(d->op) - 1);
+  attr_cache_drop_entry(req_cache(req), parent, name);
+  attr_cache_drop_entry(req_cache(req), newparent, newname);
+  struct req_data *d = req_alloc(req, OP_RENAME);
   d->u.rename.parent = parent;
-  d->u.rename.name = strdup(name);
+  d->u.rename.name = req_strdup(d, name);
   d->u.rename.newparent = newparent;
-  d->u.rename.newname = strdup(newname);
+  d->u.rename.newname = req_strdup(d, newname);
   d->u.rename.flags = flags;
   send_to_js(req, d);
 }
 
 #ifdef __APPLE__
 static void fuse_setattr(fuse_req_t req, fuse_ino_t ino, struct fuse_darwin_attr *attr, int to_set, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "setattr", sizeof(d->op) - 1);
+  attr_cache_drop_attr(req_cache(req), ino);
+  struct req_data *d = req_alloc(req, OP_SETATTR);
   d->u.setattr.ino = ino;
   d->u.setattr.fh = fi ? fi->fh : 0;
   d->u.setattr.to_set = to_set;
@@ -692,9 +1910,8 @@ static void fuse_setattr(fuse_req_t req, fuse_ino_t ino, struct fuse_darwin_attr
 }
 #else
 static void fuse_setattr(fuse_req_t req, fuse_ino_t ino, struct stat *attr, int to_set, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "setattr", sizeof(d->op) - 1);
+  attr_cache_drop_attr(req_cache(req), ino);
+  struct req_data *d = req_alloc(req, OP_SETATTR);
   d->u.setattr.ino = ino;
   d->u.setattr.fh = fi ? fi->fh : 0;
   d->u.setattr.to_set = to_set;
@@ -703,49 +1920,67 @@ static void fuse_setattr(fuse_req_t req, fuse_ino_t ino, struct stat *attr, int
 }
 #endif
 
+static void set_conn_cap(struct fuse_conn_info *conn, uint64_t cap, int32_t setting) {
+  if (setting == 1 && (conn->capable & cap)) {
+    conn->want |= cap;
+  } else if (setting == 0) {
+    conn->want &= ~cap;
+  }
+}
+
 static void fuse_init(void *userdata, struct fuse_conn_info *conn) {
-  (void)userdata;
+  struct mount_ctx *m = userdata;
+  const struct mount_config *cfg = &m->config;
   conn->no_interrupt = 1;
+  set_conn_cap(conn, FUSE_CAP_WRITEBACK_CACHE, cfg->writeback_cache);
+  set_conn_cap(conn, FUSE_CAP_AUTO_INVAL_DATA, cfg->auto_inval_data);
   
-  // Forward to JavaScript
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = NULL; // init doesn't have a request
-  strncpy(d->op, "init", sizeof(d->op) - 1);
-  if (tsfn) {
-    napi_call_threadsafe_function(tsfn, d, napi_tsfn_blocking);
-  } else {
-    free(d);
+  // libfuse derives max_pages from max_write and clamps max_write to its
+  // receive buffer, so 1 MiB requests need max_write (or max_pages) raised here
+  if (cfg->max_write) {
+    conn->max_write = cfg->max_write;
+  } else if (cfg->max_pages) {
+    conn->max_write = cfg->max_pages * (uint32_t)sysconf(_SC_PAGESIZE);
+  }
+  if (cfg->max_read) conn->max_read = cfg->max_read;
+  if (cfg->max_readahead) conn->max_readahead = cfg->max_readahead;
+  if (cfg->max_background) conn->max_background = cfg->max_background;
+  if (cfg->congestion_threshold) conn->congestion_threshold = cfg->congestion_threshold;
+#if HAVE_FUSE_PASSTHROUGH
+  if (cfg->passthrough && (conn->capable & FUSE_CAP_PASSTHROUGH)) {
+    conn->want |= FUSE_CAP_PASSTHROUGH;
+    // The kernel rejects backing files on a passthrough mount when the page cache
+    // belongs to FUSE, and needs a stacking depth above 0
+    conn->want &= ~FUSE_CAP_WRITEBACK_CACHE;
+    if (!conn->max_backing_stack_depth) conn->max_backing_stack_depth = 1;
+    atomic_store(&m->passthrough, 1);
   }
+#endif
+#if HAVE_FUSE_IO_URING
+  // libfuse starts the rings itself once INIT completes; kernels without
+  // fuse.enable_uring don't offer the flag and keep using /dev/fuse
+  atomic_store(&m->io_uring, cfg->io_uring && (conn->capable_ext & FUSE_CAP_OVER_IO_URING) != 0);
+#endif
+  
+  // Forward to JavaScript
+  send_to_mount(m, req_alloc(NULL, OP_INIT));
 }
 
 static void fuse_destroy(void *userdata) {
-  (void)userdata;
-  
   // Forward to JavaScript
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = NULL; // destroy doesn't have a request
-  strncpy(d->op, "destroy", sizeof(d->op) - 1);
-  if (tsfn) {
-    napi_call_threadsafe_function(tsfn, d, napi_tsfn_blocking);
-  } else {
-    free(d);
-  }
+  send_to_mount(userdata, req_alloc(NULL, OP_DESTROY));
 }
 
 static void fuse_forget(fuse_req_t req, fuse_ino_t ino, uint64_t nlookup) {
   // Forward to JavaScript - no reply needed for forget
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "forget", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_FORGET);
   d->u.forget.ino = ino;
   d->u.forget.nlookup = nlookup;
   send_to_js(req, d);
 }
 
 static void fuse_forget_multi(fuse_req_t req, size_t count, struct fuse_forget_data *forgets) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "forget_multi", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_FORGET_MULTI);
   d->u.forget_multi.count = count;
   d->u.forget_multi.inos = malloc(sizeof(fuse_ino_t) * count);
   d->u.forget_multi.nlookups = malloc(sizeof(uint64_t) * count);
@@ -757,18 +1992,14 @@ static void fuse_forget_multi(fuse_req_t req, size_t count, struct fuse_forget_d
 }
 
 static void fuse_flush(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "flush", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_FLUSH);
   d->u.flush.ino = ino;
   d->u.flush.fh = fi ? fi->fh : 0;
   send_to_js(req, d);
 }
 
 static void fuse_fsync(fuse_req_t req, fuse_ino_t ino, int datasync, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "fsync", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_FSYNC);
   d->u.fsync.ino = ino;
   d->u.fsync.fh = fi ? fi->fh : 0;
   d->u.fsync.datasync = datasync;
@@ -776,27 +2007,21 @@ static void fuse_fsync(fuse_req_t req, fuse_ino_t ino, int datasync, struct fuse
 }
 
 static void fuse_opendir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "opendir", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_OPENDIR);
   d->u.opendir.ino = ino;
   d->u.opendir.flags = fi ? fi->flags : 0;
   send_to_js(req, d);
 }
 
 static void fuse_releasedir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "releasedir", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_RELEASEDIR);
   d->u.releasedir.ino = ino;
   d->u.releasedir.fh = fi ? fi->fh : 0;
   send_to_js(req, d);
 }
 
 static void fuse_fsyncdir(fuse_req_t req, fuse_ino_t ino, int datasync, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "fsyncdir", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_FSYNCDIR);
   d->u.fsyncdir.ino = ino;
   d->u.fsyncdir.fh = fi ? fi->fh : 0;
   d->u.fsyncdir.datasync = datasync;
@@ -804,57 +2029,49 @@ static void fuse_fsyncdir(fuse_req_t req, fuse_ino_t ino, int datasync, struct f
 }
 
 static void fuse_readlink(fuse_req_t req, fuse_ino_t ino) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "readlink", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_READLINK);
   d->u.readlink.ino = ino;
   send_to_js(req, d);
 }
 
 static void fuse_symlink(fuse_req_t req, const char *link, fuse_ino_t parent, const char *name) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "symlink", sizeof(d->op) - 1);
-  d->u.symlink.link = strdup(link);
+  attr_cache_drop_entry(req_cache(req), parent, name);
+  struct req_data *d = req_alloc(req, OP_SYMLINK);
+  d->u.symlink.link = req_strdup(d, link);
   d->u.symlink.parent = parent;
-  d->u.symlink.name = strdup(name);
+  d->u.symlink.name = req_strdup(d, name);
   send_to_js(req, d);
 }
 
 static void fuse_link(fuse_req_t req, fuse_ino_t ino, fuse_ino_t newparent, const char *newname) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "link", sizeof(d->op) - 1);
+  attr_cache_drop_attr(req_cache(req), ino);
+  attr_cache_drop_entry(req_cache(req), newparent, newname);
+  struct req_data *d = req_alloc(req, OP_LINK);
   d->u.link.ino = ino;
   d->u.link.newparent = newparent;
-  d->u.link.newname = strdup(newname);
+  d->u.link.newname = req_strdup(d, newname);
   send_to_js(req, d);
 }
 
 static void fuse_mknod(fuse_req_t req, fuse_ino_t parent, const char *name, mode_t mode, dev_t rdev) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "mknod", sizeof(d->op) - 1);
+  attr_cache_drop_entry(req_cache(req), parent, name);
+  struct req_data *d = req_alloc(req, OP_MKNOD);
   d->u.mknod.parent = parent;
-  d->u.mknod.name = strdup(name);
+  d->u.mknod.name = req_strdup(d, name);
   d->u.mknod.mode = mode;
   d->u.mknod.rdev = rdev;
   send_to_js(req, d);
 }
 
 static void fuse_access(fuse_req_t req, fuse_ino_t ino, int mask) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "access", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_ACCESS);
   d->u.access.ino = ino;
   d->u.access.mask = mask;
   send_to_js(req, d);
 }
 
 static void fuse_statfs(fuse_req_t req, fuse_ino_t ino) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "statfs", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_STATFS);
   d->u.statfs.ino = ino;
   d->u.statfs.fh = 0; // statfs doesn't have fi in standard lowlevel, but our struct has it for future-proofing
   send_to_js(req, d);
@@ -862,11 +2079,10 @@ static void fuse_statfs(fuse_req_t req, fuse_ino_t ino) {
 
 static void fuse_setxattr(fuse_req_t req, fuse_ino_t ino, const char *name, const char *value, size_t size, int flags, uint32_t unused) {
   (void)unused;
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "setxattr", sizeof(d->op) - 1);
+  attr_cache_drop_attr(req_cache(req), ino);
+  struct req_data *d = req_alloc(req, OP_SETXATTR);
   d->u.setxattr.ino = ino;
-  d->u.setxattr.name = strdup(name);
+  d->u.setxattr.name = req_strdup(d, name);
   d->u.setxattr.value = malloc(size);
   memcpy(d->u.setxattr.value, value, size);
   d->u.setxattr.size = size;
@@ -876,37 +2092,30 @@ static void fuse_setxattr(fuse_req_t req, fuse_ino_t ino, const char *name, cons
 
 static void fuse_getxattr(fuse_req_t req, fuse_ino_t ino, const char *name, size_t size, uint32_t unused) {
   (void)unused;
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "getxattr", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_GETXATTR);
   d->u.getxattr.ino = ino;
-  d->u.getxattr.name = strdup(name);
+  d->u.getxattr.name = req_strdup(d, name);
   d->u.getxattr.size = size;
   send_to_js(req, d);
 }
 
 static void fuse_listxattr(fuse_req_t req, fuse_ino_t ino, size_t size) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "listxattr", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_LISTXATTR);
   d->u.listxattr.ino = ino;
   d->u.listxattr.size = size;
   send_to_js(req, d);
 }
 
 static void fuse_removexattr(fuse_req_t req, fuse_ino_t ino, const char *name) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "removexattr", sizeof(d->op) - 1);
+  attr_cache_drop_attr(req_cache(req), ino);
+  struct req_data *d = req_alloc(req, OP_REMOVEXATTR);
   d->u.removexattr.ino = ino;
-  d->u.removexattr.name = strdup(name);
+  d->u.removexattr.name = req_strdup(d, name);
   send_to_js(req, d);
 }
 
 static void fuse_getlk(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi, struct flock *lock) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "getlk", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_GETLK);
   d->u.getlk.ino = ino;
   d->u.getlk.fh = fi ? fi->fh : 0;
   d->u.getlk.lock = *lock;
@@ -914,9 +2123,7 @@ static void fuse_getlk(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi
 }
 
 static void fuse_setlk(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi, struct flock *lock, int sleep) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "setlk", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_SETLK);
   d->u.setlk.ino = ino;
   d->u.setlk.fh = fi ? fi->fh : 0;
   d->u.setlk.lock = *lock;
@@ -925,9 +2132,7 @@ static void fuse_setlk(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi
 }
 
 static void fuse_flock(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi, int op) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "flock", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_FLOCK);
   d->u.flock.ino = ino;
   d->u.flock.fh = fi ? fi->fh : 0;
   d->u.flock.op = op;
@@ -935,9 +2140,7 @@ static void fuse_flock(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi
 }
 
 static void fuse_bmap(fuse_req_t req, fuse_ino_t ino, size_t blocksize, uint64_t idx) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "bmap", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_BMAP);
   d->u.bmap.ino = ino;
   d->u.bmap.blocksize = blocksize;
   d->u.bmap.idx = idx;
@@ -946,9 +2149,7 @@ static void fuse_bmap(fuse_req_t req, fuse_ino_t ino, size_t blocksize, uint64_t
 
 #if FUSE_USE_VERSION >= 35
 static void fuse_ioctl(fuse_req_t req, fuse_ino_t ino, unsigned int cmd, void *arg, struct fuse_file_info *fi, unsigned flags, const void *in_buf, size_t in_bufsz, size_t out_bufsz) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "ioctl", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_IOCTL);
   d->u.ioctl.ino = ino;
   d->u.ioctl.cmd = cmd;
   d->u.ioctl.fh = fi ? fi->fh : 0;
@@ -964,18 +2165,15 @@ static void fuse_ioctl(fuse_req_t req, fuse_ino_t ino, unsigned int cmd, void *a
 #endif
 
 static void fuse_poll(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi, struct fuse_pollhandle *ph) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "poll", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_POLL);
   d->u.poll.ino = ino;
   d->u.poll.fh = fi ? fi->fh : 0;
   send_to_js(req, d);
 }
 
 static void fuse_fallocate(fuse_req_t req, fuse_ino_t ino, int mode, off_t offset, off_t length, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "fallocate", sizeof(d->op) - 1);
+  attr_cache_drop_attr(req_cache(req), ino);
+  struct req_data *d = req_alloc(req, OP_FALLOCATE);
   d->u.fallocate.ino = ino;
   d->u.fallocate.fh = fi ? fi->fh : 0;
   d->u.fallocate.offset = offset;
@@ -985,9 +2183,7 @@ static void fuse_fallocate(fuse_req_t req, fuse_ino_t ino, int mode, off_t offse
 }
 
 static void fuse_readdirplus(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "readdirplus", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_READDIRPLUS);
   d->u.readdirplus.ino = ino;
   d->u.readdirplus.fh = fi ? fi->fh : 0;
   d->u.readdirplus.size = size;
@@ -996,9 +2192,8 @@ static void fuse_readdirplus(fuse_req_t req, fuse_ino_t ino, size_t size, off_t
 }
 
 static void fuse_copy_file_range(fuse_req_t req, fuse_ino_t ino_in, off_t off_in, struct fuse_file_info *fi_in, fuse_ino_t ino_out, off_t off_out, struct fuse_file_info *fi_out, size_t len, int flags) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "copy_file_range", sizeof(d->op) - 1);
+  attr_cache_drop_attr(req_cache(req), ino_out);
+  struct req_data *d = req_alloc(req, OP_COPY_FILE_RANGE);
   d->u.copy_file_range.ino_in = ino_in;
   d->u.copy_file_range.fh_in = fi_in ? fi_in->fh : 0;
   d->u.copy_file_range.off_in = off_in;
@@ -1011,9 +2206,7 @@ static void fuse_copy_file_range(fuse_req_t req, fuse_ino_t ino_in, off_t off_in
 }
 
 static void fuse_lseek(fuse_req_t req, fuse_ino_t ino, off_t off, int whence, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "lseek", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_LSEEK);
   d->u.lseek.ino = ino;
   d->u.lseek.fh = fi ? fi->fh : 0;
   d->u.lseek.off = off;
@@ -1022,9 +2215,7 @@ static void fuse_lseek(fuse_req_t req, fuse_ino_t ino, off_t off, int whence, st
 }
 
 static void fuse_tmpfile(fuse_req_t req, fuse_ino_t parent, mode_t mode, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "tmpfile", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_TMPFILE);
   d->u.tmpfile.parent = parent;
   d->u.tmpfile.mode = mode;
   d->u.tmpfile.flags = fi ? fi->flags : 0;
@@ -1032,9 +2223,7 @@ static void fuse_tmpfile(fuse_req_t req, fuse_ino_t parent, mode_t mode, struct
 }
 
 static void __attribute__((unused)) fuse_statx(fuse_req_t req, fuse_ino_t ino, int flags, int mask, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "statx", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_STATX);
   d->u.statx.ino = ino;
   d->u.statx.flags = flags;
   d->u.statx.mask = mask;
@@ -1042,9 +2231,8 @@ static void __attribute__((unused)) fuse_statx(fuse_req_t req, fuse_ino_t ino, i
 }
 
 static void fuse_write_buf(fuse_req_t req, fuse_ino_t ino, struct fuse_bufvec *bufv, off_t off, struct fuse_file_info *fi) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "write_buf", sizeof(d->op) - 1);
+  attr_cache_drop_attr(req_cache(req), ino);
+  struct req_data *d = req_alloc(req, OP_WRITE_BUF);
   d->u.write_buf.ino = ino;
   d->u.write_buf.fh = fi ? fi->fh : 0;
   d->u.write_buf.off = off;
@@ -1057,9 +2245,7 @@ static void fuse_write_buf(fuse_req_t req, fuse_ino_t ino, struct fuse_bufvec *b
 }
 
 static void fuse_retrieve_reply(fuse_req_t req, void *cookie, fuse_ino_t ino, off_t offset, struct fuse_bufvec *bufv) {
-  struct req_data *d = calloc(1, sizeof(struct req_data));
-  d->req = req;
-  strncpy(d->op, "retrieve_reply", sizeof(d->op) - 1);
+  struct req_data *d = req_alloc(req, OP_RETRIEVE_REPLY);
   d->u.retrieve_reply.ino = ino;
   d->u.retrieve_reply.cookie = cookie;
   d->u.retrieve_reply.offset = offset;
@@ -1070,20 +2256,337 @@ static void fuse_retrieve_reply(fuse_req_t req, void *cookie, fuse_ino_t ino, of
   send_to_js(req, d);
 }
 
+static int run_session_loop(struct mount_ctx *m) {
+  struct fuse_session *se = m->session;
+  const struct mount_config *cfg = &m->config;
+  if (cfg->threads <= 1) {
+    return fuse_session_loop(se);
+  }
+  struct fuse_loop_config *loop_cfg = fuse_loop_cfg_create();
+  if (!loop_cfg) {
+    if (is_debug_enabled()) {
+      fprintf(stderr, "[FUSE:loop] Failed to create loop config, falling back to single-threaded loop\n");
+    }
+    return fuse_session_loop(se);
+  }
+  fuse_loop_cfg_set_clone_fd(loop_cfg, cfg->clone_fd);
+  fuse_loop_cfg_set_max_threads(loop_cfg, cfg->threads);
+  if (cfg->max_idle_threads >= 0) {
+    fuse_loop_cfg_set_idle_threads(loop_cfg, (unsigned int)cfg->max_idle_threads);
+  }
+  int res = fuse_session_loop_mt(se, loop_cfg);
+  fuse_loop_cfg_destroy(loop_cfg);
+  return res;
+}
+
+static void mount_unref(struct mount_ctx *m);
+
+static void destroy_session(struct mount_ctx *m) {
+  pthread_rwlock_wrlock(&m->session_lock);
+  fuse_session_destroy(m->session);
+  m->session = NULL;
+  pthread_rwlock_unlock(&m->session_lock);
+}
+
 static void *fuse_loop_thread(void *arg) {
-  struct fuse_session *se = (struct fuse_session *)arg;
-  fuse_running = 1;
-  int res = fuse_session_loop(se);
-  fuse_running = 0;
+  struct mount_ctx *m = arg;
+  int res = run_session_loop(m);
+  atomic_store(&m->running, 0);
   if (is_debug_enabled()) {
     fprintf(stderr, "[FUSE:loop] Session loop exited with code %d\n", res);
   }
+  // unmount() stopped waiting for us; the session and a reference to m are ours
+  if (atomic_exchange(&m->loop_state, LOOP_DONE) == LOOP_ORPHANED) {
+    destroy_session(m);
+    mount_unref(m);
+  }
+  return NULL;
+}
+
+static int get_config_int(napi_env env, napi_value config, const char *key, int64_t *out) {
+  bool has = false;
+  if (napi_has_named_property(env, config, key, &has) != napi_ok || !has) return 0;
+  napi_value val;
+  napi_get_named_property(env, config, key, &val);
+  napi_valuetype type;
+  napi_typeof(env, val, &type);
+  if (type == napi_boolean) {
+    bool b;
+    napi_get_value_bool(env, val, &b);
+    *out = b ? 1 : 0;
+    return 1;
+  }
+  if (type != napi_number) return 0;
+  return napi_get_value_int64(env, val, out) == napi_ok;
+}
+
+static int get_config_double(napi_env env, napi_value config, const char *key, double *out) {
+  bool has = false;
+  if (napi_has_named_property(env, config, key, &has) != napi_ok || !has) return 0;
+  napi_value val;
+  napi_get_named_property(env, config, key, &val);
+  napi_valuetype type;
+  napi_typeof(env, val, &type);
+  if (type != napi_number) return 0;
+  return napi_get_value_double(env, val, out) == napi_ok;
+}
+
+static void parse_mount_config(napi_env env, napi_value config, struct mount_config *mc) {
+  int64_t num_val;
+  double dbl_val;
+  *mc = (struct mount_config)MOUNT_CONFIG_DEFAULTS;
+  if (get_config_int(env, config, "threads", &num_val) && num_val > 1) {
+    mc->threads = (uint32_t)num_val;
+  }
+  if (get_config_int(env, config, "clone_fd", &num_val)) {
+    mc->clone_fd = num_val ? 1 : 0;
+  }
+  if (get_config_int(env, config, "max_idle_threads", &num_val) && num_val >= 0) {
+    mc->max_idle_threads = (int32_t)num_val;
+  }
+  if (get_config_double(env, config, "entry_timeout", &dbl_val) && dbl_val >= 0) {
+    mc->entry_timeout = dbl_val;
+  }
+  if (get_config_double(env, config, "attr_timeout", &dbl_val) && dbl_val >= 0) {
+    mc->attr_timeout = dbl_val;
+  }
+  if (get_config_int(env, config, "keep_cache", &num_val) && num_val) {
+    mc->open_flags |= OPEN_KEEP_CACHE;
+  }
+  if (get_config_int(env, config, "direct_io", &num_val) && num_val) {
+    mc->open_flags |= OPEN_DIRECT_IO;
+  }
+  if (get_config_int(env, config, "parallel_direct_writes", &num_val) && num_val) {
+    mc->open_flags |= OPEN_PARALLEL_DIRECT_WRITES;
+  }
+  if (get_config_int(env, config, "writeback_cache", &num_val)) {
+    mc->writeback_cache = num_val ? 1 : 0;
+  }
+  if (get_config_int(env, config, "auto_inval_data", &num_val)) {
+    mc->auto_inval_data = num_val ? 1 : 0;
+  }
+  if (get_config_int(env, config, "max_write", &num_val) && num_val > 0 && num_val <= UINT32_MAX) {
+    mc->max_write = (uint32_t)num_val;
+  }
+  if (get_config_int(env, config, "max_read", &num_val) && num_val > 0 && num_val <= UINT32_MAX) {
+    mc->max_read = (uint32_t)num_val;
+  }
+  if (get_config_int(env, config, "max_readahead", &num_val) && num_val > 0 && num_val <= UINT32_MAX) {
+    mc->max_readahead = (uint32_t)num_val;
+  }
+  if (get_config_int(env, config, "max_pages", &num_val) && num_val > 0 && num_val <= UINT16_MAX) {
+    mc->max_pages = (uint32_t)num_val;
+  }
+  if (get_config_int(env, config, "max_background", &num_val) && num_val > 0 && num_val <= UINT16_MAX) {
+    mc->max_background = (uint32_t)num_val;
+  }
+  if (get_config_int(env, config, "congestion_threshold", &num_val) && num_val > 0 && num_val <= UINT16_MAX) {
+    mc->congestion_threshold = (uint32_t)num_val;
+  }
+  if (get_config_int(env, config, "batch_size", &num_val) && num_val > 0) {
+    mc->batch_size = num_val > MAX_BATCH_SIZE ? MAX_BATCH_SIZE : (uint32_t)num_val;
+  }
+  if (get_config_double(env, config, "native_cache_timeout", &dbl_val) && dbl_val >= 0) {
+    mc->cache_timeout = dbl_val;
+  }
+  if (get_config_int(env, config, "native_cache_max_entries", &num_val) && num_val > 0 && num_val <= UINT32_MAX) {
+    mc->cache_max_entries = (uint32_t)num_val;
+  }
+  if (get_config_double(env, config, "negative_timeout", &dbl_val) && dbl_val >= 0) {
+    mc->negative_timeout = dbl_val;
+  }
+  if (get_config_int(env, config, "workers", &num_val) && num_val > 0) {
+    mc->workers = num_val > MAX_WORKERS ? MAX_WORKERS : (uint32_t)num_val;
+  }
+  if (get_config_int(env, config, "shard_by_inode", &num_val)) {
+    mc->shard_by_inode = num_val ? 1 : 0;
+  }
+  for (int l = 0; l < LANE_COUNT; l++) {
+    char key[32];
+    snprintf(key, sizeof(key), "queue_%s", lane_names[l]);
+    if (get_config_int(env, config, key, &num_val) && num_val >= 0 && num_val <= UINT32_MAX) {
+      mc->queue_limits[l] = (uint32_t)num_val;
+    }
+  }
+  if (get_config_int(env, config, "passthrough", &num_val)) {
+    mc->passthrough = num_val ? 1 : 0;
+  }
+  if (get_config_int(env, config, "io_uring", &num_val)) {
+    mc->io_uring = num_val ? 1 : 0;
+  }
+  if (get_config_int(env, config, "io_uring_depth", &num_val) && num_val > 0 && num_val <= UINT32_MAX) {
+    mc->io_uring_depth = (uint32_t)num_val;
+  }
+  if (get_config_int(env, config, "ops", &num_val) && num_val >= 0) {
+    mc->ops = (uint32_t)num_val & OPS_ALL;
+  }
+}
+
+// Turns the raw options object into -o arguments. "1"/"true" adds a flag,
+// "0"/"false" leaves it out, anything else is passed as key=value.
+static void add_mount_options(napi_env env, napi_value options, struct fuse_args *fargs) {
+  napi_valuetype type;
+  if (napi_typeof(env, options, &type) != napi_ok || type != napi_object) return;
+  napi_value keys;
+  if (napi_get_property_names(env, options, &keys) != napi_ok) return;
+  uint32_t count = 0;
+  napi_get_array_length(env, keys, &count);
+  for (uint32_t i = 0; i < count; i++) {
+    napi_value key, val, str;
+    char name[128], value[256], arg[400];
+    napi_get_element(env, keys, i, &key);
+    napi_get_property(env, options, key, &val);
+    if (napi_coerce_to_string(env, val, &str) != napi_ok) continue;
+    napi_get_value_string_utf8(env, key, name, sizeof(name), NULL);
+    napi_get_value_string_utf8(env, str, value, sizeof(value), NULL);
+    if (strcmp(value, "0") == 0 || strcmp(value, "false") == 0) continue;
+    if (value[0] == '\0' || strcmp(value, "1") == 0 || strcmp(value, "true") == 0) {
+      snprintf(arg, sizeof(arg), "-o%s", name);
+    } else {
+      snprintf(arg, sizeof(arg), "-o%s=%s", name, value);
+    }
+    fuse_opt_add_arg(fargs, arg);
+  }
+}
+
+// Optional trailing reply arguments; undefined falls back to the mount default
+static double opt_double(napi_env env, napi_value *args, size_t argc, size_t i, double def) {
+  if (i >= argc) return def;
+  double val;
+  if (napi_get_value_double(env, args[i], &val) != napi_ok) return def;
+  return val;
+}
+
+static uint32_t opt_uint32(napi_env env, napi_value *args, size_t argc, size_t i, uint32_t def) {
+  if (i >= argc) return def;
+  uint32_t val;
+  if (napi_get_value_uint32(env, args[i], &val) != napi_ok) return def;
+  return val;
+}
+
+static int64_t arg_i64(napi_env env, napi_value *args, size_t argc, size_t i, int64_t def) {
+  if (i >= argc) return def;
+  int64_t val;
+  if (napi_get_value_int64(env, args[i], &val) != napi_ok) return def;
+  return val;
+}
+
+static char *arg_string(napi_env env, napi_value *args, size_t argc, size_t i) {
+  if (i >= argc) return NULL;
+  size_t len;
+  if (napi_get_value_string_utf8(env, args[i], NULL, 0, &len) != napi_ok) return NULL;
+  char *str = malloc(len + 1);
+  if (str) napi_get_value_string_utf8(env, args[i], str, len + 1, &len);
+  return str;
+}
+
+static void mount_free_shards(struct mount_ctx *m) {
+  free(m->main.stats);
+  for (uint32_t i = 0; m->workers && i < m->config.workers; i++) free(m->workers[i].stats);
+  free(m->workers);
+}
+
+static void mount_unref(struct mount_ctx *m) {
+  if (atomic_fetch_sub(&m->refs, 1) != 1) return;
+  attr_cache_clear(&m->cache);
+  backing_clear(&m->backing);
+  pthread_mutex_destroy(&m->backing.lock);
+  pthread_rwlock_destroy(&m->cache.lock);
+  pthread_rwlock_destroy(&m->session_lock);
+  pthread_mutex_destroy(&m->admit_lock);
+  pthread_cond_destroy(&m->admit_cond);
+  mount_free_shards(m);
+  free(m);
+}
+
+static void mount_handle_finalize(napi_env env, void *data, void *hint) {
+  (void)env;
+  (void)hint;
+  mount_unref(data);
+}
+
+// The last FUSE thread is gone and queued requests have been failed; let JS collect the handle
+static void mount_tsfn_finalize(napi_env env, void *data, void *hint) {
+  (void)hint;
+  struct mount_ctx *m = data;
+  napi_delete_reference(env, m->self);
+  m->self = NULL;
+}
+
+// Runs in the worker's isolate, after unmount() released it or when the worker exits
+static void worker_tsfn_finalize(napi_env env, void *data, void *hint) {
+  (void)hint;
+  struct shard *sh = data;
+  pthread_mutex_lock(&g_mounts_lock);
+  sh->tsfn = NULL;
+  pthread_mutex_unlock(&g_mounts_lock);
+  inflight_purge(get_addon_data(env), sh);
+  mount_unref(sh->mount);
+}
+
+static void mount_unregister(struct mount_ctx *m) {
+  pthread_mutex_lock(&g_mounts_lock);
+  for (struct mount_ctx **mp = &g_mounts; *mp; mp = &(*mp)->next_live) {
+    if (*mp == m) {
+      *mp = m->next_live;
+      break;
+    }
+  }
+  // Workers that never attached can no longer do so; release the ones that did
+  for (uint32_t i = 0; i < m->config.workers; i++) {
+    if (m->workers[i].tsfn) napi_release_threadsafe_function(m->workers[i].tsfn, napi_tsfn_release);
+  }
+  pthread_mutex_unlock(&g_mounts_lock);
+}
+
+static int start_loop(struct mount_ctx *m) {
+  atomic_store(&m->running, 1);
+  atomic_store(&m->loop_state, LOOP_RUNNING);
+  if (pthread_create(&m->thread, NULL, fuse_loop_thread, m) != 0) {
+    atomic_store(&m->running, 0);
+    return -1;
+  }
+  m->thread_started = 1;
+  return 0;
+}
+
+static struct mount_ctx *get_mount(napi_env env, napi_value *args, size_t argc, size_t i) {
+  napi_valuetype type = napi_undefined;
+  if (i < argc) napi_typeof(env, args[i], &type);
+  void *m = NULL;
+  if (type != napi_external || napi_get_value_external(env, args[i], &m) != napi_ok || !m) {
+    napi_throw_type_error(env, NULL, "Expected a mount handle");
+    return NULL;
+  }
+  return m;
+}
+
+// Tears down a mount that failed part way; the handle is freed once JS drops it
+static napi_value mount_failed(napi_env env, struct mount_ctx *m, struct fuse_args *fargs, char *mountpoint, const char *msg) {
+  if (m->session) {
+    fuse_session_destroy(m->session);
+    m->session = NULL;
+  }
+  mount_unregister(m);
+  if (m->main.tsfn) {
+    napi_release_threadsafe_function(m->main.tsfn, napi_tsfn_release);
+  } else {
+    napi_delete_reference(env, m->self);
+    m->self = NULL;
+  }
+  fuse_opt_free_args(fargs);
+  free(mountpoint);
+  napi_throw_error(env, NULL, msg);
   return NULL;
 }
 
+// mount(mountpoint, options, handler, config?) -> handle
+// Each call creates an independent session with its own loop threads, request queue
+// and native cache. With config.workers the loop only starts once start() is called,
+// after every worker has attached.
 static napi_value fuse_napi_mount(napi_env env, napi_callback_info info) {
-  size_t argc = 3;
-  napi_value args[3];
+  size_t argc = 4;
+  napi_value args[4];
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
   if (argc < 3) {
@@ -1112,40 +2615,93 @@ static napi_value fuse_napi_mount(napi_env env, napi_callback_info info) {
     return NULL;
   }
   
-  if (is_debug_enabled()) {
-    fprintf(stderr, "[FUSE:mount] Mounting filesystem at %s\n", mountpoint);
+  struct mount_ctx *m = calloc(1, sizeof(*m));
+  if (!m) {
+    free(mountpoint);
+    napi_throw_error(env, NULL, "Failed to allocate mount");
+    return NULL;
   }
-  
-  napi_value resource_name;
-  napi_create_string_utf8(env, "fuse", NAPI_AUTO_LENGTH, &resource_name);
-  // Create threadsafe function with proper queue size
-  // max_queue_size = 0 means unlimited, initial_thread_count = 1
-  status = napi_create_threadsafe_function(env, args[2], NULL, resource_name, 0, 1, NULL, NULL, NULL, call_js, &tsfn);
-  if (status != napi_ok) {
+  m->config = (struct mount_config)MOUNT_CONFIG_DEFAULTS;
+  if (argc > 3) {
+    napi_valuetype config_type;
+    napi_typeof(env, args[3], &config_type);
+    if (config_type == napi_object) {
+      parse_mount_config(env, args[3], &m->config);
+    }
+  }
+  if (m->config.workers) {
+    m->workers = calloc(m->config.workers, sizeof(struct shard));
+  }
+  int allocated = !m->config.workers || m->workers;
+  m->main.stats = calloc(OP_COUNT, sizeof(struct op_stats));
+  allocated = allocated && m->main.stats;
+  for (uint32_t i = 0; allocated && i < m->config.workers; i++) {
+    m->workers[i].stats = calloc(OP_COUNT, sizeof(struct op_stats));
+    allocated = m->workers[i].stats != NULL;
+  }
+  if (!allocated) {
+    mount_free_shards(m);
+    free(m);
     free(mountpoint);
-    napi_throw_error(env, NULL, "Failed to create threadsafe function");
+    napi_throw_error(env, NULL, "Failed to allocate mount");
     return NULL;
   }
+  pthread_rwlock_init(&m->session_lock, NULL);
+  pthread_rwlock_init(&m->cache.lock, NULL);
+  pthread_mutex_init(&m->admit_lock, NULL);
+  pthread_mutex_init(&m->backing.lock, NULL);
+  pthread_cond_init(&m->admit_cond, NULL);
+  m->cache.max_entries = m->config.cache_max_entries;
+  atomic_store(&m->refs, 1);
+  m->main.mount = m;
+  for (int l = 0; l < LANE_COUNT; l++) req_queue_init(&m->main.lanes[l]);
+  for (uint32_t i = 0; i < m->config.workers; i++) {
+    m->workers[i].mount = m;
+    for (int l = 0; l < LANE_COUNT; l++) req_queue_init(&m->workers[i].lanes[l]);
+  }
   
-  // Acquire the threadsafe function to allow calls from other threads
-  status = napi_acquire_threadsafe_function(tsfn);
-  if (status != napi_ok) {
+  napi_value handle;
+  if (napi_create_external(env, m, mount_handle_finalize, NULL, &handle) != napi_ok) {
+    mount_handle_finalize(env, m, NULL);
     free(mountpoint);
-    napi_release_threadsafe_function(tsfn, napi_tsfn_release);
-    tsfn = NULL;
-    napi_throw_error(env, NULL, "Failed to acquire threadsafe function");
+    napi_throw_error(env, NULL, "Failed to create mount handle");
     return NULL;
   }
+  napi_create_reference(env, handle, 1, &m->self);
+  
+  if (is_debug_enabled()) {
+    fprintf(stderr, "[FUSE:mount] Mounting filesystem at %s (threads=%u, clone_fd=%u)\n", mountpoint, m->config.threads, m->config.clone_fd);
+  }
   
   struct fuse_args fargs = FUSE_ARGS_INIT(0, NULL);
+  
+  napi_value resource_name;
+  napi_create_string_utf8(env, "fuse", NAPI_AUTO_LENGTH, &resource_name);
+  // max_queue_size = 0: the native lanes do the buffering and bounding. The single
+  // thread count is released by unmount(), which finalizes the function.
+  status = napi_create_threadsafe_function(env, args[2], NULL, resource_name, 0, 1, m, mount_tsfn_finalize, &m->main, call_js, &m->main.tsfn);
+  if (status != napi_ok) {
+    m->main.tsfn = NULL;
+    return mount_failed(env, m, &fargs, mountpoint, "Failed to create threadsafe function");
+  }
+  
   fuse_opt_add_arg(&fargs, "mount0");
+  add_mount_options(env, args[1], &fargs);
+  if (m->config.max_read) {
+    // libfuse requires max_read both as a mount option and in fuse_conn_info
+    char max_read_arg[32];
+    snprintf(max_read_arg, sizeof(max_read_arg), "-omax_read=%u", m->config.max_read);
+    fuse_opt_add_arg(&fargs, max_read_arg);
+  }
   
   struct fuse_lowlevel_ops ops = {0};
   ops.init = fuse_init;
   ops.destroy = fuse_destroy;
   ops.lookup = fuse_lookup;
   ops.forget = fuse_forget;
-  ops.forget_multi = fuse_forget_multi;
+  // Without forget_multi libfuse sends batched forgets one inode at a time, so each
+  // reaches the worker that owns the inode
+  if (!(m->config.workers && m->config.shard_by_inode)) ops.forget_multi = fuse_forget_multi;
   ops.getattr = fuse_getattr;
   ops.setattr = fuse_setattr;
   ops.readlink = fuse_readlink;
@@ -1168,152 +2724,422 @@ static napi_value fuse_napi_mount(napi_env env, napi_callback_info info) {
   ops.releasedir = fuse_releasedir;
   ops.fsyncdir = fuse_fsyncdir;
   ops.statfs = fuse_statfs;
-  ops.setxattr = fuse_setxattr;
-  ops.getxattr = fuse_getxattr;
-  ops.listxattr = fuse_listxattr;
-  ops.removexattr = fuse_removexattr;
-  ops.access = fuse_access;
   ops.create = fuse_create;
-  ops.getlk = fuse_getlk;
-  ops.setlk = fuse_setlk;
-  ops.bmap = fuse_bmap;
-#if FUSE_USE_VERSION >= 35
-  ops.ioctl = fuse_ioctl;
-#endif
-  ops.poll = fuse_poll;
-  ops.flock = fuse_flock;
-  ops.fallocate = fuse_fallocate;
-  ops.readdirplus = fuse_readdirplus;
-  ops.copy_file_range = fuse_copy_file_range;
-  ops.lseek = fuse_lseek;
-  ops.tmpfile = fuse_tmpfile;
 #ifdef FUSE_STATX
   ops.statx = fuse_statx;
 #endif
+  // libfuse only offers READDIRPLUS, POSIX_LOCKS and FLOCK_LOCKS to the kernel
+  // when the matching ops are registered
+  uint32_t optional = m->config.ops;
+  if (optional & OPS_XATTR) {
+    ops.setxattr = fuse_setxattr;
+    ops.getxattr = fuse_getxattr;
+    ops.listxattr = fuse_listxattr;
+    ops.removexattr = fuse_removexattr;
+  }
+  if (optional & OPS_ACCESS) ops.access = fuse_access;
+  if (optional & OPS_POSIX_LOCKS) {
+    ops.getlk = fuse_getlk;
+    ops.setlk = fuse_setlk;
+  }
+  if (optional & OPS_BMAP) ops.bmap = fuse_bmap;
+#if FUSE_USE_VERSION >= 35
+  if (optional & OPS_IOCTL) ops.ioctl = fuse_ioctl;
+#endif
+  if (optional & OPS_POLL) ops.poll = fuse_poll;
+  if (optional & OPS_FLOCK) ops.flock = fuse_flock;
+  if (optional & OPS_FALLOCATE) ops.fallocate = fuse_fallocate;
+  if (optional & OPS_READDIRPLUS) ops.readdirplus = fuse_readdirplus;
+  if (optional & OPS_COPY_FILE_RANGE) ops.copy_file_range = fuse_copy_file_range;
+  if (optional & OPS_LSEEK) ops.lseek = fuse_lseek;
+  if (optional & OPS_TMPFILE) ops.tmpfile = fuse_tmpfile;
   ops.retrieve_reply = fuse_retrieve_reply;
   
-  g_session = fuse_session_new(&fargs, &ops, sizeof(ops), NULL);
-  if (!g_session) {
-    fuse_opt_free_args(&fargs);
-    free(mountpoint);
-    napi_throw_error(env, NULL, "Failed to create fuse session");
+  // The io_uring options go last so they can be dropped again if this libfuse
+  // rejects them
+  int uring_args = 0;
+#if HAVE_FUSE_IO_URING
+  if (m->config.io_uring) {
+    fuse_opt_add_arg(&fargs, "-oio_uring");
+    uring_args++;
+    if (m->config.io_uring_depth) {
+      char depth_arg[40];
+      snprintf(depth_arg, sizeof(depth_arg), "-oio_uring_q_depth=%u", m->config.io_uring_depth);
+      fuse_opt_add_arg(&fargs, depth_arg);
+      uring_args++;
+    }
+  }
+#else
+  if (m->config.io_uring && is_debug_enabled()) {
+    fprintf(stderr, "[FUSE:mount] libfuse was built without io_uring support, using /dev/fuse\n");
+  }
+#endif
+  
+  m->session = fuse_session_new(&fargs, &ops, sizeof(ops), m);
+  if (!m->session && uring_args) {
+    if (is_debug_enabled()) {
+      fprintf(stderr, "[FUSE:mount] Session rejected io_uring options, retrying with /dev/fuse\n");
+    }
+    while (uring_args--) {
+      free(fargs.argv[--fargs.argc]);
+      fargs.argv[fargs.argc] = NULL;
+    }
+    m->session = fuse_session_new(&fargs, &ops, sizeof(ops), m);
+  }
+  if (!m->session) {
+    return mount_failed(env, m, &fargs, mountpoint, "Failed to create fuse session");
+  }
+  
+  if (fuse_session_mount(m->session, mountpoint) != 0) {
+    return mount_failed(env, m, &fargs, mountpoint, "Failed to mount fuse filesystem");
+  }
+  
+  if (!m->config.workers && start_loop(m) != 0) {
+    fuse_session_unmount(m->session);
+    return mount_failed(env, m, &fargs, mountpoint, "Failed to create fuse thread");
+  }
+  
+  pthread_mutex_lock(&g_mounts_lock);
+  m->id = g_next_mount_id++;
+  m->next_live = g_mounts;
+  g_mounts = m;
+  pthread_mutex_unlock(&g_mounts_lock);
+  
+  free(mountpoint);
+  fuse_opt_free_args(&fargs);
+  return handle;
+}
+
+// mount_id(handle): identifies the mount to attach_worker() in another isolate
+static napi_value fuse_napi_mount_id(napi_env env, napi_callback_info info) {
+  napi_value args[1];
+  size_t argc = 1;
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  struct mount_ctx *m = get_mount(env, args, argc, 0);
+  if (!m) return NULL;
+  napi_value result;
+  napi_create_uint32(env, m->id, &result);
+  return result;
+}
+
+// attach_worker(mountId, index, handler): called from a worker_thread to receive the
+// requests routed to worker index, as batches in the same format mount() delivers
+static napi_value fuse_napi_attach_worker(napi_env env, napi_callback_info info) {
+  napi_value args[3];
+  size_t argc = 3;
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  if (argc < 3) {
+    napi_throw_error(env, NULL, "attach_worker requires 3 arguments: mountId, index, handler");
     return NULL;
   }
+  uint32_t id = (uint32_t)arg_i64(env, args, argc, 0, 0);
+  int64_t index = arg_i64(env, args, argc, 1, -1);
   
-  if (fuse_session_mount(g_session, mountpoint) != 0) {
-    fuse_session_destroy(g_session);
-    g_session = NULL;
-    fuse_opt_free_args(&fargs);
-    free(mountpoint);
-    napi_throw_error(env, NULL, "Failed to mount fuse filesystem");
+  napi_value resource_name;
+  napi_create_string_utf8(env, "fuse_worker", NAPI_AUTO_LENGTH, &resource_name);
+  const char *err = NULL;
+  pthread_mutex_lock(&g_mounts_lock);
+  struct mount_ctx *m = g_mounts;
+  while (m && m->id != id) m = m->next_live;
+  if (!m) {
+    err = "No such mount";
+  } else if (index < 0 || index >= m->config.workers) {
+    err = "Worker index out of range";
+  } else if (m->workers[index].tsfn) {
+    err = "Worker already attached";
+  } else {
+    struct shard *sh = &m->workers[index];
+    if (napi_create_threadsafe_function(env, args[2], NULL, resource_name, 0, 1, sh, worker_tsfn_finalize, sh, call_js, &sh->tsfn) != napi_ok) {
+      sh->tsfn = NULL;
+      err = "Failed to create threadsafe function";
+    } else {
+      atomic_fetch_add(&m->refs, 1);
+    }
+  }
+  pthread_mutex_unlock(&g_mounts_lock);
+  if (err) napi_throw_error(env, NULL, err);
+  return NULL;
+}
+
+// start(handle): starts serving a mount created with workers once they have attached
+static napi_value fuse_napi_start(napi_env env, napi_callback_info info) {
+  napi_value args[1];
+  size_t argc = 1;
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  struct mount_ctx *m = get_mount(env, args, argc, 0);
+  if (!m) return NULL;
+  if (!m->session || atomic_load(&m->running)) {
+    napi_throw_error(env, NULL, "Mount is not waiting to start");
     return NULL;
   }
-  
-  if (pthread_create(&fuse_thread, NULL, fuse_loop_thread, g_session) != 0) {
-    fuse_session_unmount(g_session);
-    fuse_session_destroy(g_session);
-    g_session = NULL;
-    fuse_opt_free_args(&fargs);
-    free(mountpoint);
-    napi_throw_error(env, NULL, "Failed to create fuse thread");
-    return NULL;
+  pthread_mutex_lock(&g_mounts_lock);
+  uint32_t attached = 0;
+  for (uint32_t i = 0; i < m->config.workers; i++) {
+    if (m->workers[i].tsfn) attached++;
+  }
+  pthread_mutex_unlock(&g_mounts_lock);
+  if (attached != m->config.workers) {
+    napi_throw_error(env, NULL, "Not all workers have attached");
+    return NULL;
+  }
+  if (start_loop(m) != 0) napi_throw_error(env, NULL, "Failed to create fuse thread");
+  return NULL;
+}
+
+// queue_stats(handle) -> { [lane]: { depth, limit, waiting, throttled } }
+static napi_value fuse_napi_queue_stats(napi_env env, napi_callback_info info) {
+  napi_value args[1];
+  size_t argc = 1;
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  struct mount_ctx *m = get_mount(env, args, argc, 0);
+  if (!m) return NULL;
+  napi_value result;
+  napi_create_object(env, &result);
+  for (int l = 0; l < LANE_COUNT; l++) {
+    napi_value lane, val;
+    napi_create_object(env, &lane);
+    napi_create_uint32(env, atomic_load(&m->lanes[l].depth), &val);
+    napi_set_named_property(env, lane, "depth", val);
+    napi_create_uint32(env, m->config.queue_limits[l], &val);
+    napi_set_named_property(env, lane, "limit", val);
+    napi_create_uint32(env, atomic_load(&m->lanes[l].inflight), &val);
+    napi_set_named_property(env, lane, "inflight", val);
+    napi_create_uint32(env, atomic_load(&m->lanes[l].waiting), &val);
+    napi_set_named_property(env, lane, "waiting", val);
+    napi_create_double(env, (double)atomic_load(&m->lanes[l].throttled), &val);
+    napi_set_named_property(env, lane, "throttled", val);
+    napi_set_named_property(env, result, lane_names[l], lane);
+  }
+  return result;
+}
+
+static void set_number(napi_env env, napi_value obj, const char *key, double num) {
+  napi_value val;
+  napi_create_double(env, num, &val);
+  napi_set_named_property(env, obj, key, val);
+}
+
+// Summary of one phase in microseconds. Percentiles are the upper bound of the
+// bucket they fall in, capped at the largest value seen.
+static napi_value phase_summary(napi_env env, uint64_t count, uint64_t sum_ns, uint64_t max_ns, const uint64_t *buckets) {
+  static const double quantiles[] = { 0.5, 0.9, 0.99 };
+  static const char *const keys[] = { "p50", "p90", "p99" };
+  napi_value obj;
+  napi_create_object(env, &obj);
+  set_number(env, obj, "count", (double)count);
+  set_number(env, obj, "mean", count ? (double)sum_ns / (double)count / 1e3 : 0);
+  unsigned b = 0;
+  uint64_t seen = 0;
+  for (int q = 0; q < 3; q++) {
+    uint64_t rank = (uint64_t)(quantiles[q] * (double)count + 0.999999);
+    while (b < HIST_BUCKETS - 1 && seen + buckets[b] < rank) seen += buckets[b++];
+    uint64_t ns = count ? hist_bucket_max(b) : 0;
+    set_number(env, obj, keys[q], (double)(ns < max_ns ? ns : max_ns) / 1e3);
   }
-  
-  pthread_detach(fuse_thread);
-  
-  free(mountpoint);
-  fuse_opt_free_args(&fargs);
-  
+  set_number(env, obj, "max", (double)max_ns / 1e3);
+  return obj;
+}
+
+// transport(handle) -> "io_uring" once INIT negotiated it, else "dev_fuse"
+static napi_value fuse_napi_transport(napi_env env, napi_callback_info info) {
+  napi_value args[1];
+  size_t argc = 1;
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  struct mount_ctx *m = get_mount(env, args, argc, 0);
+  if (!m) return NULL;
   napi_value result;
-  napi_create_string_utf8(env, "mounted", NAPI_AUTO_LENGTH, &result);
+  napi_create_string_utf8(env, atomic_load(&m->io_uring) ? "io_uring" : "dev_fuse", NAPI_AUTO_LENGTH, &result);
   return result;
 }
 
-static void fuse_serialize_stat(napi_env env, const struct stat *st, napi_value stat_obj) {
-  napi_value val;
-  napi_create_int64(env, (int64_t)st->st_mode, &val);
-  napi_set_named_property(env, stat_obj, "mode", val);
-  napi_create_int64(env, (int64_t)st->st_ino, &val);
-  napi_set_named_property(env, stat_obj, "ino", val);
-  napi_create_int64(env, (int64_t)st->st_dev, &val);
-  napi_set_named_property(env, stat_obj, "dev", val);
-  napi_create_int64(env, (int64_t)st->st_nlink, &val);
-  napi_set_named_property(env, stat_obj, "nlink", val);
-  napi_create_int64(env, (int64_t)st->st_uid, &val);
-  napi_set_named_property(env, stat_obj, "uid", val);
-  napi_create_int64(env, (int64_t)st->st_gid, &val);
-  napi_set_named_property(env, stat_obj, "gid", val);
-  napi_create_int64(env, (int64_t)st->st_rdev, &val);
-  napi_set_named_property(env, stat_obj, "rdev", val);
-  napi_create_int64(env, (int64_t)st->st_size, &val);
-  napi_set_named_property(env, stat_obj, "size", val);
-  napi_create_int64(env, (int64_t)st->st_blksize, &val);
-  napi_set_named_property(env, stat_obj, "blksize", val);
-  napi_create_int64(env, (int64_t)st->st_blocks, &val);
-  napi_set_named_property(env, stat_obj, "blocks", val);
-  napi_create_int64(env, (int64_t)st->st_atime, &val);
-  napi_set_named_property(env, stat_obj, "atime", val);
-  napi_create_int64(env, (int64_t)st->st_mtime, &val);
-  napi_set_named_property(env, stat_obj, "mtime", val);
-  napi_create_int64(env, (int64_t)st->st_ctime, &val);
-  napi_set_named_property(env, stat_obj, "ctime", val);
+// stats(handle) -> { [op]: { count, errors, queue, js, reply } } for every op seen,
+// summed over the mount's shards
+static napi_value fuse_napi_stats(napi_env env, napi_callback_info info) {
+  napi_value args[1];
+  size_t argc = 1;
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  struct mount_ctx *m = get_mount(env, args, argc, 0);
+  if (!m) return NULL;
+  napi_value result;
+  napi_create_object(env, &result);
+  for (int op = 0; op < OP_COUNT; op++) {
+    uint64_t errors = 0;
+    uint64_t count[PHASE_COUNT] = {0}, sum[PHASE_COUNT] = {0}, max[PHASE_COUNT] = {0};
+    uint64_t buckets[PHASE_COUNT][HIST_BUCKETS];
+    memset(buckets, 0, sizeof(buckets));
+    for (uint32_t i = 0; i <= m->config.workers; i++) {
+      const struct op_stats *os = i == 0 ? &m->main.stats[op] : &m->workers[i - 1].stats[op];
+      errors += atomic_load_explicit(&os->errors, memory_order_relaxed);
+      for (int ph = 0; ph < PHASE_COUNT; ph++) {
+        const struct histogram *h = &os->phases[ph];
+        count[ph] += atomic_load_explicit(&h->count, memory_order_relaxed);
+        sum[ph] += atomic_load_explicit(&h->sum_ns, memory_order_relaxed);
+        uint64_t hmax = atomic_load_explicit(&h->max_ns, memory_order_relaxed);
+        if (hmax > max[ph]) max[ph] = hmax;
+        for (unsigned b = 0; b < HIST_BUCKETS; b++) {
+          buckets[ph][b] += atomic_load_explicit(&h->buckets[b], memory_order_relaxed);
+        }
+      }
+    }
+    if (!count[PHASE_QUEUE]) continue;
+    napi_value entry;
+    napi_create_object(env, &entry);
+    set_number(env, entry, "count", (double)count[PHASE_QUEUE]);
+    set_number(env, entry, "errors", (double)errors);
+    for (int ph = 0; ph < PHASE_COUNT; ph++) {
+      napi_set_named_property(env, entry, phase_names[ph], phase_summary(env, count[ph], sum[ph], max[ph], buckets[ph]));
+    }
+    napi_set_named_property(env, result, op_names[op], entry);
+  }
+  return result;
 }
 
-static void fuse_parse_stat(napi_env env, napi_value stat_obj, struct stat *st) {
-  napi_value val;
-  int64_t num_val;
-  
-  napi_get_named_property(env, stat_obj, "mode", &val);
-  napi_get_value_int64(env, val, &num_val);
-  st->st_mode = (mode_t)num_val;
-  
-  napi_get_named_property(env, stat_obj, "ino", &val);
-  napi_get_value_int64(env, val, &num_val);
-  st->st_ino = (ino_t)num_val;
-  
-  napi_get_named_property(env, stat_obj, "dev", &val);
-  napi_get_value_int64(env, val, &num_val);
-  st->st_dev = (dev_t)num_val;
-  
-  napi_get_named_property(env, stat_obj, "nlink", &val);
-  napi_get_value_int64(env, val, &num_val);
-  st->st_nlink = (nlink_t)num_val;
-  
-  napi_get_named_property(env, stat_obj, "uid", &val);
-  napi_get_value_int64(env, val, &num_val);
-  st->st_uid = (uid_t)num_val;
-  
-  napi_get_named_property(env, stat_obj, "gid", &val);
-  napi_get_value_int64(env, val, &num_val);
-  st->st_gid = (gid_t)num_val;
-  
-  napi_get_named_property(env, stat_obj, "rdev", &val);
-  napi_get_value_int64(env, val, &num_val);
-  st->st_rdev = (dev_t)num_val;
-  
-  napi_get_named_property(env, stat_obj, "size", &val);
-  napi_get_value_int64(env, val, &num_val);
-  st->st_size = (off_t)num_val;
-  
-  napi_get_named_property(env, stat_obj, "atime", &val);
-  napi_get_value_int64(env, val, &num_val);
-  st->st_atime = (time_t)num_val;
-  
-  napi_get_named_property(env, stat_obj, "mtime", &val);
-  napi_get_value_int64(env, val, &num_val);
-  st->st_mtime = (time_t)num_val;
-  
-  napi_get_named_property(env, stat_obj, "ctime", &val);
-  napi_get_value_int64(env, val, &num_val);
-  st->st_ctime = (time_t)num_val;
-  
-  napi_get_named_property(env, stat_obj, "blksize", &val);
-  napi_get_value_int64(env, val, &num_val);
-  st->st_blksize = (blksize_t)num_val;
+static void fuse_serialize_stat(const struct marshal *m, const struct stat *st) {
+  put_i64(m, KEY_MODE, (int64_t)st->st_mode);
+  put_i64(m, KEY_INO, (int64_t)st->st_ino);
+  put_i64(m, KEY_DEV, (int64_t)st->st_dev);
+  put_i64(m, KEY_NLINK, (int64_t)st->st_nlink);
+  put_i64(m, KEY_UID, (int64_t)st->st_uid);
+  put_i64(m, KEY_GID, (int64_t)st->st_gid);
+  put_i64(m, KEY_RDEV, (int64_t)st->st_rdev);
+  put_i64(m, KEY_SIZE, (int64_t)st->st_size);
+  put_i64(m, KEY_BLKSIZE, (int64_t)st->st_blksize);
+  put_i64(m, KEY_BLOCKS, (int64_t)st->st_blocks);
+  put_i64(m, KEY_ATIME, (int64_t)st->st_atime);
+  put_i64(m, KEY_MTIME, (int64_t)st->st_mtime);
+  put_i64(m, KEY_CTIME, (int64_t)st->st_ctime);
+}
+
+// Packed stats are a BigUint64Array laid out as StatField in src/packed-stat.ts.
+// Timestamps are signed nanoseconds since the epoch.
+enum packed_stat_field {
+  PSTAT_INO, PSTAT_MODE, PSTAT_NLINK, PSTAT_UID, PSTAT_GID, PSTAT_RDEV, PSTAT_SIZE,
+  PSTAT_BLKSIZE, PSTAT_BLOCKS, PSTAT_ATIME_NS, PSTAT_MTIME_NS, PSTAT_CTIME_NS, PSTAT_DEV,
+  PSTAT_COUNT
+};
+
+#ifdef __APPLE__
+#define ST_ATIM st_atimespec
+#define ST_MTIM st_mtimespec
+#define ST_CTIM st_ctimespec
+#else
+#define ST_ATIM st_atim
+#define ST_MTIM st_mtim
+#define ST_CTIM st_ctim
+#endif
+
+static void ns_to_timespec(int64_t ns, struct timespec *ts) {
+  int64_t sec = ns / 1000000000;
+  int64_t nsec = ns % 1000000000;
+  if (nsec < 0) {
+    sec--;
+    nsec += 1000000000;
+  }
+  ts->tv_sec = (time_t)sec;
+  ts->tv_nsec = (long)nsec;
+}
+
+static bool parse_packed_stat(napi_env env, napi_value val, struct stat *st) {
+  bool is_typedarray = false;
+  if (napi_is_typedarray(env, val, &is_typedarray) != napi_ok || !is_typedarray) return false;
+  napi_typedarray_type type;
+  size_t length;
+  void *data;
+  napi_get_typedarray_info(env, val, &type, &length, &data, NULL, NULL);
+  if (type != napi_biguint64_array || length < PSTAT_COUNT) return false;
   
-  napi_get_named_property(env, stat_obj, "blocks", &val);
-  napi_get_value_int64(env, val, &num_val);
-  st->st_blocks = (blkcnt_t)num_val;
+  const uint64_t *f = data;
+  st->st_ino = (ino_t)f[PSTAT_INO];
+  st->st_mode = (mode_t)f[PSTAT_MODE];
+  st->st_nlink = (nlink_t)f[PSTAT_NLINK];
+  st->st_uid = (uid_t)f[PSTAT_UID];
+  st->st_gid = (gid_t)f[PSTAT_GID];
+  st->st_rdev = (dev_t)f[PSTAT_RDEV];
+  st->st_size = (off_t)f[PSTAT_SIZE];
+  st->st_blksize = (blksize_t)f[PSTAT_BLKSIZE];
+  st->st_blocks = (blkcnt_t)f[PSTAT_BLOCKS];
+  ns_to_timespec((int64_t)f[PSTAT_ATIME_NS], &st->ST_ATIM);
+  ns_to_timespec((int64_t)f[PSTAT_MTIME_NS], &st->ST_MTIM);
+  ns_to_timespec((int64_t)f[PSTAT_CTIME_NS], &st->ST_CTIM);
+  st->st_dev = (dev_t)f[PSTAT_DEV];
+  return true;
+}
+
+// Accepts a FileStat object or a packed stat
+static void fuse_parse_stat(napi_env env, napi_value stat_obj, struct stat *st) {
+  if (parse_packed_stat(env, stat_obj, st)) return;
+  struct addon_data *ad = get_addon_data(env);
+  st->st_mode = (mode_t)get_i64(env, ad, stat_obj, KEY_MODE);
+  st->st_ino = (ino_t)get_i64(env, ad, stat_obj, KEY_INO);
+  st->st_dev = (dev_t)get_i64(env, ad, stat_obj, KEY_DEV);
+  st->st_nlink = (nlink_t)get_i64(env, ad, stat_obj, KEY_NLINK);
+  st->st_uid = (uid_t)get_i64(env, ad, stat_obj, KEY_UID);
+  st->st_gid = (gid_t)get_i64(env, ad, stat_obj, KEY_GID);
+  st->st_rdev = (dev_t)get_i64(env, ad, stat_obj, KEY_RDEV);
+  st->st_size = (off_t)get_i64(env, ad, stat_obj, KEY_SIZE);
+  st->st_atime = (time_t)get_i64(env, ad, stat_obj, KEY_ATIME);
+  st->st_mtime = (time_t)get_i64(env, ad, stat_obj, KEY_MTIME);
+  st->st_ctime = (time_t)get_i64(env, ad, stat_obj, KEY_CTIME);
+  st->st_blksize = (blksize_t)get_i64(env, ad, stat_obj, KEY_BLKSIZE);
+  st->st_blocks = (blkcnt_t)get_i64(env, ad, stat_obj, KEY_BLOCKS);
+}
+
+// Decodes a reply's request argument; timed_reply() has already checked that JS still
+// owes this request its reply
+static fuse_req_t reply_req(napi_env env, napi_value arg) {
+  double req_ptr_double;
+  napi_get_value_double(env, arg, &req_ptr_double);
+  return (fuse_req_t)(uintptr_t)req_ptr_double;
+}
+
+// The attr cache generation the request being replied to arrived at, or 0 without
+// addon data, which only caches inodes never changed
+static uint64_t reply_attr_gen(napi_env env) {
+  struct addon_data *ad = get_addon_data(env);
+  return ad && ad->replying.shard ? ad->replying.attr_gen : 0;
+}
+
+static void reply_failed(napi_env env, int errno_val) {
+  struct addon_data *ad = get_addon_data(env);
+  if (ad && errno_val) ad->reply_failed = 1;
+}
+
+// Every reply_* export runs through here, with its implementation as callback data,
+// so the time spent replying is recorded against the request's op. Only requests
+// delivered to this thread and not yet answered are replied to: anything else is a
+// duplicate, or belongs to a mount that unmount() has torn down.
+static napi_value timed_reply(napi_env env, napi_callback_info info) {
+  napi_callback impl = NULL;
+  napi_value arg;
+  size_t argc = 1;
+  napi_get_cb_info(env, info, &argc, &arg, NULL, (void **)&impl);
+  struct addon_data *ad = get_addon_data(env);
+  if (!ad) return impl(env, info);
+  ad->replying.shard = NULL;
+  ad->reply_failed = 0;
+  ad->reply_start_ns = now_ns();
+  if (argc < 1 || !inflight_take(ad, reply_req(env, arg), &ad->replying)) return NULL;
+  struct mount_ctx *m = ad->replying.shard->mount;
+  hist_record(&ad->replying.shard->stats[ad->replying.op].phases[PHASE_JS], ad->reply_start_ns - ad->replying.delivered_ns);
+  lane_replied(&ad->replying);
+  // Replies from workers can race unmount(); the session lock keeps the session alive
+  // until they are sent
+  bool shared = m->config.workers > 0;
+  if (shared) pthread_rwlock_rdlock(&m->session_lock);
+  napi_value result = NULL;
+  if (!atomic_load(&m->closing)) {
+    // Anything cached while the change was in JS may predate it
+    if (ad->replying.changes_ino) attr_cache_drop_attr(&m->cache, ad->replying.changes_ino);
+    result = impl(env, info);
+  }
+  if (shared) pthread_rwlock_unlock(&m->session_lock);
+  if (ad->replying.shard) {
+    struct op_stats *os = &ad->replying.shard->stats[ad->replying.op];
+    hist_record(&os->phases[PHASE_REPLY], now_ns() - ad->reply_start_ns);
+    if (ad->reply_failed) counter_add(&os->errors, 1);
+    ad->replying.shard = NULL;
+  }
+  return result;
 }
 
 static napi_value fuse_napi_reply_err(napi_env env, napi_callback_info info) {
@@ -1321,9 +3147,7 @@ static napi_value fuse_napi_reply_err(napi_env env, napi_callback_info info) {
   size_t argc = 2;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
   double errno_double;
   napi_get_value_double(env, args[1], &errno_double);
@@ -1338,65 +3162,105 @@ static napi_value fuse_napi_reply_err(napi_env env, napi_callback_info info) {
   if (is_debug_enabled()) {
     fprintf(stderr, "[FUSE:reply_err] Calling fuse_reply_err with errno=%d (original=%d)\n", final_errno, errno_val);
   }
+  reply_failed(env, final_errno);
   
   fuse_reply_err(req, final_errno);
   return NULL;
 }
 
+// reply_lookup(req, stat, entryTimeout?, attrTimeout?, cacheTimeout?, parent?, name?)
+// With parent and name the entry is also kept in the native cache for cacheTimeout seconds.
 static napi_value fuse_napi_reply_lookup(napi_env env, napi_callback_info info) {
-  napi_value args[2];
-  size_t argc = 2;
+  napi_value args[7];
+  size_t argc = 7;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
+  struct mount_ctx *m = req_mount(req);
   struct stat st = {0};
   fuse_parse_stat(env, args[1], &st);
   
 #ifdef __APPLE__
   struct fuse_darwin_entry_param e = {0};
-  stat_to_darwin_entry_param(&st, &e);
-  fuse_reply_entry(req, &e);
+  stat_to_darwin_entry_param(&st, &e, &m->config);
 #else
   struct fuse_entry_param e = {0};
-  stat_to_entry_param(&st, &e);
-  fuse_reply_entry(req, &e);
+  stat_to_entry_param(&st, &e, &m->config);
 #endif
+  e.entry_timeout = opt_double(env, args, argc, 2, e.entry_timeout);
+  e.attr_timeout = opt_double(env, args, argc, 3, e.attr_timeout);
+  
+  double cache_timeout = opt_double(env, args, argc, 4, m->config.cache_timeout);
+  if (cache_timeout > 0) {
+    uint64_t since = reply_attr_gen(env);
+    mount_cache_attr(m, &st, e.attr_timeout, cache_timeout, since);
+    char *name = arg_string(env, args, argc, 6);
+    if (name) {
+      attr_cache_put_entry(&m->cache, (fuse_ino_t)arg_i64(env, args, argc, 5, 0), name, st.st_ino, e.entry_timeout, cache_timeout, since);
+      free(name);
+    }
+  }
+  fuse_reply_entry(req, &e);
   return NULL;
 }
 
-static napi_value fuse_napi_reply_getattr(napi_env env, napi_callback_info info) {
+// reply_negative_entry(req, entryTimeout?)
+// Answers a failed lookup with ino 0 so the kernel caches the miss. A timeout of 0
+// caches nothing and replies ENOENT as before.
+static napi_value fuse_napi_reply_negative_entry(napi_env env, napi_callback_info info) {
   napi_value args[2];
   size_t argc = 2;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
+  
+  double timeout = opt_double(env, args, argc, 1, req_config(req)->negative_timeout);
+  if (timeout <= 0) {
+    fuse_reply_err(req, ENOENT);
+    return NULL;
+  }
+#ifdef __APPLE__
+  struct fuse_darwin_entry_param e = {0};
+#else
+  struct fuse_entry_param e = {0};
+#endif
+  e.entry_timeout = timeout;
+  fuse_reply_entry(req, &e);
+  return NULL;
+}
+
+// reply_getattr(req, stat, attrTimeout?, cacheTimeout?)
+static napi_value fuse_napi_reply_getattr(napi_env env, napi_callback_info info) {
+  napi_value args[4];
+  size_t argc = 4;
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  
+  fuse_req_t req = reply_req(env, args[0]);
   
+  struct mount_ctx *m = req_mount(req);
   struct stat st = {0};
   fuse_parse_stat(env, args[1], &st);
+  double attr_timeout = opt_double(env, args, argc, 2, m->config.attr_timeout);
+  mount_cache_attr(m, &st, attr_timeout, opt_double(env, args, argc, 3, m->config.cache_timeout), reply_attr_gen(env));
   
 #ifdef __APPLE__
   struct fuse_darwin_attr attr = {0};
   stat_to_darwin_attr(&st, &attr);
-  fuse_reply_attr(req, &attr, 1.0);
+  fuse_reply_attr(req, &attr, attr_timeout);
 #else
-  fuse_reply_attr(req, &st, 1.0);
+  fuse_reply_attr(req, &st, attr_timeout);
 #endif
   return NULL;
 }
 
+// reply_create(req, stat, fh, openFlags?, entryTimeout?, attrTimeout?, backingFd?)
 static napi_value fuse_napi_reply_create(napi_env env, napi_callback_info info) {
-  napi_value args[3];
-  size_t argc = 3;
+  napi_value args[7];
+  size_t argc = 7;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
   struct stat st = {0};
   fuse_parse_stat(env, args[1], &st);
@@ -1409,34 +3273,56 @@ static napi_value fuse_napi_reply_create(napi_env env, napi_callback_info info)
   } else {
     fi.fh = 0;
   }
+  apply_open_flags(&fi, opt_uint32(env, args, argc, 3, req_config(req)->open_flags));
   
 #ifdef __APPLE__
   struct fuse_darwin_entry_param e = {0};
-  stat_to_darwin_entry_param(&st, &e);
-  fuse_reply_create(req, &e, &fi);
+  stat_to_darwin_entry_param(&st, &e, req_config(req));
 #else
   struct fuse_entry_param e = {0};
-  stat_to_entry_param(&st, &e);
-  fuse_reply_create(req, &e, &fi);
+  stat_to_entry_param(&st, &e, req_config(req));
 #endif
+  e.entry_timeout = opt_double(env, args, argc, 4, e.entry_timeout);
+  e.attr_timeout = opt_double(env, args, argc, 5, e.attr_timeout);
+  attach_backing(req, &fi, st.st_ino, (int)opt_double(env, args, argc, 6, -1));
+  fuse_reply_create(req, &e, &fi);
   return NULL;
 }
 
+// Grows the directory reply scratch buffer to at least size bytes
+static char *dirbuf_reserve(struct addon_data *ad, size_t size) {
+  if (!ad) return NULL;
+  if (size <= ad->dirbuf_size) return ad->dirbuf;
+  size_t new_size = ad->dirbuf_size ? ad->dirbuf_size : 4096;
+  while (new_size < size) new_size *= 2;
+  char *p = realloc(ad->dirbuf, new_size);
+  if (!p) return NULL;
+  ad->dirbuf = p;
+  ad->dirbuf_size = new_size;
+  return p;
+}
+
+// reply_readdir(req, entries, size, off)
+// Packs entries until the kernel's size is reached. Offsets are index cookies: the
+// entry at position i of a listing read from off resumes at off + i + 1.
 static napi_value fuse_napi_reply_readdir(napi_env env, napi_callback_info info) {
-  napi_value args[2];
-  size_t argc = 2;
+  napi_value args[4];
+  size_t argc = 4;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
   uint32_t length;
   napi_get_array_length(env, args[1], &length);
+  struct addon_data *ad = get_addon_data(env);
   
-  size_t local_dirbuf_size = 4096;
-  char *local_dirbuf = malloc(local_dirbuf_size);
-  size_t local_dirbuf_used = 0;
+  size_t size = opt_uint32(env, args, argc, 2, 4096);
+  off_t off = (off_t)opt_double(env, args, argc, 3, 0);
+  if (!dirbuf_reserve(ad, size)) {
+    fuse_reply_err(req, ENOMEM);
+    return NULL;
+  }
+  size_t used = 0;
   
   for (uint32_t i = 0; i < length; i++) {
     napi_value elem, val;
@@ -1447,21 +3333,21 @@ static napi_value fuse_napi_reply_readdir(napi_env env, napi_callback_info info)
     
     char name[256] = {0};
     uint32_t mode = S_IFDIR | 0755;
-    uint32_t ino = 1;
+    // Routed inode numbers use more than 32 bits
+    uint64_t ino = 1;
     
     if (type == napi_string) {
       size_t name_len;
       napi_get_value_string_utf8(env, elem, name, sizeof(name), &name_len);
     } else if (type == napi_object) {
       size_t name_len;
-      napi_get_named_property(env, elem, "name", &val);
+      napi_get_property(env, elem, get_key(env, ad, KEY_NAME), &val);
       napi_get_value_string_utf8(env, val, name, sizeof(name), &name_len);
       
-      napi_get_named_property(env, elem, "mode", &val);
+      napi_get_property(env, elem, get_key(env, ad, KEY_MODE), &val);
       napi_get_value_uint32(env, val, &mode);
       
-      napi_get_named_property(env, elem, "ino", &val);
-      napi_get_value_uint32(env, val, &ino);
+      ino = (uint64_t)get_i64(env, ad, elem, KEY_INO);
     }
     
     struct stat st = {0};
@@ -1477,35 +3363,40 @@ static napi_value fuse_napi_reply_readdir(napi_env env, napi_callback_info info)
 #endif
 
     size_t addsize = fuse_add_direntry(req, NULL, 0, name, NULL, 0);
-    if (local_dirbuf_used + addsize > local_dirbuf_size) {
-      local_dirbuf_size = local_dirbuf_used + addsize + 4096;
-      local_dirbuf = realloc(local_dirbuf, local_dirbuf_size);
-    }
+    if (used + addsize > size) break;
     
-    fuse_add_direntry(req, local_dirbuf + local_dirbuf_used, addsize, name, attr_ptr, local_dirbuf_used + addsize);
-    local_dirbuf_used += addsize;
+    fuse_add_direntry(req, ad->dirbuf + used, addsize, name, attr_ptr, off + (off_t)i + 1);
+    used += addsize;
   }
   
-  fuse_reply_buf(req, local_dirbuf, local_dirbuf_used);
-  free(local_dirbuf);
+  fuse_reply_buf(req, ad->dirbuf, used);
   return NULL;
 }
 
+// reply_readdirplus(req, entries, size, off, parent?), packed like reply_readdir.
+// Entries that carry a full stat, optionally with entry_timeout, attr_timeout and
+// cache_timeout, also fill the native attr cache, and its name cache when parent is given.
 static napi_value fuse_napi_reply_readdirplus(napi_env env, napi_callback_info info) {
-  napi_value args[2];
-  size_t argc = 2;
+  napi_value args[5];
+  size_t argc = 5;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
   uint32_t length;
   napi_get_array_length(env, args[1], &length);
+  struct addon_data *ad = get_addon_data(env);
   
-  size_t local_dirbuf_size = 4096;
-  char *local_dirbuf = malloc(local_dirbuf_size);
-  size_t local_dirbuf_used = 0;
+  size_t size = opt_uint32(env, args, argc, 2, 4096);
+  off_t off = (off_t)opt_double(env, args, argc, 3, 0);
+  int64_t parent = arg_i64(env, args, argc, 4, 0);
+  uint64_t since = reply_attr_gen(env);
+  struct mount_ctx *m = req_mount(req);
+  if (!dirbuf_reserve(ad, size)) {
+    fuse_reply_err(req, ENOMEM);
+    return NULL;
+  }
+  size_t used = 0;
   
   for (uint32_t i = 0; i < length; i++) {
     napi_value elem, val;
@@ -1518,83 +3409,112 @@ static napi_value fuse_napi_reply_readdirplus(napi_env env, napi_callback_info i
     
 #ifdef __APPLE__
     struct fuse_darwin_entry_param e = {0};
-    e.attr_timeout = 1.0;
-    e.entry_timeout = 1.0;
 #else
     struct fuse_entry_param e = {0};
-    e.attr_timeout = 1.0;
-    e.entry_timeout = 1.0;
 #endif
+    // Entries without a stat go out with nodeid 0: the kernel lists them but takes
+    // no lookup reference and caches no attributes, so stat still looks them up.
+    // Entries with a stat are complete and save the kernel that lookup.
+    uint64_t ino = 1;
+    uint32_t mode = S_IFDIR | 0755;
+    bool has_stat = false;
+    struct stat st = {0};
+    double cache_timeout = 0;
     
     if (type == napi_string) {
       size_t name_len;
       napi_get_value_string_utf8(env, elem, name, sizeof(name), &name_len);
-      e.ino = 1;
-#ifdef __APPLE__
-      e.attr.mode = S_IFDIR | 0755;
-      e.attr.ino = 1;
-#else
-      e.attr.st_mode = S_IFDIR | 0755;
-      e.attr.st_ino = 1;
-#endif
     } else if (type == napi_object) {
       size_t name_len;
-      napi_get_named_property(env, elem, "name", &val);
+      napi_get_property(env, elem, get_key(env, ad, KEY_NAME), &val);
       napi_get_value_string_utf8(env, val, name, sizeof(name), &name_len);
       
-      bool has_stat;
-      napi_has_named_property(env, elem, "stat", &has_stat);
+      napi_has_property(env, elem, get_key(env, ad, KEY_STAT), &has_stat);
+      if (has_stat) {
+        napi_get_property(env, elem, get_key(env, ad, KEY_STAT), &val);
+        napi_valuetype stat_type;
+        napi_typeof(env, val, &stat_type);
+        has_stat = stat_type == napi_object;
+      }
       if (has_stat) {
-        napi_get_named_property(env, elem, "stat", &val);
-        struct stat st = {0};
         fuse_parse_stat(env, val, &st);
 #ifdef __APPLE__
-        stat_to_darwin_entry_param(&st, &e);
+        stat_to_darwin_entry_param(&st, &e, &m->config);
 #else
-        stat_to_entry_param(&st, &e);
+        stat_to_entry_param(&st, &e, &m->config);
 #endif
+        // Timeouts set on the entry come from its inode's cache policy
+        cache_timeout = m->config.cache_timeout;
+        get_config_double(env, elem, "entry_timeout", &e.entry_timeout);
+        get_config_double(env, elem, "attr_timeout", &e.attr_timeout);
+        get_config_double(env, elem, "cache_timeout", &cache_timeout);
       } else {
-        uint32_t mode = S_IFDIR | 0755;
-        uint32_t ino = 1;
-        napi_get_named_property(env, elem, "mode", &val);
+        napi_get_property(env, elem, get_key(env, ad, KEY_MODE), &val);
         napi_get_value_uint32(env, val, &mode);
-        napi_get_named_property(env, elem, "ino", &val);
-        napi_get_value_uint32(env, val, &ino);
-        e.ino = ino;
+        ino = (uint64_t)get_i64(env, ad, elem, KEY_INO);
+      }
+    }
+    
+    if (!has_stat) {
 #ifdef __APPLE__
-        e.attr.mode = mode;
-        e.attr.ino = ino;
+      e.attr.mode = mode;
+      e.attr.ino = ino;
 #else
-        e.attr.st_mode = mode;
-        e.attr.st_ino = ino;
+      e.attr.st_mode = mode;
+      e.attr.st_ino = ino;
 #endif
-      }
     }
     
     size_t addsize = fuse_add_direntry_plus(req, NULL, 0, name, NULL, 0);
-    if (local_dirbuf_used + addsize > local_dirbuf_size) {
-      local_dirbuf_size = local_dirbuf_used + addsize + 4096;
-      local_dirbuf = realloc(local_dirbuf, local_dirbuf_size);
-    }
+    if (used + addsize > size) break;
+    
+    fuse_add_direntry_plus(req, ad->dirbuf + used, addsize, name, &e, off + (off_t)i + 1);
+    used += addsize;
     
-    fuse_add_direntry_plus(req, local_dirbuf + local_dirbuf_used, addsize, name, &e, local_dirbuf_used + addsize);
-    local_dirbuf_used += addsize;
+    // Only entries the kernel receives are cached: one cut off here is listed again
+    // from its own offset, and the kernel holds no reference to it meanwhile.
+    if (has_stat && cache_timeout > 0) {
+      mount_cache_attr(m, &st, e.attr_timeout, cache_timeout, since);
+      if (parent > 0) attr_cache_put_entry(&m->cache, (fuse_ino_t)parent, name, st.st_ino, e.entry_timeout, cache_timeout, since);
+    }
   }
   
-  fuse_reply_buf(req, local_dirbuf, local_dirbuf_used);
-  free(local_dirbuf);
+  fuse_reply_buf(req, ad->dirbuf, used);
   return NULL;
 }
 
 
+// Allocates page-aligned, uninitialized memory for the read buffer pool. The
+// buffer is owned by JS and freed by its finalizer once the pool drops it.
+static napi_value fuse_napi_alloc_buffer(napi_env env, napi_callback_info info) {
+  napi_value args[1];
+  size_t argc = 1;
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  
+  int64_t size = 0;
+  if (argc < 1 || napi_get_value_int64(env, args[0], &size) != napi_ok || size < 0) {
+    napi_throw_type_error(env, NULL, "alloc_buffer requires a non-negative size");
+    return NULL;
+  }
+  
+  napi_value result;
+  void *mem = NULL;
+  if (size > 0 && posix_memalign(&mem, (size_t)sysconf(_SC_PAGESIZE), (size_t)size) == 0) {
+    if (napi_create_external_buffer(env, (size_t)size, mem, free_external_buffer, NULL, &result) == napi_ok) {
+      return result;
+    }
+    free(mem);
+  }
+  napi_create_buffer(env, (size_t)size, NULL, &result);
+  return result;
+}
+
 static napi_value fuse_napi_reply_read(napi_env env, napi_callback_info info) {
   napi_value args[2];
   size_t argc = 2;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
   void* data;
   size_t len;
@@ -1608,9 +3528,7 @@ static napi_value fuse_napi_reply_write(napi_env env, napi_callback_info info) {
   size_t argc = 2;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
   int64_t bytes;
   napi_get_value_int64(env, args[1], &bytes);
@@ -1618,19 +3536,20 @@ static napi_value fuse_napi_reply_write(napi_env env, napi_callback_info info) {
   return NULL;
 }
 
+// reply_open(req, fh, openFlags?, backingFd?, ino?)
 static napi_value fuse_napi_reply_open(napi_env env, napi_callback_info info) {
-  napi_value args[2];
-  size_t argc = 2;
+  napi_value args[5];
+  size_t argc = 5;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
   double fh_double;
   napi_get_value_double(env, args[1], &fh_double);
   struct fuse_file_info fi = {0};
   fi.fh = (uint64_t)fh_double;
+  apply_open_flags(&fi, opt_uint32(env, args, argc, 2, req_config(req)->open_flags));
+  attach_backing(req, &fi, (uint64_t)opt_double(env, args, argc, 4, 0), (int)opt_double(env, args, argc, 3, -1));
   fuse_reply_open(req, &fi);
   return NULL;
 }
@@ -1640,9 +3559,7 @@ static napi_value fuse_napi_reply_release(napi_env env, napi_callback_info info)
   size_t argc = 1;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
   fuse_reply_err(req, 0);
   return NULL;
@@ -1653,9 +3570,7 @@ static napi_value fuse_napi_reply_readlink(napi_env env, napi_callback_info info
   size_t argc = 2;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
   char link[4096];
   size_t len;
@@ -1669,9 +3584,7 @@ static napi_value fuse_napi_reply_statfs(napi_env env, napi_callback_info info)
   size_t argc = 2;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
 #ifdef __APPLE__
   struct statfs stbuf = {0};
@@ -1713,9 +3626,7 @@ static napi_value fuse_napi_reply_buf(napi_env env, napi_callback_info info) {
   size_t argc = 2;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
   void* data;
   size_t len;
@@ -1729,9 +3640,7 @@ static napi_value fuse_napi_reply_none(napi_env env, napi_callback_info info) {
   size_t argc = 1;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
   fuse_reply_none(req);
   return NULL;
@@ -1742,9 +3651,7 @@ static napi_value fuse_napi_reply_xattr(napi_env env, napi_callback_info info) {
   size_t argc = 2;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
   double size_double;
   napi_get_value_double(env, args[1], &size_double);
@@ -1757,9 +3664,7 @@ static napi_value fuse_napi_reply_lock(napi_env env, napi_callback_info info) {
   size_t argc = 2;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
   struct flock lock = {0};
   napi_value val;
@@ -1797,9 +3702,7 @@ static napi_value fuse_napi_reply_bmap(napi_env env, napi_callback_info info) {
   size_t argc = 2;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
   double idx_double;
   napi_get_value_double(env, args[1], &idx_double);
@@ -1812,9 +3715,7 @@ static napi_value fuse_napi_reply_ioctl(napi_env env, napi_callback_info info) {
   size_t argc = 3;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
   int32_t result;
   napi_get_value_int32(env, args[1], &result);
@@ -1844,9 +3745,7 @@ static napi_value fuse_napi_reply_poll(napi_env env, napi_callback_info info) {
   size_t argc = 2;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
   uint32_t revents;
   napi_get_value_uint32(env, args[1], &revents);
@@ -1859,9 +3758,7 @@ static napi_value fuse_napi_reply_lseek(napi_env env, napi_callback_info info) {
   size_t argc = 2;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
   double off_double;
   napi_get_value_double(env, args[1], &off_double);
@@ -1874,9 +3771,7 @@ static napi_value fuse_napi_reply_int(napi_env env, napi_callback_info info) {
   size_t argc = 2;
   napi_get_cb_info(env, info, &argc, args, NULL, NULL);
   
-  double req_ptr_double;
-  napi_get_value_double(env, args[0], &req_ptr_double);
-  fuse_req_t req = (fuse_req_t)(uintptr_t)req_ptr_double;
+  fuse_req_t req = reply_req(env, args[0]);
   
   int64_t val;
   napi_get_value_int64(env, args[1], &val);
@@ -1885,78 +3780,365 @@ static napi_value fuse_napi_reply_int(napi_env env, napi_callback_info info) {
   // If val is negative, convert to positive (errno convention)
   // If val is already positive, keep it as is
   int final_errno = val == 0 ? 0 : (val < 0 ? (int)-val : (int)val);
+  reply_failed(env, final_errno);
   fuse_reply_err(req, final_errno);
   return NULL;
 }
 
-static napi_value fuse_napi_unmount(napi_env env, napi_callback_info info) {
-  if (g_session) {
-    fuse_session_exit(g_session);
-    // Wait a bit for the loop to exit
-    int count = 0;
-    while (fuse_running && count < 100) {
-      usleep(10000); // 10ms
-      count++;
+// reply_unlink/reply_rmdir(req, err, removed?). The removed inode may live on under
+// other links, and its cached nlink and ctime are stale once this entry is gone.
+static napi_value fuse_napi_reply_remove(napi_env env, napi_callback_info info) {
+  napi_value args[3];
+  size_t argc = 3;
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  
+  fuse_req_t req = reply_req(env, args[0]);
+  
+  int64_t val;
+  napi_get_value_int64(env, args[1], &val);
+  int64_t removed = arg_i64(env, args, argc, 2, 0);
+  if (val == 0 && removed > 0) attr_cache_drop_attr(req_cache(req), (fuse_ino_t)removed);
+  int final_errno = val == 0 ? 0 : (val < 0 ? (int)-val : (int)val);
+  reply_failed(env, final_errno);
+  fuse_reply_err(req, final_errno);
+  return NULL;
+}
+
+// Kernel notifications run on the libuv threadpool. Writing one to /dev/fuse can block
+// until the kernel is done with the inode, which may in turn wait on a reply from JS.
+enum notify_kind { NOTIFY_INVAL_INODE, NOTIFY_INVAL_ENTRY, NOTIFY_DELETE, NOTIFY_STORE, NOTIFY_RETRIEVE };
+
+static const char *const notify_names[] = {
+  "notify_inval_inode", "notify_inval_entry", "notify_delete", "notify_store", "notify_retrieve"
+};
+
+struct notify_work {
+  napi_async_work work;
+  napi_deferred deferred;
+  struct mount_ctx *mount;
+  napi_ref mount_ref;  // keeps the mount alive until the notification completes
+  napi_ref data_ref;  // keeps the notify_store buffer alive while the worker reads it
+  enum notify_kind kind;
+  fuse_ino_t ino;
+  fuse_ino_t child;
+  int64_t off;
+  int64_t len;
+  char *name;
+  void *data;
+  size_t size;
+  uint64_t cookie;
+  int result;
+};
+
+static void notify_execute(napi_env env, void *arg) {
+  (void)env;
+  struct notify_work *nw = arg;
+  pthread_rwlock_rdlock(&nw->mount->session_lock);
+  struct fuse_session *se = nw->mount->session;
+  if (!se) {
+    nw->result = -ENOTCONN;
+  } else {
+    switch (nw->kind) {
+      case NOTIFY_INVAL_INODE:
+        nw->result = fuse_lowlevel_notify_inval_inode(se, nw->ino, (off_t)nw->off, (off_t)nw->len);
+        break;
+      case NOTIFY_INVAL_ENTRY:
+        nw->result = fuse_lowlevel_notify_inval_entry(se, nw->ino, nw->name, strlen(nw->name));
+        break;
+      case NOTIFY_DELETE:
+        nw->result = fuse_lowlevel_notify_delete(se, nw->ino, nw->child, nw->name, strlen(nw->name));
+        break;
+      case NOTIFY_STORE: {
+        struct fuse_bufvec bufv = { .count = 1, .buf = {{ .size = nw->size, .mem = nw->data }} };
+        nw->result = fuse_lowlevel_notify_store(se, nw->ino, (off_t)nw->off, &bufv, 0);
+        break;
+      }
+      case NOTIFY_RETRIEVE:
+        nw->result = fuse_lowlevel_notify_retrieve(se, nw->ino, nw->size, (off_t)nw->off, (void *)(uintptr_t)nw->cookie);
+        break;
     }
-    fuse_session_unmount(g_session);
-    fuse_session_destroy(g_session);
-    g_session = NULL;
   }
-  if (tsfn) {
-    napi_release_threadsafe_function(tsfn, napi_tsfn_release);
-    tsfn = NULL;
+  pthread_rwlock_unlock(&nw->mount->session_lock);
+}
+
+static void notify_complete(napi_env env, napi_status status, void *arg) {
+  struct notify_work *nw = arg;
+  int result = status == napi_ok ? nw->result : -ECANCELED;
+  // Invalidating something the kernel never cached is not an error
+  if (result == -ENOENT && (nw->kind == NOTIFY_INVAL_INODE || nw->kind == NOTIFY_INVAL_ENTRY || nw->kind == NOTIFY_DELETE)) {
+    result = 0;
+  }
+
+  if (result == 0) {
+    napi_value undefined;
+    napi_get_undefined(env, &undefined);
+    napi_resolve_deferred(env, nw->deferred, undefined);
+  } else {
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%s failed: %s", notify_names[nw->kind], strerror(-result));
+    napi_value msg_val, err, errno_val;
+    napi_create_string_utf8(env, msg, NAPI_AUTO_LENGTH, &msg_val);
+    napi_create_error(env, NULL, msg_val, &err);
+    napi_create_int32(env, result, &errno_val);
+    napi_set_named_property(env, err, "errno", errno_val);
+    napi_reject_deferred(env, nw->deferred, err);
+  }
+
+  if (nw->data_ref) napi_delete_reference(env, nw->data_ref);
+  napi_delete_reference(env, nw->mount_ref);
+  napi_delete_async_work(env, nw->work);
+  free(nw->name);
+  free(nw);
+}
+
+// Queues a notification on the threadpool and returns the promise it settles
+static napi_value queue_notify(napi_env env, struct notify_work *nw) {
+  napi_value promise, resource_name;
+  napi_create_promise(env, &nw->deferred, &promise);
+  napi_create_string_utf8(env, notify_names[nw->kind], NAPI_AUTO_LENGTH, &resource_name);
+  if (napi_create_async_work(env, NULL, resource_name, notify_execute, notify_complete, nw, &nw->work) != napi_ok ||
+      napi_queue_async_work(env, nw->work) != napi_ok) {
+    nw->result = -ENOMEM;
+    notify_complete(env, napi_ok, nw);
+  }
+  return promise;
+}
+
+// The mount handle is args[0] of every notify_* call
+static struct notify_work *new_notify(napi_env env, napi_value *args, size_t argc, enum notify_kind kind) {
+  struct mount_ctx *m = get_mount(env, args, argc, 0);
+  if (!m) return NULL;
+  struct notify_work *nw = calloc(1, sizeof(*nw));
+  if (!nw) {
+    napi_throw_error(env, NULL, "Out of memory");
+    return NULL;
+  }
+  nw->kind = kind;
+  nw->mount = m;
+  napi_create_reference(env, args[0], 1, &nw->mount_ref);
+  return nw;
+}
+
+// notify_inval_inode(handle, ino, off, len): off < 0 drops only attributes, len 0 means to EOF
+static napi_value fuse_napi_notify_inval_inode(napi_env env, napi_callback_info info) {
+  napi_value args[4];
+  size_t argc = 4;
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  struct notify_work *nw = new_notify(env, args, argc, NOTIFY_INVAL_INODE);
+  if (!nw) return NULL;
+  nw->ino = (fuse_ino_t)arg_i64(env, args, argc, 1, 0);
+  nw->off = arg_i64(env, args, argc, 2, 0);
+  nw->len = arg_i64(env, args, argc, 3, 0);
+  attr_cache_drop_attr(&nw->mount->cache, nw->ino);
+  return queue_notify(env, nw);
+}
+
+// notify_inval_entry(handle, parent, name)
+static napi_value fuse_napi_notify_inval_entry(napi_env env, napi_callback_info info) {
+  napi_value args[3];
+  size_t argc = 3;
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  char *name = arg_string(env, args, argc, 2);
+  if (!name) {
+    napi_throw_type_error(env, NULL, "notify_inval_entry requires a parent inode and a name");
+    return NULL;
+  }
+  struct notify_work *nw = new_notify(env, args, argc, NOTIFY_INVAL_ENTRY);
+  if (!nw) {
+    free(name);
+    return NULL;
+  }
+  nw->ino = (fuse_ino_t)arg_i64(env, args, argc, 1, 0);
+  nw->name = name;
+  attr_cache_drop_entry(&nw->mount->cache, nw->ino, name);
+  return queue_notify(env, nw);
+}
+
+// notify_delete(handle, parent, child, name)
+static napi_value fuse_napi_notify_delete(napi_env env, napi_callback_info info) {
+  napi_value args[4];
+  size_t argc = 4;
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  char *name = arg_string(env, args, argc, 3);
+  if (!name) {
+    napi_throw_type_error(env, NULL, "notify_delete requires parent and child inodes and a name");
+    return NULL;
+  }
+  struct notify_work *nw = new_notify(env, args, argc, NOTIFY_DELETE);
+  if (!nw) {
+    free(name);
+    return NULL;
+  }
+  nw->ino = (fuse_ino_t)arg_i64(env, args, argc, 1, 0);
+  nw->child = (fuse_ino_t)arg_i64(env, args, argc, 2, 0);
+  nw->name = name;
+  attr_cache_drop_entry(&nw->mount->cache, nw->ino, name);
+  attr_cache_drop_attr(&nw->mount->cache, nw->child);
+  return queue_notify(env, nw);
+}
+
+// notify_store(handle, ino, offset, buffer): pushes data into the kernel page cache
+static napi_value fuse_napi_notify_store(napi_env env, napi_callback_info info) {
+  napi_value args[4];
+  size_t argc = 4;
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  bool is_buffer = false;
+  if (argc >= 4) napi_is_buffer(env, args[3], &is_buffer);
+  if (!is_buffer) {
+    napi_throw_type_error(env, NULL, "notify_store requires an inode, an offset and a Buffer");
+    return NULL;
+  }
+  struct notify_work *nw = new_notify(env, args, argc, NOTIFY_STORE);
+  if (!nw) return NULL;
+  nw->ino = (fuse_ino_t)arg_i64(env, args, argc, 1, 0);
+  nw->off = arg_i64(env, args, argc, 2, 0);
+  napi_get_buffer_info(env, args[3], &nw->data, &nw->size);
+  attr_cache_drop_attr(&nw->mount->cache, nw->ino);
+  napi_create_reference(env, args[3], 1, &nw->data_ref);
+  return queue_notify(env, nw);
+}
+
+// notify_retrieve(handle, ino, offset, size, cookie): the data arrives later as a retrieve_reply request
+static napi_value fuse_napi_notify_retrieve(napi_env env, napi_callback_info info) {
+  napi_value args[5];
+  size_t argc = 5;
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  struct notify_work *nw = new_notify(env, args, argc, NOTIFY_RETRIEVE);
+  if (!nw) return NULL;
+  nw->ino = (fuse_ino_t)arg_i64(env, args, argc, 1, 0);
+  nw->off = arg_i64(env, args, argc, 2, 0);
+  nw->size = (size_t)arg_i64(env, args, argc, 3, 0);
+  nw->cookie = (uint64_t)arg_i64(env, args, argc, 4, 0);
+  return queue_notify(env, nw);
+}
+
+// How long unmount() waits for the session loop to end
+#define UNMOUNT_WAIT_MS 1000
+
+// unmount(handle). Other mounts in the process are unaffected.
+static napi_value fuse_napi_unmount(napi_env env, napi_callback_info info) {
+  napi_value args[1];
+  size_t argc = 1;
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  struct mount_ctx *m = get_mount(env, args, argc, 0);
+  if (!m || !m->session || atomic_load(&m->closing)) return NULL;
+  
+  // closing also makes timed_reply() drop replies for this mount, and requests still
+  // pending in JS on this thread are forgotten; workers forget theirs when released
+  fuse_session_exit(m->session);
+  lanes_close(m);
+  inflight_purge(get_addon_data(env), &m->main);
+  // Unmounting aborts the connection: loop threads blocked reading /dev/fuse (or their
+  // io_uring queue) wake up and exit, and pending notifications fail rather than block.
+  // A busy mount is only detached, though, and its loop keeps reading until the last
+  // user lets go, so the wait is bounded and a loop still running then destroys the
+  // session itself when it ends.
+  fuse_session_unmount(m->session);
+  if (m->thread_started) {
+    m->thread_started = 0;
+    for (int waited = 0; atomic_load(&m->loop_state) != LOOP_DONE && waited < UNMOUNT_WAIT_MS; waited += 10) usleep(10000);
+    atomic_fetch_add(&m->refs, 1);
+    if (atomic_exchange(&m->loop_state, LOOP_ORPHANED) == LOOP_DONE) {
+      atomic_fetch_sub(&m->refs, 1);
+      pthread_join(m->thread, NULL);
+      destroy_session(m);
+    } else {
+      pthread_detach(m->thread);
+      if (is_debug_enabled()) {
+        fprintf(stderr, "[FUSE:unmount] Mount is busy; the session loop is left to exit on its own\n");
+      }
+    }
+  } else {
+    destroy_session(m);
   }
+  attr_cache_clear(&m->cache);
+  mount_unregister(m);
+  napi_release_threadsafe_function(m->main.tsfn, napi_tsfn_release);
   return NULL;
 }
 
+static void addon_data_finalize(napi_env env, void *data, void *hint) {
+  (void)hint;
+  struct addon_data *ad = (struct addon_data *)data;
+  for (int i = 0; i < PROP_KEY_COUNT; i++) {
+    if (ad->keys[i]) napi_delete_reference(env, ad->keys[i]);
+  }
+  free(ad->dirbuf);
+  free(ad->inflight);
+  free(ad);
+}
+
 static napi_value Init(napi_env env, napi_value exports) {
+  struct addon_data *ad = calloc(1, sizeof(struct addon_data));
+  if (ad) {
+    for (int i = 0; i < PROP_KEY_COUNT; i++) {
+      napi_value key;
+      napi_create_string_utf8(env, key_names[i], NAPI_AUTO_LENGTH, &key);
+      napi_create_reference(env, key, 1, &ad->keys[i]);
+    }
+    napi_set_instance_data(env, ad, addon_data_finalize, NULL);
+  }
+  
   napi_property_descriptor desc[] = {
     {"mount", NULL, fuse_napi_mount, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_err", NULL, fuse_napi_reply_err, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_none", NULL, fuse_napi_reply_none, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_lookup", NULL, fuse_napi_reply_lookup, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_getattr", NULL, fuse_napi_reply_getattr, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_readdir", NULL, fuse_napi_reply_readdir, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_read", NULL, fuse_napi_reply_read, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_write", NULL, fuse_napi_reply_write, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_open", NULL, fuse_napi_reply_open, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_release", NULL, fuse_napi_reply_release, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_create", NULL, fuse_napi_reply_create, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_unlink", NULL, fuse_napi_reply_int, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_mkdir", NULL, fuse_napi_reply_lookup, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_rmdir", NULL, fuse_napi_reply_int, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_rename", NULL, fuse_napi_reply_int, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_truncate", NULL, fuse_napi_reply_int, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_flush", NULL, fuse_napi_reply_int, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_fsync", NULL, fuse_napi_reply_int, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_opendir", NULL, fuse_napi_reply_open, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_releasedir", NULL, fuse_napi_reply_int, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_fsyncdir", NULL, fuse_napi_reply_int, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_readlink", NULL, fuse_napi_reply_readlink, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_symlink", NULL, fuse_napi_reply_lookup, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_link", NULL, fuse_napi_reply_lookup, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_mknod", NULL, fuse_napi_reply_lookup, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_access", NULL, fuse_napi_reply_int, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_statfs", NULL, fuse_napi_reply_statfs, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_setxattr", NULL, fuse_napi_reply_int, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_getxattr", NULL, fuse_napi_reply_buf, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_xattr", NULL, fuse_napi_reply_xattr, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_listxattr", NULL, fuse_napi_reply_buf, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_removexattr", NULL, fuse_napi_reply_int, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_getlk", NULL, fuse_napi_reply_lock, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_setlk", NULL, fuse_napi_reply_int, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_flock", NULL, fuse_napi_reply_int, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_bmap", NULL, fuse_napi_reply_bmap, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_ioctl", NULL, fuse_napi_reply_ioctl, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_poll", NULL, fuse_napi_reply_poll, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_fallocate", NULL, fuse_napi_reply_int, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_readdirplus", NULL, fuse_napi_reply_readdirplus, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_copy_file_range", NULL, fuse_napi_reply_write, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_lseek", NULL, fuse_napi_reply_lseek, NULL, NULL, NULL, napi_default, NULL},
-    {"reply_tmpfile", NULL, fuse_napi_reply_create, NULL, NULL, NULL, napi_default, NULL},
+    {"reply_err", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_err},
+    {"reply_none", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_none},
+    {"mount_id", NULL, fuse_napi_mount_id, NULL, NULL, NULL, napi_default, NULL},
+    {"attach_worker", NULL, fuse_napi_attach_worker, NULL, NULL, NULL, napi_default, NULL},
+    {"start", NULL, fuse_napi_start, NULL, NULL, NULL, napi_default, NULL},
+    {"queue_stats", NULL, fuse_napi_queue_stats, NULL, NULL, NULL, napi_default, NULL},
+    {"stats", NULL, fuse_napi_stats, NULL, NULL, NULL, napi_default, NULL},
+    {"transport", NULL, fuse_napi_transport, NULL, NULL, NULL, napi_default, NULL},
+    {"reply_lookup", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_lookup},
+    {"reply_negative_entry", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_negative_entry},
+    {"reply_getattr", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_getattr},
+    {"reply_readdir", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_readdir},
+    {"reply_read", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_read},
+    {"alloc_buffer", NULL, fuse_napi_alloc_buffer, NULL, NULL, NULL, napi_default, NULL},
+    {"reply_write", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_write},
+    {"reply_open", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_open},
+    {"reply_release", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_release},
+    {"reply_create", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_create},
+    {"reply_unlink", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_remove},
+    {"reply_mkdir", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_lookup},
+    {"reply_rmdir", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_remove},
+    {"reply_rename", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_int},
+    {"reply_truncate", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_int},
+    {"reply_flush", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_int},
+    {"reply_fsync", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_int},
+    {"reply_opendir", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_open},
+    {"reply_releasedir", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_int},
+    {"reply_fsyncdir", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_int},
+    {"reply_readlink", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_readlink},
+    {"reply_symlink", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_lookup},
+    {"reply_link", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_lookup},
+    {"reply_mknod", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_lookup},
+    {"reply_access", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_int},
+    {"reply_statfs", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_statfs},
+    {"reply_setxattr", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_int},
+    {"reply_getxattr", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_buf},
+    {"reply_xattr", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_xattr},
+    {"reply_listxattr", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_buf},
+    {"reply_removexattr", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_int},
+    {"reply_getlk", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_lock},
+    {"reply_setlk", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_int},
+    {"reply_flock", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_int},
+    {"reply_bmap", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_bmap},
+    {"reply_ioctl", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_ioctl},
+    {"reply_poll", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_poll},
+    {"reply_fallocate", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_int},
+    {"reply_readdirplus", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_readdirplus},
+    {"reply_copy_file_range", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_write},
+    {"reply_lseek", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_lseek},
+    {"reply_tmpfile", NULL, timed_reply, NULL, NULL, NULL, napi_default, (void *)fuse_napi_reply_create},
+    {"notify_inval_inode", NULL, fuse_napi_notify_inval_inode, NULL, NULL, NULL, napi_default, NULL},
+    {"notify_inval_entry", NULL, fuse_napi_notify_inval_entry, NULL, NULL, NULL, napi_default, NULL},
+    {"notify_delete", NULL, fuse_napi_notify_delete, NULL, NULL, NULL, napi_default, NULL},
+    {"notify_store", NULL, fuse_napi_notify_store, NULL, NULL, NULL, napi_default, NULL},
+    {"notify_retrieve", NULL, fuse_napi_notify_retrieve, NULL, NULL, NULL, napi_default, NULL},
     {"unmount", NULL, fuse_napi_unmount, NULL, NULL, NULL, napi_default, NULL}
   };
-  napi_define_properties(env, exports, 44, desc);
+  napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc);
   return exports;
 }
 
@@ -0,0 +1,52 @@
+/**
+ * Request opcodes passed from the native addon to the bridge.
+ * Must stay in the same order as FUSE_OPS in src/native/fuse_bindings.c.
+ */
+export enum Opcode {
+  INIT,
+  DESTROY,
+  LOOKUP,
+  FORGET,
+  FORGET_MULTI,
+  GETATTR,
+  SETATTR,
+  READLINK,
+  MKNOD,
+  MKDIR,
+  UNLINK,
+  RMDIR,
+  SYMLINK,
+  RENAME,
+  LINK,
+  OPEN,
+  READ,
+  WRITE,
+  WRITE_BUF,
+  FLUSH,
+  RELEASE,
+  FSYNC,
+  OPENDIR,
+  READDIR,
+  READDIRPLUS,
+  RELEASEDIR,
+  FSYNCDIR,
+  STATFS,
+  SETXATTR,
+  GETXATTR,
+  LISTXATTR,
+  REMOVEXATTR,
+  ACCESS,
+  CREATE,
+  GETLK,
+  SETLK,
+  FLOCK,
+  BMAP,
+  IOCTL,
+  POLL,
+  FALLOCATE,
+  COPY_FILE_RANGE,
+  LSEEK,
+  TMPFILE,
+  STATX,
+  RETRIEVE_REPLY,
+}
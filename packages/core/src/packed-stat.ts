@@ -0,0 +1,93 @@
+import { FileStat } from "./types";
+
+/** Slots of a packed stat. Times are nanoseconds since the epoch, stored two's complement. */
+export enum StatField {
+  INO = 0,
+  MODE = 1,
+  NLINK = 2,
+  UID = 3,
+  GID = 4,
+  RDEV = 5,
+  SIZE = 6,
+  BLKSIZE = 7,
+  BLOCKS = 8,
+  ATIME_NS = 9,
+  MTIME_NS = 10,
+  CTIME_NS = 11,
+  DEV = 12,
+}
+
+export const STAT_FIELDS = 13;
+
+/**
+ * A stat the native addon reads in one pass, without looking up object properties.
+ * Layout is StatField; keep it in sync with enum packed_stat_field in fuse_bindings.c.
+ */
+export type PackedStat = BigUint64Array;
+
+const NS_PER_SEC = 1_000_000_000n;
+
+function secondsToNs(sec: number): bigint {
+  const whole = Math.floor(sec);
+  return BigInt.asUintN(64, BigInt(whole) * NS_PER_SEC + BigInt(Math.round((sec - whole) * 1e9)));
+}
+
+function nsToSeconds(ns: bigint): number {
+  const signed = BigInt.asIntN(64, ns);
+  let sec = signed / NS_PER_SEC;
+  let nsec = signed % NS_PER_SEC;
+  if (nsec < 0n) {
+    sec -= 1n;
+    nsec += NS_PER_SEC;
+  }
+  return Number(sec) + Number(nsec) / 1e9;
+}
+
+export function createPackedStat(): PackedStat {
+  return new BigUint64Array(STAT_FIELDS);
+}
+
+export function isPackedStat(stat: unknown): stat is PackedStat {
+  return stat instanceof BigUint64Array && stat.length >= STAT_FIELDS;
+}
+
+/** Packs stat into out (or a new array). FileStat times are seconds and may be fractional. */
+export function packStat(stat: FileStat, out: PackedStat = createPackedStat()): PackedStat {
+  out[StatField.INO] = BigInt(stat.ino);
+  out[StatField.MODE] = BigInt(stat.mode);
+  out[StatField.NLINK] = BigInt(stat.nlink);
+  out[StatField.UID] = BigInt(stat.uid);
+  out[StatField.GID] = BigInt(stat.gid);
+  out[StatField.RDEV] = BigInt(stat.rdev);
+  out[StatField.SIZE] = BigInt(stat.size);
+  out[StatField.BLKSIZE] = BigInt(stat.blksize);
+  out[StatField.BLOCKS] = BigInt(stat.blocks);
+  out[StatField.ATIME_NS] = secondsToNs(stat.atime);
+  out[StatField.MTIME_NS] = secondsToNs(stat.mtime);
+  out[StatField.CTIME_NS] = secondsToNs(stat.ctime);
+  out[StatField.DEV] = BigInt(stat.dev);
+  return out;
+}
+
+export function unpackStat(packed: PackedStat): FileStat {
+  return {
+    ino: Number(packed[StatField.INO]),
+    mode: Number(packed[StatField.MODE]),
+    nlink: Number(packed[StatField.NLINK]),
+    uid: Number(packed[StatField.UID]),
+    gid: Number(packed[StatField.GID]),
+    rdev: Number(packed[StatField.RDEV]),
+    size: Number(packed[StatField.SIZE]),
+    blksize: Number(packed[StatField.BLKSIZE]),
+    blocks: Number(packed[StatField.BLOCKS]),
+    atime: nsToSeconds(packed[StatField.ATIME_NS]),
+    mtime: nsToSeconds(packed[StatField.MTIME_NS]),
+    ctime: nsToSeconds(packed[StatField.CTIME_NS]),
+    dev: Number(packed[StatField.DEV]),
+  };
+}
+
+/** The inode number of either representation */
+export function statIno(stat: FileStat | PackedStat): number {
+  return isPackedStat(stat) ? Number(stat[StatField.INO]) : stat.ino;
+}
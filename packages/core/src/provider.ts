@@ -1,4 +1,5 @@
-import { DirEntry, FileStat } from "./types";
+import { PackedStat } from "./packed-stat";
+import { CachePolicy, DirEntry, FileStat } from "./types";
 
 export interface Statfs {
   bsize: number;
@@ -17,19 +18,78 @@ export interface Flock {
   pid: number;
 }
 
+/** Pushes cache invalidations and data into the kernel for a mounted filesystem */
+export interface KernelNotifier {
+  /** Drop cached attributes and data of ino in [off, off + len). len 0 means to EOF; off < 0 drops attributes only. */
+  invalInode(ino: number, off?: number, len?: number): Promise<void>;
+  /** Drop the cached dentry for name in parent */
+  invalEntry(parent: number, name: string): Promise<void>;
+  /** Tell the kernel that name in parent (inode child) was deleted */
+  delete(parent: number, child: number, name: string): Promise<void>;
+  /** Write data into the page cache of ino at offset */
+  store(ino: number, offset: number, data: Buffer): Promise<void>;
+  /** Read back up to size bytes the kernel has cached for ino at offset */
+  retrieve(ino: number, offset: number, size: number): Promise<Buffer>;
+}
+
+/**
+ * Optional operations a provider really implements. Those not set are never sent to
+ * it: the kernel answers them itself (ENOSYS, local locks, generic llseek, splice
+ * copies, plain readdir instead of readdirplus). An empty set, which providers that
+ * implement none of them return, leaves them all to the kernel.
+ */
+export interface ProviderCapabilities {
+  readdirplus?: boolean;
+  copyFileRange?: boolean;
+  fallocate?: boolean;
+  /** getlk and setlk */
+  posixLocks?: boolean;
+  flock?: boolean;
+  lseek?: boolean;
+  bmap?: boolean;
+  ioctl?: boolean;
+  poll?: boolean;
+  /** setxattr, getxattr, listxattr and removexattr */
+  xattr?: boolean;
+  tmpfile?: boolean;
+  access?: boolean;
+}
+
 export interface FilesystemProvider {
   // Lifecycle operations
   init?(): Promise<void>;
   destroy?(): Promise<void>;
   forget?(ino: number, nlookup: number): Promise<void>;
   forget_multi?(forgets: Array<{ ino: number; nlookup: number }>): Promise<void>;
+  // Read once at mount. Without it every operation is registered with the kernel.
+  capabilities?(): ProviderCapabilities;
+
+  // Kernel caching policy for an inode, overriding the mount-wide policy
+  cachePolicy?(ino: number): CachePolicy | undefined;
+  // Called with the mount's notifier once mounted, and with null on unmount
+  attachNotifier?(notifier: KernelNotifier | null): void;
+  // Descriptor of the local file behind an open file, for the kernel to read and write
+  // directly when the mount uses passthrough. Undefined keeps the file served by read/write.
+  backingFd?(ino: number, fh: number): number | undefined;
+  // Whether lookups of names in a directory are counted for forget. The native cache
+  // answers repeated lookups without calling the provider, which would leave those
+  // counts behind the kernel's, so it only keeps names where this is false. Defaults
+  // to whether the provider implements forget.
+  countsLookups?(parent: number): boolean;
 
   // Core operations
   lookup(parent: number, name: string): Promise<FileStat | null>;
   getattr(ino: number, fh: number): Promise<FileStat | null>;
-  setattr(ino: number, fh: number, to_set: number, attr: FileStat): Promise<void>;
+  /** May resolve to the attributes after the change, which saves the bridge a getattr */
+  setattr(ino: number, fh: number, to_set: number, attr: FileStat): Promise<FileStat | null | void>;
+
+  // Packed variants, preferred by the bridge when present. `out` is a recycled
+  // buffer the provider may fill and return; it is only valid until the promise settles.
+  lookupPacked?(parent: number, name: string, out: PackedStat): Promise<PackedStat | FileStat | null>;
+  getattrPacked?(ino: number, fh: number, out: PackedStat): Promise<PackedStat | FileStat | null>;
 
   // Directory operations
+  /** Entries from index `off` on. Only those fitting in `size` bytes are sent; see DirectoryCursors. */
   readdir(ino: number, fh: number, size: number, off: number): Promise<DirEntry[]>;
   opendir(ino: number, flags: number): Promise<number>;
   releasedir(ino: number, fh: number): Promise<void>;
@@ -37,6 +97,7 @@ export interface FilesystemProvider {
 
   // File operations
   open(ino: number, flags: number, mode?: number): Promise<number>;
+  /** `buffer` is pooled and not zero-filled; it is only valid until the returned promise settles. */
   read(ino: number, fh: number, buffer: Buffer, off: number, length: number): Promise<number>;
   write(ino: number, fh: number, buffer: Buffer, off: number, length: number): Promise<number>;
   write_buf?(ino: number, fh: number, buffer: Buffer, off: number, size: number): Promise<number>;
@@ -49,9 +110,10 @@ export interface FilesystemProvider {
   mknod(parent: number, name: string, mode: number, rdev: number): Promise<FileStat>;
   mkdir(parent: number, name: string, mode: number): Promise<FileStat>;
 
-  // Remove operations
-  unlink(parent: number, name: string): Promise<void>;
-  rmdir(parent: number, name: string): Promise<void>;
+  // Remove operations. They may resolve to the removed inode, whose cached attributes
+  // (nlink, ctime) the bridge then drops without a lookup beforehand.
+  unlink(parent: number, name: string): Promise<number | void>;
+  rmdir(parent: number, name: string): Promise<number | void>;
 
   // Link operations
   link(ino: number, newparent: number, newname: string): Promise<FileStat>;
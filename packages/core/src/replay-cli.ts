@@ -0,0 +1,44 @@
+#!/usr/bin/env node
+// mount0-replay <trace> <provider-module> [--speed N] [--concurrency N] [--data JSON]
+// Replays a trace against the provider built by the module's createProvider export
+// (the same contract as WorkerOptions.module) and prints per-operation latencies.
+import { pathToFileURL } from "url";
+import { replayTrace } from "./replay";
+import { ProviderFactory } from "./worker-pool";
+
+async function main(argv: string[]): Promise<void> {
+  const positional: string[] = [];
+  const flags: Record<string, string> = {};
+  for (let i = 0; i < argv.length; i++) {
+    if (argv[i].startsWith("--")) flags[argv[i].slice(2)] = argv[++i];
+    else positional.push(argv[i]);
+  }
+  const [trace, module] = positional;
+  if (!trace || !module) {
+    console.error("usage: mount0-replay <trace> <provider-module> [--speed N] [--concurrency N] [--data JSON]");
+    process.exit(2);
+  }
+
+  const { createProvider } = (await import(pathToFileURL(module).href)) as { createProvider?: ProviderFactory };
+  if (typeof createProvider !== "function") throw new Error(`${module} does not export createProvider`);
+  const provider = await createProvider(flags.data ? JSON.parse(flags.data) : undefined, 0);
+  await provider.init?.();
+
+  const result = await replayTrace(provider, trace, {
+    speed: flags.speed ? Number(flags.speed) : undefined,
+    concurrency: flags.concurrency ? Number(flags.concurrency) : undefined,
+  });
+  await provider.destroy?.();
+
+  console.log(`${result.requests} requests in ${result.durationMs.toFixed(1)} ms, ${result.errors} errors, ${result.mismatches} differing from the trace`);
+  console.table(
+    Object.fromEntries(
+      Object.entries(result.ops).map(([op, s]) => [op, { count: s.count, "mean us": +s.mean.toFixed(1), "p50 us": +s.p50.toFixed(1), "p99 us": +s.p99.toFixed(1), "max us": +s.max.toFixed(1) }]),
+    ),
+  );
+}
+
+main(process.argv.slice(2)).catch((err) => {
+  console.error(err instanceof Error ? err.message : err);
+  process.exit(1);
+});
@@ -0,0 +1,141 @@
+import { DESC_STRIDE } from "./batch";
+import { FuseBridge, FuseConfig } from "./bridge";
+import { Opcode } from "./opcodes";
+import { FilesystemProvider } from "./provider";
+import { ReplyOutcome, TraceRecord, interceptReplies, readTrace } from "./trace";
+import { PhaseStats } from "./types";
+
+export interface ReplayOptions {
+  /** 1 issues requests at the recorded pace, 2 twice as fast; 0 (default) as fast as concurrency allows */
+  speed?: number;
+  /** Maximum requests in flight (default 64) */
+  concurrency?: number;
+  /** Settings of the recorded mount that affect the bridge, e.g. max_read or cache timeouts */
+  config?: FuseConfig;
+}
+
+export interface ReplayResult {
+  requests: number;
+  /** Replies with a non-zero errno */
+  errors: number;
+  /** Replies whose errno differs from the recorded one */
+  mismatches: number;
+  durationMs: number;
+  /** Provider latency per operation name, in microseconds */
+  ops: Record<string, PhaseStats>;
+}
+
+// Descriptor argument slots holding inode numbers and file handles, per opcode.
+// Layouts as in batch.ts.
+const INO_ARGS: Partial<Record<Opcode, number[]>> = {};
+const FH_ARGS: Partial<Record<Opcode, number[]>> = {};
+for (const op of [Opcode.LOOKUP, Opcode.UNLINK, Opcode.RMDIR, Opcode.MKNOD, Opcode.MKDIR, Opcode.SYMLINK, Opcode.CREATE, Opcode.TMPFILE]) {
+  INO_ARGS[op] = [0];
+}
+for (const op of [Opcode.FORGET, Opcode.READLINK, Opcode.OPEN, Opcode.OPENDIR, Opcode.SETXATTR, Opcode.GETXATTR, Opcode.LISTXATTR, Opcode.REMOVEXATTR, Opcode.ACCESS, Opcode.BMAP, Opcode.STATX]) {
+  INO_ARGS[op] = [0];
+}
+for (const op of [Opcode.GETATTR, Opcode.READ, Opcode.WRITE, Opcode.WRITE_BUF, Opcode.FLUSH, Opcode.RELEASE, Opcode.FSYNC, Opcode.READDIR, Opcode.READDIRPLUS, Opcode.RELEASEDIR, Opcode.FSYNCDIR, Opcode.STATFS, Opcode.GETLK, Opcode.SETLK, Opcode.FLOCK, Opcode.POLL, Opcode.FALLOCATE, Opcode.LSEEK]) {
+  INO_ARGS[op] = [0];
+  FH_ARGS[op] = [1];
+}
+INO_ARGS[Opcode.SETATTR] = [0];
+FH_ARGS[Opcode.SETATTR] = [2];
+INO_ARGS[Opcode.RENAME] = [0, 1];
+INO_ARGS[Opcode.LINK] = [0, 1];
+INO_ARGS[Opcode.IOCTL] = [0];
+FH_ARGS[Opcode.IOCTL] = [5];
+INO_ARGS[Opcode.COPY_FILE_RANGE] = [0, 3];
+FH_ARGS[Opcode.COPY_FILE_RANGE] = [1, 4];
+
+function summarize(samples: number[]): PhaseStats {
+  samples.sort((a, b) => a - b);
+  const at = (q: number) => samples[Math.min(samples.length - 1, Math.ceil(q * samples.length) - 1)];
+  const sum = samples.reduce((a, b) => a + b, 0);
+  return { count: samples.length, mean: sum / samples.length, p50: at(0.5), p90: at(0.9), p99: at(0.99), max: samples[samples.length - 1] };
+}
+
+/**
+ * Feeds a recorded trace to provider through the same dispatch path a mount uses,
+ * without the kernel. Inode numbers and file handles from entry and open replies are
+ * mapped to the ones the provider returns, so providers that number inodes differently
+ * still see consistent requests; requests that depend on a failed lookup will fail too.
+ */
+export async function replayTrace(provider: FilesystemProvider, trace: string | TraceRecord[], options: ReplayOptions = {}): Promise<ReplayResult> {
+  const records = (typeof trace === "string" ? await readTrace(trace) : trace.slice()).sort((a, b) => a.start - b.start);
+  const speed = options.speed ?? 0;
+  const concurrency = Math.max(1, options.concurrency ?? 64);
+
+  const replies = new Map<number, (outcome: ReplyOutcome) => void>();
+  const native = interceptReplies({ alloc_buffer: (size: number) => Buffer.allocUnsafe(size) }, (reqPtr, outcome) => {
+    replies.get(reqPtr)?.(outcome);
+    replies.delete(reqPtr);
+  });
+  const bridge = new FuseBridge(provider, native);
+  const handle = bridge.batchHandler(options.config);
+
+  const inos = new Map<number, number>([[1, 1]]);
+  const fhs = new Map<number, number>();
+  const latencies = new Map<Opcode, number[]>();
+  const result: ReplayResult = { requests: 0, errors: 0, mismatches: 0, durationMs: 0, ops: {} };
+
+  const run = (record: TraceRecord, reqPtr: number): Promise<void> => {
+    const desc = new Float64Array(DESC_STRIDE);
+    desc[0] = reqPtr;
+    desc[1] = record.opcode;
+    desc.set(record.args, 3);
+    for (const i of INO_ARGS[record.opcode] ?? []) desc[3 + i] = inos.get(desc[3 + i]) ?? desc[3 + i];
+    for (const i of FH_ARGS[record.opcode] ?? []) desc[3 + i] = fhs.get(desc[3 + i]) ?? desc[3 + i];
+    let extras = record.extras;
+    if (record.opcode === Opcode.FORGET_MULTI && extras[0] instanceof Float64Array) {
+      extras = [extras[0].map((ino) => inos.get(ino) ?? ino), ...extras.slice(1)];
+    }
+
+    const started = performance.now();
+    return new Promise((resolve) => {
+      replies.set(reqPtr, (outcome) => {
+        const samples = latencies.get(record.opcode) ?? [];
+        samples.push((performance.now() - started) * 1000);
+        latencies.set(record.opcode, samples);
+        result.requests++;
+        if (outcome.errno) result.errors++;
+        if (outcome.errno !== record.errno) result.mismatches++;
+        if (record.ino && outcome.ino) inos.set(record.ino, outcome.ino);
+        if (record.fh && !outcome.errno) fhs.set(record.fh, outcome.fh);
+        resolve();
+      });
+      handle(desc, extras, 1);
+    });
+  };
+
+  // A record waits for every record that had replied before it was recorded, so the
+  // inos and fhs it uses are mapped; records that overlapped in the trace may overlap here
+  const byEnd = records.map((_, i) => i).sort((a, b) => records[a].start + records[a].duration - (records[b].start + records[b].duration));
+  const done: Promise<void>[] = [];
+  let ended = 0;
+
+  const began = performance.now();
+  const inflight = new Set<Promise<void>>();
+  for (let i = 0; i < records.length; i++) {
+    const record = records[i];
+    if (speed > 0) {
+      const delay = record.start / 1000 / speed - (performance.now() - began);
+      if (delay > 0) await new Promise((resolve) => setTimeout(resolve, delay));
+    }
+    // Sorted by start, so these were all issued already
+    for (; ended < byEnd.length && records[byEnd[ended]].start + records[byEnd[ended]].duration <= record.start && byEnd[ended] < i; ended++) {
+      await done[byEnd[ended]];
+    }
+    while (inflight.size >= concurrency) await Promise.race(inflight);
+    const p = run(record, i + 1).then(() => {
+      inflight.delete(p);
+    });
+    done[i] = p;
+    inflight.add(p);
+  }
+  await Promise.all(inflight);
+  result.durationMs = performance.now() - began;
+
+  for (const [op, samples] of latencies) result.ops[Opcode[op].toLowerCase()] = summarize(samples);
+  return result;
+}
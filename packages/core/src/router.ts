@@ -1,69 +1,237 @@
-import { FilesystemProvider, Flock, Statfs } from "./provider";
-import { DirEntry, FileStat } from "./types";
+import { DirectoryCursors } from "./dir-cursor";
+import { PackedStat, STAT_FIELDS, StatField, isPackedStat, statIno } from "./packed-stat";
+import { FilesystemProvider, Flock, KernelNotifier, ProviderCapabilities, Statfs } from "./provider";
+import { CachePolicy, DirEntry, FileStat } from "./types";
+
+export interface RouteOptions {
+  /** Kernel caching policy for everything served by this route */
+  cache?: CachePolicy;
+  /** Pass the provider's backing descriptors to the kernel, so its files bypass JS (needs MountOptions.passthrough) */
+  passthrough?: boolean;
+}
+
+// Inode numbers handed to the kernel carry the route in their high bits:
+// ino = route id * ROUTE_SPAN + provider ino, which stays below 2^53. Route id 0 is
+// the router's own root (ino 1); a route at "/" serves ino 1 as its provider's inode 1.
+const ROUTE_BITS = 12;
+const ROUTE_SPAN = 2 ** (53 - ROUTE_BITS);
+const MAX_ROUTE_ID = 2 ** ROUTE_BITS - 1;
+
+interface Route extends RouteOptions {
+  id: number;
+  path: string;
+  provider: FilesystemProvider;
+  // Read when the route is added; undefined when the provider declares none
+  capabilities?: ProviderCapabilities;
+}
+
+// One path segment of the mount table
+class RouteNode {
+  children = new Map<string, RouteNode>();
+  route: Route | null = null;
+}
+
+function localIno(ino: number): number {
+  return ino % ROUTE_SPAN;
+}
+
+function crossDevice(): never {
+  throw { code: "EXDEV", errno: -18 };
+}
+
+function notSupported(): never {
+  throw { code: "EOPNOTSUPP", errno: -95 };
+}
+
+// Whether a route implements an optional op; one that declares no capabilities implements them all
+function can(route: Route, op: keyof ProviderCapabilities): boolean {
+  return !route.capabilities || !!route.capabilities[op];
+}
 
 export class RouterProvider implements FilesystemProvider {
-  public readonly providers: { path: string; provider: FilesystemProvider }[];
-  private inoToProvider: Map<number, FilesystemProvider> = new Map();
+  public readonly providers: ({ path: string; provider: FilesystemProvider } & RouteOptions)[] = [];
+  // Indexed by route id. Ids are not reused, so inodes of a removed route never reach another provider.
+  private routes: (Route | undefined)[] = [undefined];
+  private table = new RouteNode();
+  // The root directory is synthesized from the routes unless one is mounted at "/"
+  private rootCursors = new DirectoryCursors();
+  private nextRootFh: number = 1;
+  private notifier: KernelNotifier | null = null;
 
-  constructor(providers: { path: string; provider: FilesystemProvider }[]) {
-    this.providers = providers;
-    this.inoToProvider.set(1, this);
+  constructor(providers: ({ path: string; provider: FilesystemProvider } & RouteOptions)[]) {
+    providers.forEach(({ path, provider, ...options }) => this.handle(path, provider, options));
   }
 
-  handle(path: string, provider: FilesystemProvider): void {
+  handle(path: string, provider: FilesystemProvider, options: RouteOptions = {}): void {
     const normalized = path === "/" ? "/" : path.replace(/\/+$/, "") || "/";
-    this.providers.push({ path: normalized, provider });
+    if (this.routes.length > MAX_ROUTE_ID) throw new Error(`A router can handle at most ${MAX_ROUTE_ID} paths over its lifetime`);
+    this.unhandle(normalized);
+    const route: Route = { ...options, path: normalized, provider, id: this.routes.length, capabilities: provider.capabilities?.() };
+    this.routes.push(route);
+    this.node(normalized, true)!.route = route;
+    this.providers.push(route);
     this.providers.sort((a, b) => b.path.length - a.path.length);
+    if (this.notifier) provider.attachNotifier?.(this.routeNotifier(route, this.notifier));
   }
 
   unhandle(path: string): void {
     const normalized = path === "/" ? "/" : path.replace(/\/+$/, "") || "/";
-    const index = this.providers.findIndex((rp) => rp.path === normalized);
-    if (index !== -1) this.providers.splice(index, 1);
+    const node = this.node(normalized, false);
+    const route = node?.route;
+    if (!node || !route) return;
+    node.route = null;
+    this.routes[route.id] = undefined;
+    this.providers.splice(this.providers.indexOf(route), 1);
+    route.provider.attachNotifier?.(null);
+  }
+
+  attachNotifier(notifier: KernelNotifier | null): void {
+    this.notifier = notifier;
+    this.providers.forEach((rp) => rp.provider.attachNotifier?.(notifier && this.routeNotifier(rp as Route, notifier)));
+  }
+
+  // Ops any route implements, read at mount; a route that declares nothing needs them all.
+  // Routes lacking one of them get the kernel's own answer from the op itself.
+  capabilities(): ProviderCapabilities | undefined {
+    if (this.providers.length === 0) return undefined;
+    const merged: ProviderCapabilities = {};
+    for (const { provider } of this.providers) {
+      const own = provider.capabilities?.();
+      if (!own) return undefined;
+      for (const [name, enabled] of Object.entries(own)) {
+        if (enabled) merged[name as keyof ProviderCapabilities] = true;
+      }
+    }
+    return merged;
+  }
+
+  cachePolicy(ino: number): CachePolicy | undefined {
+    const route = this.findRoute(ino);
+    if (!route) return undefined;
+    const own = route.provider.cachePolicy?.(localIno(ino));
+    if (!route.cache) return own;
+    return own ? { ...own, ...route.cache } : route.cache;
+  }
+
+  countsLookups(parent: number): boolean {
+    const provider = this.findRoute(parent)?.provider;
+    return provider ? (provider.countsLookups?.(localIno(parent)) ?? !!provider.forget) : false;
+  }
+
+  backingFd(ino: number, fh: number): number | undefined {
+    const route = this.findRoute(ino);
+    if (!route?.passthrough) return undefined;
+    return route.provider.backingFd?.(localIno(ino), fh);
+  }
+
+  // The trie node for path; missing nodes are created when create is set
+  private node(path: string, create: boolean): RouteNode | undefined {
+    let node = this.table;
+    for (const segment of path.split("/")) {
+      if (!segment) continue;
+      let child = node.children.get(segment);
+      if (!child) {
+        if (!create) return undefined;
+        child = new RouteNode();
+        node.children.set(segment, child);
+      }
+      node = child;
+    }
+    return node;
+  }
+
+  // The route with the longest path that is path or one of its ancestors
+  private match(path: string): Route | null {
+    let node: RouteNode | undefined = this.table;
+    let matched = node.route;
+    for (const segment of path.split("/")) {
+      if (!segment) continue;
+      node = node.children.get(segment);
+      if (!node) break;
+      if (node.route) matched = node.route;
+    }
+    return matched;
+  }
+
+  private isSyntheticRoot(ino: number): boolean {
+    return ino === 1 && !this.table.route;
+  }
+
+  private findRoute(ino: number): Route | undefined {
+    return ino === 1 ? (this.table.route ?? undefined) : this.routes[Math.floor(ino / ROUTE_SPAN)];
+  }
+
+  private routeOf(ino: number): Route {
+    const route = this.findRoute(ino);
+    if (!route) throw new Error(`Provider not found for inode ${ino}`);
+    return route;
   }
 
   private getProvider(ino: number): FilesystemProvider {
-    const provider = this.inoToProvider.get(ino);
-    if (!provider) throw new Error(`Provider not found for inode ${ino}`);
-    return provider;
+    return this.routeOf(ino).provider;
   }
 
-  private matchProvider(path: string): FilesystemProvider | null {
-    const matched = this.providers
-      .filter((rp) => {
-        if (rp.path === "/") {
-          // Root provider matches everything
-          return true;
-        }
-        return path === rp.path || path.startsWith(rp.path + "/");
-      })
-      .sort((a, b) => b.path.length - a.path.length)[0];
-    if (!matched) return null;
-    return matched.provider;
+  // Renames, links and copies can't cross providers
+  private sameRoute(a: number, b: number): Route {
+    const route = this.routeOf(a);
+    if (this.routeOf(b) !== route) crossDevice();
+    return route;
+  }
+
+  private toKernel(route: Route, ino: number): number {
+    if (ino === 1 && route === this.table.route) return 1;
+    if (ino < 0 || ino >= ROUTE_SPAN) throw { code: "EOVERFLOW", errno: -75 };
+    return route.id * ROUTE_SPAN + ino;
+  }
+
+  // Provider stats may be cached by the provider, so the kernel's inode goes on a copy
+  private entry(route: Route, stat: FileStat): FileStat {
+    return { ...stat, ino: this.toKernel(route, stat.ino) };
+  }
+
+  private packedEntry(stat: PackedStat | FileStat, ino: number, out: PackedStat): PackedStat | FileStat {
+    if (!isPackedStat(stat)) return { ...stat, ino };
+    if (stat !== out) out.set(stat.subarray(0, STAT_FIELDS));
+    out[StatField.INO] = BigInt(ino);
+    return out;
+  }
+
+  private entries(route: Route, entries: DirEntry[]): DirEntry[] {
+    return entries.map((e) => {
+      const ino = this.toKernel(route, e.ino);
+      return e.stat ? { ...e, ino, stat: { ...e.stat, ino } } : { ...e, ino };
+    });
+  }
+
+  // Providers notify in their own inode numbers
+  private routeNotifier(route: Route, notifier: KernelNotifier): KernelNotifier {
+    const ino = (local: number) => this.toKernel(route, local);
+    return {
+      invalInode: (local, off, len) => notifier.invalInode(ino(local), off, len),
+      invalEntry: (parent, name) => notifier.invalEntry(ino(parent), name),
+      delete: (parent, child, name) => notifier.delete(ino(parent), ino(child), name),
+      store: (local, offset, data) => notifier.store(ino(local), offset, data),
+      retrieve: (local, offset, size) => notifier.retrieve(ino(local), offset, size),
+    };
   }
 
   async lookup(parent: number, name: string): Promise<FileStat | null> {
     if (parent === 1) {
-      // For root lookups, match provider for the path /${name}
-      const path = `/${name}`;
-      const provider = this.matchProvider(path);
-      if (!provider) {
-        throw new Error("No provider found");
+      const route = this.match(`/${name}`);
+      if (!route) throw new Error("No provider found");
+      // A route mounted at /name is entered through its provider's root
+      if (route.path !== "/") {
+        const stat = await route.provider.getattr(1, 0);
+        return stat && this.entry(route, stat);
       }
-      // Call getattr(1, 0) on the matched provider
-      const stat = await provider.getattr(1, 0);
-      if (stat) {
-        this.inoToProvider.set(stat.ino, provider);
-      }
-      return stat;
     }
-    const stat = await this.getProvider(parent).lookup(parent, name);
-    if (stat) this.inoToProvider.set(stat.ino, this.getProvider(parent));
-    return stat;
+    const route = this.routeOf(parent);
+    const stat = await route.provider.lookup(localIno(parent), name);
+    return stat && this.entry(route, stat);
   }
 
   async getattr(ino: number, fh: number): Promise<FileStat | null> {
-    if (ino === 1)
+    if (this.isSyntheticRoot(ino))
       return {
         mode: 0o40755,
         size: 0,
@@ -79,124 +247,131 @@ export class RouterProvider implements FilesystemProvider {
         blksize: 4096,
         blocks: 0,
       };
-    return this.getProvider(ino).getattr(ino, fh);
+    const stat = await this.getProvider(ino).getattr(localIno(ino), fh);
+    return stat && { ...stat, ino };
+  }
+
+  async lookupPacked(parent: number, name: string, out: PackedStat): Promise<PackedStat | FileStat | null> {
+    if (parent === 1) return this.lookup(parent, name);
+    const route = this.findRoute(parent);
+    if (!route?.provider.lookupPacked) return this.lookup(parent, name);
+    const stat = await route.provider.lookupPacked(localIno(parent), name, out);
+    if (!stat) return null;
+    return this.packedEntry(stat, this.toKernel(route, statIno(stat)), out);
+  }
+
+  async getattrPacked(ino: number, fh: number, out: PackedStat): Promise<PackedStat | FileStat | null> {
+    const provider = this.isSyntheticRoot(ino) ? this : this.getProvider(ino);
+    if (provider === this || !provider.getattrPacked) return this.getattr(ino, fh);
+    const stat = await provider.getattrPacked(localIno(ino), fh, out);
+    return stat && this.packedEntry(stat, ino, out);
   }
 
-  async setattr(ino: number, fh: number, to_set: number, attr: FileStat): Promise<void> {
-    return this.getProvider(ino).setattr(ino, fh, to_set, attr);
+  async setattr(ino: number, fh: number, to_set: number, attr: FileStat): Promise<FileStat | null> {
+    const stat = await this.getProvider(ino).setattr(localIno(ino), fh, to_set, attr);
+    return stat ? { ...stat, ino } : null;
   }
 
   async readdir(ino: number, fh: number, size: number, off: number): Promise<DirEntry[]> {
-    if (ino === 1) {
-      const topLevel = new Set<string>();
-      const entries = await Promise.all(
-        this.providers
-          .filter((rp) => {
-            if (rp.path === "/") return false;
-            const parts = rp.path.split("/").filter((p) => p);
-            const top = `/${parts[0]}`;
-            if (topLevel.has(top)) return false;
-            topLevel.add(top);
-            return rp.path === top;
-          })
-          .map(async (rp) => {
-            const stat = await rp.provider.getattr(1, 0);
-            if (stat) {
-              this.inoToProvider.set(stat.ino, rp.provider);
-              return { name: rp.path.slice(1), mode: stat.mode, ino: stat.ino };
-            }
-            return null;
-          })
-      );
-      return entries.filter((e) => e !== null).slice(off) as DirEntry[];
-    }
-    const entries = await this.getProvider(ino).readdir(ino, fh, size, off);
-    entries.forEach((e) => {
-      if (!this.inoToProvider.has(e.ino)) this.inoToProvider.set(e.ino, this.getProvider(ino));
-    });
-    return entries;
+    if (this.isSyntheticRoot(ino)) return this.rootCursors.read(fh, off, size, () => this.listRoot());
+    const route = this.routeOf(ino);
+    return this.entries(route, await route.provider.readdir(localIno(ino), fh, size, off));
+  }
+
+  // Routes directly below the root; deeper ones are only reachable through them
+  private async listRoot(plus = false): Promise<DirEntry[]> {
+    const routes = [...this.table.children].filter(([, node]) => node.route);
+    const entries = await Promise.all(
+      routes.map(async ([name, node]) => {
+        const route = node.route!;
+        const stat = await route.provider.getattr(1, 0);
+        if (!stat) return null;
+        const ino = this.toKernel(route, stat.ino);
+        return plus ? { name, mode: stat.mode, ino, stat: { ...stat, ino } } : { name, mode: stat.mode, ino };
+      })
+    );
+    return entries.filter((e) => e !== null) as DirEntry[];
   }
 
   async opendir(ino: number, flags: number): Promise<number> {
-    return this.getProvider(ino).opendir(ino, flags);
+    if (this.isSyntheticRoot(ino)) return this.nextRootFh++;
+    return this.getProvider(ino).opendir(localIno(ino), flags);
   }
 
   async releasedir(ino: number, fh: number): Promise<void> {
-    return this.getProvider(ino).releasedir(ino, fh);
+    if (this.isSyntheticRoot(ino)) return this.rootCursors.release(fh);
+    return this.getProvider(ino).releasedir(localIno(ino), fh);
   }
 
   async fsyncdir(ino: number, fh: number, datasync: number): Promise<void> {
-    return this.getProvider(ino).fsyncdir(ino, fh, datasync);
+    if (this.isSyntheticRoot(ino)) return;
+    return this.getProvider(ino).fsyncdir(localIno(ino), fh, datasync);
   }
   async open(ino: number, flags: number, mode?: number): Promise<number> {
-    return this.getProvider(ino).open(ino, flags, mode);
+    return this.getProvider(ino).open(localIno(ino), flags, mode);
   }
 
   async read(ino: number, fh: number, buffer: Buffer, off: number, length: number): Promise<number> {
-    return this.getProvider(ino).read(ino, fh, buffer, off, length);
+    return this.getProvider(ino).read(localIno(ino), fh, buffer, off, length);
   }
 
   async write(ino: number, fh: number, buffer: Buffer, off: number, length: number): Promise<number> {
-    return this.getProvider(ino).write(ino, fh, buffer, off, length);
+    return this.getProvider(ino).write(localIno(ino), fh, buffer, off, length);
   }
 
   async flush(ino: number, fh: number): Promise<void> {
-    return this.getProvider(ino).flush(ino, fh);
+    return this.getProvider(ino).flush(localIno(ino), fh);
   }
 
   async fsync(ino: number, fh: number, datasync: number): Promise<void> {
-    return this.getProvider(ino).fsync(ino, fh, datasync);
+    return this.getProvider(ino).fsync(localIno(ino), fh, datasync);
   }
 
   async release(ino: number, fh: number): Promise<void> {
-    return this.getProvider(ino).release(ino, fh);
+    return this.getProvider(ino).release(localIno(ino), fh);
   }
 
   async create(parent: number, name: string, mode: number, flags: number): Promise<{ stat: FileStat; fh: number }> {
-    const result = await this.getProvider(parent).create(parent, name, mode, flags);
-    this.inoToProvider.set(result.stat.ino, this.getProvider(parent));
-    return result;
+    const route = this.routeOf(parent);
+    const result = await route.provider.create(localIno(parent), name, mode, flags);
+    return { stat: this.entry(route, result.stat), fh: result.fh };
   }
 
   async mknod(parent: number, name: string, mode: number, rdev: number): Promise<FileStat> {
-    const stat = await this.getProvider(parent).mknod(parent, name, mode, rdev);
-    this.inoToProvider.set(stat.ino, this.getProvider(parent));
-    return stat;
+    const route = this.routeOf(parent);
+    return this.entry(route, await route.provider.mknod(localIno(parent), name, mode, rdev));
   }
 
   async mkdir(parent: number, name: string, mode: number): Promise<FileStat> {
-    const stat = await this.getProvider(parent).mkdir(parent, name, mode);
-    this.inoToProvider.set(stat.ino, this.getProvider(parent));
-    return stat;
+    const route = this.routeOf(parent);
+    return this.entry(route, await route.provider.mkdir(localIno(parent), name, mode));
   }
 
-  async unlink(parent: number, name: string): Promise<void> {
-    const stat = await this.getProvider(parent).lookup(parent, name);
-    await this.getProvider(parent).unlink(parent, name);
-    if (stat) this.inoToProvider.delete(stat.ino);
+  async unlink(parent: number, name: string): Promise<number | undefined> {
+    const route = this.routeOf(parent);
+    const removed = await route.provider.unlink(localIno(parent), name);
+    return removed ? this.toKernel(route, removed) : undefined;
   }
 
-  async rmdir(parent: number, name: string): Promise<void> {
-    const stat = await this.getProvider(parent).lookup(parent, name);
-    await this.getProvider(parent).rmdir(parent, name);
-    if (stat) this.inoToProvider.delete(stat.ino);
+  async rmdir(parent: number, name: string): Promise<number | undefined> {
+    const route = this.routeOf(parent);
+    const removed = await route.provider.rmdir(localIno(parent), name);
+    return removed ? this.toKernel(route, removed) : undefined;
   }
 
   async link(ino: number, newparent: number, newname: string): Promise<FileStat> {
-    const stat = await this.getProvider(ino).link(ino, newparent, newname);
-    this.inoToProvider.set(stat.ino, this.getProvider(ino));
-    return stat;
+    const route = this.sameRoute(ino, newparent);
+    return this.entry(route, await route.provider.link(localIno(ino), localIno(newparent), newname));
   }
 
   async symlink(link: string, parent: number, name: string): Promise<FileStat> {
-    const stat = await this.getProvider(parent).symlink(link, parent, name);
-    this.inoToProvider.set(stat.ino, this.getProvider(parent));
-    return stat;
+    const route = this.routeOf(parent);
+    return this.entry(route, await route.provider.symlink(link, localIno(parent), name));
   }
 
   async readlink(ino: number): Promise<string> {
     // For root inode, use the first provider
-    if (ino === 1) {
+    if (this.isSyntheticRoot(ino)) {
       if (this.providers.length > 0) {
         const provider = this.providers[0].provider;
         if (provider.readlink) {
@@ -205,15 +380,15 @@ export class RouterProvider implements FilesystemProvider {
       }
       throw new Error("Readlink not supported for root");
     }
-    return this.getProvider(ino).readlink(ino);
+    return this.getProvider(ino).readlink(localIno(ino));
   }
 
   async rename(parent: number, name: string, newparent: number, newname: string, flags: number): Promise<void> {
-    return this.getProvider(parent).rename(parent, name, newparent, newname, flags);
+    return this.sameRoute(parent, newparent).provider.rename(localIno(parent), name, localIno(newparent), newname, flags);
   }
   async setxattr(ino: number, name: string, value: Buffer, size: number, flags: number): Promise<void> {
     // For root inode, use the first provider
-    if (ino === 1) {
+    if (this.isSyntheticRoot(ino)) {
       if (this.providers.length > 0) {
         const provider = this.providers[0].provider;
         if (provider.setxattr) {
@@ -222,12 +397,12 @@ export class RouterProvider implements FilesystemProvider {
       }
       throw new Error("Extended attributes not supported");
     }
-    return this.getProvider(ino).setxattr(ino, name, value, size, flags);
+    return this.getProvider(ino).setxattr(localIno(ino), name, value, size, flags);
   }
 
   async getxattr(ino: number, name: string, size: number): Promise<Buffer | number> {
     // For root inode, use the first provider
-    if (ino === 1) {
+    if (this.isSyntheticRoot(ino)) {
       if (this.providers.length > 0) {
         const provider = this.providers[0].provider;
         if (provider.getxattr) {
@@ -236,12 +411,12 @@ export class RouterProvider implements FilesystemProvider {
       }
       throw new Error("Extended attributes not supported");
     }
-    return this.getProvider(ino).getxattr(ino, name, size);
+    return this.getProvider(ino).getxattr(localIno(ino), name, size);
   }
 
   async listxattr(ino: number, size: number): Promise<Buffer | number> {
     // For root inode, use the first provider
-    if (ino === 1) {
+    if (this.isSyntheticRoot(ino)) {
       if (this.providers.length > 0) {
         const provider = this.providers[0].provider;
         if (provider.listxattr) {
@@ -250,12 +425,12 @@ export class RouterProvider implements FilesystemProvider {
       }
       return size === 0 ? 0 : Buffer.alloc(0);
     }
-    return this.getProvider(ino).listxattr(ino, size);
+    return this.getProvider(ino).listxattr(localIno(ino), size);
   }
 
   async removexattr(ino: number, name: string): Promise<void> {
     // For root inode, use the first provider
-    if (ino === 1) {
+    if (this.isSyntheticRoot(ino)) {
       if (this.providers.length > 0) {
         const provider = this.providers[0].provider;
         if (provider.removexattr) {
@@ -264,12 +439,12 @@ export class RouterProvider implements FilesystemProvider {
       }
       throw new Error("Extended attributes not supported");
     }
-    return this.getProvider(ino).removexattr(ino, name);
+    return this.getProvider(ino).removexattr(localIno(ino), name);
   }
 
   async access(ino: number, mask: number): Promise<void> {
     // For root inode, use the first provider or return success
-    if (ino === 1) {
+    if (this.isSyntheticRoot(ino)) {
       if (this.providers.length > 0) {
         const provider = this.providers[0].provider;
         if (provider.access) {
@@ -278,12 +453,15 @@ export class RouterProvider implements FilesystemProvider {
       }
       return; // Success for root
     }
-    return this.getProvider(ino).access(ino, mask);
+    const route = this.routeOf(ino);
+    // The kernel treats an unimplemented access as allowed
+    if (!can(route, "access")) return;
+    return route.provider.access(localIno(ino), mask);
   }
 
   async statfs(ino: number, fh: number): Promise<Statfs> {
     // For root inode, use the first provider
-    if (ino === 1) {
+    if (this.isSyntheticRoot(ino)) {
       if (this.providers.length > 0) {
         const provider = this.providers[0].provider;
         if (provider.statfs) {
@@ -300,72 +478,67 @@ export class RouterProvider implements FilesystemProvider {
         ffree: 0,
       };
     }
-    return this.getProvider(ino).statfs(ino, fh);
+    return this.getProvider(ino).statfs(localIno(ino), fh);
   }
 
   async getlk(ino: number, fh: number, lock: Flock): Promise<Flock> {
-    return this.getProvider(ino).getlk(ino, fh, lock);
+    return this.getProvider(ino).getlk(localIno(ino), fh, lock);
   }
 
   async setlk(ino: number, fh: number, lock: Flock, sleep: number): Promise<void> {
-    return this.getProvider(ino).setlk(ino, fh, lock, sleep);
+    return this.getProvider(ino).setlk(localIno(ino), fh, lock, sleep);
   }
 
   async flock(ino: number, fh: number, op: number): Promise<void> {
-    return this.getProvider(ino).flock(ino, fh, op);
+    return this.getProvider(ino).flock(localIno(ino), fh, op);
   }
   async bmap(ino: number, blocksize: number, idx: number): Promise<number> {
-    return this.getProvider(ino).bmap(ino, blocksize, idx);
+    return this.getProvider(ino).bmap(localIno(ino), blocksize, idx);
   }
 
   async ioctl(ino: number, fh: number, cmd: number, in_buf: Buffer | null, in_bufsz: number, out_bufsz: number, flags: number): Promise<{ result: number; out_buf?: Buffer }> {
-    return this.getProvider(ino).ioctl(ino, fh, cmd, in_buf, in_bufsz, out_bufsz, flags);
+    return this.getProvider(ino).ioctl(localIno(ino), fh, cmd, in_buf, in_bufsz, out_bufsz, flags);
   }
 
   async poll(ino: number, fh: number): Promise<number> {
-    return this.getProvider(ino).poll(ino, fh);
+    return this.getProvider(ino).poll(localIno(ino), fh);
   }
 
   async fallocate(ino: number, fh: number, offset: number, length: number, mode: number): Promise<void> {
-    return this.getProvider(ino).fallocate(ino, fh, offset, length, mode);
+    const route = this.routeOf(ino);
+    if (!can(route, "fallocate")) notSupported();
+    return route.provider.fallocate(localIno(ino), fh, offset, length, mode);
   }
 
   async readdirplus(ino: number, fh: number, size: number, off: number): Promise<DirEntry[]> {
-    const entries = await this.getProvider(ino).readdirplus(ino, fh, size, off);
-    entries.forEach((e) => {
-      if (!this.inoToProvider.has(e.ino)) this.inoToProvider.set(e.ino, this.getProvider(ino));
-    });
-    return entries;
+    if (this.isSyntheticRoot(ino)) return this.rootCursors.read(fh, off, size, () => this.listRoot(true), true);
+    const route = this.routeOf(ino);
+    // Plain entries go out without attributes, and the kernel looks them up as it would after readdir
+    if (!can(route, "readdirplus")) return this.entries(route, await route.provider.readdir(localIno(ino), fh, size, off));
+    return this.entries(route, await route.provider.readdirplus(localIno(ino), fh, size, off));
   }
 
   async copy_file_range(ino_in: number, fh_in: number, off_in: number, ino_out: number, fh_out: number, off_out: number, len: number, flags: number): Promise<number> {
-    return this.getProvider(ino_in).copy_file_range(ino_in, fh_in, off_in, ino_out, fh_out, off_out, len, flags);
+    // EXDEV and EOPNOTSUPP make the kernel fall back to copying through read and write
+    const route = this.sameRoute(ino_in, ino_out);
+    if (!can(route, "copyFileRange")) notSupported();
+    return route.provider.copy_file_range(localIno(ino_in), fh_in, off_in, localIno(ino_out), fh_out, off_out, len, flags);
   }
 
   async lseek(ino: number, fh: number, off: number, whence: number): Promise<number> {
-    return this.getProvider(ino).lseek(ino, fh, off, whence);
+    return this.getProvider(ino).lseek(localIno(ino), fh, off, whence);
   }
 
   async tmpfile(parent: number, mode: number, flags: number): Promise<{ stat: FileStat; fh: number }> {
-    const result = await this.getProvider(parent).tmpfile(parent, mode, flags);
-    this.inoToProvider.set(result.stat.ino, this.getProvider(parent));
-    return result;
+    const route = this.routeOf(parent);
+    const result = await route.provider.tmpfile(localIno(parent), mode, flags);
+    return { stat: this.entry(route, result.stat), fh: result.fh };
   }
 
   async forget(ino: number, nlookup: number): Promise<void> {
     // Don't forget the root inode
     if (ino === 1) return;
-
-    const provider = this.inoToProvider.get(ino);
-    if (provider && provider.forget) {
-      await provider.forget(ino, nlookup);
-    }
-
-    // Remove from our map when lookup count reaches zero
-    // Note: nlookup is the number of lookups to forget, not the remaining count
-    // We can't track the exact count, so we'll remove when forget is called
-    // In practice, FUSE will call forget multiple times until count reaches zero
-    this.inoToProvider.delete(ino);
+    await this.findRoute(ino)?.provider.forget?.(localIno(ino), nlookup);
   }
 
   async forget_multi(forgets: Array<{ ino: number; nlookup: number }>): Promise<void> {
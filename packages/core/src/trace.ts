@@ -0,0 +1,325 @@
+import { WriteStream, createWriteStream } from "fs";
+import { readFile } from "fs/promises";
+import { DESC_STRIDE } from "./batch";
+import { Opcode } from "./opcodes";
+import { PackedStat, statIno } from "./packed-stat";
+import { FileStat } from "./types";
+
+/**
+ * Request traces. A trace is a header followed by one record per replied request, in
+ * reply order. Numbers are little-endian.
+ *
+ *   header: "M0TRACE\0", u32 version, u32 reserved, f64 start (ms since the epoch)
+ *   record: u8 opcode, u8 argument count, u8 extras count, u8 reserved, i32 errno,
+ *           f64 start, f64 duration (microseconds, start relative to the header),
+ *           f64 reply size, f64 reply ino, f64 reply fh,
+ *           f64 per argument: the descriptor slots after extrasBase (see batch.ts),
+ *           per extra: u8 tag, u32 byte length, bytes
+ */
+const MAGIC = "M0TRACE\0";
+const VERSION = 1;
+const HEADER_SIZE = 24;
+const RECORD_SIZE = 48;
+const CHUNK_SIZE = 64 * 1024;
+
+enum Tag {
+  NONE,
+  STRING,
+  BUFFER,
+  // A buffer stored as its length only; replay substitutes zeroes
+  ELIDED,
+  FLOAT64,
+  JSON,
+}
+
+export interface TraceOptions {
+  /** Keep write payloads. By default only their length is recorded. */
+  recordData?: boolean;
+}
+
+/** What a reply told the kernel, as far as replay needs to know */
+export interface ReplyOutcome {
+  errno: number;
+  /** Bytes read or written, entries listed or xattr size, depending on the reply */
+  size: number;
+  /** Inode of the entry a lookup or create replied with, else 0 */
+  ino: number;
+  /** File handle an open or create replied with, else 0 */
+  fh: number;
+}
+
+export interface TraceRecord extends ReplyOutcome {
+  opcode: Opcode;
+  /** Numeric arguments, in descriptor order */
+  args: number[];
+  /** String, buffer and object arguments, in the order the addon appends them */
+  extras: unknown[];
+  /** Microseconds since the trace started */
+  start: number;
+  duration: number;
+}
+
+// Replies that pass 0 or an errno as their only argument
+const STATUS_REPLIES = new Set([
+  "reply_unlink",
+  "reply_rmdir",
+  "reply_rename",
+  "reply_truncate",
+  "reply_flush",
+  "reply_fsync",
+  "reply_releasedir",
+  "reply_fsyncdir",
+  "reply_access",
+  "reply_setxattr",
+  "reply_removexattr",
+  "reply_setlk",
+  "reply_flock",
+  "reply_fallocate",
+]);
+
+/** Extracts the outcome of a call to the addon's reply_* function name */
+export function replyOutcome(name: string, args: unknown[]): ReplyOutcome {
+  const out: ReplyOutcome = { errno: 0, size: 0, ino: 0, fh: 0 };
+  const result = args[1];
+  switch (name) {
+    case "reply_err":
+      out.errno = Math.abs(result as number);
+      break;
+    case "reply_negative_entry":
+      out.errno = 2;
+      break;
+    case "reply_lookup":
+    case "reply_mkdir":
+    case "reply_mknod":
+    case "reply_symlink":
+    case "reply_link":
+      out.ino = statIno(result as FileStat | PackedStat);
+      break;
+    case "reply_create":
+    case "reply_tmpfile":
+      out.ino = statIno(result as FileStat | PackedStat);
+      out.fh = args[2] as number;
+      break;
+    case "reply_open":
+    case "reply_opendir":
+      out.fh = result as number;
+      break;
+    case "reply_read":
+    case "reply_getxattr":
+    case "reply_listxattr":
+    case "reply_readdir":
+    case "reply_readdirplus":
+      out.size = (result as { length: number }).length;
+      break;
+    case "reply_readlink":
+      out.size = Buffer.byteLength(result as string);
+      break;
+    case "reply_write":
+    case "reply_copy_file_range":
+    case "reply_xattr":
+      out.size = result as number;
+      break;
+    default:
+      if (STATUS_REPLIES.has(name)) out.errno = Math.abs(result as number);
+  }
+  return out;
+}
+
+/** Wraps a native binding so onReply sees every reply_* call; everything else passes through */
+export function interceptReplies<T extends object>(native: T, onReply: (reqPtr: number, outcome: ReplyOutcome) => void): T {
+  return new Proxy(native, {
+    get(target, prop, receiver) {
+      const value = Reflect.get(target, prop, receiver);
+      if (typeof prop !== "string" || !prop.startsWith("reply_")) return value;
+      return (...args: unknown[]) => {
+        onReply(args[0] as number, replyOutcome(prop, args));
+        return typeof value === "function" ? value(...args) : undefined;
+      };
+    },
+  });
+}
+
+interface PendingRequest {
+  opcode: Opcode;
+  args: Float64Array;
+  extras: unknown[];
+  start: number;
+}
+
+function encodeExtra(value: unknown, elide: boolean): { tag: Tag; bytes: Buffer | null; length: number } {
+  if (value === undefined || value === null) return { tag: Tag.NONE, bytes: null, length: 0 };
+  if (typeof value === "string") {
+    const bytes = Buffer.from(value);
+    return { tag: Tag.STRING, bytes, length: bytes.length };
+  }
+  if (Buffer.isBuffer(value)) {
+    return elide ? { tag: Tag.ELIDED, bytes: null, length: value.length } : { tag: Tag.BUFFER, bytes: value, length: value.length };
+  }
+  if (value instanceof Float64Array) {
+    const bytes = Buffer.from(value.buffer, value.byteOffset, value.byteLength);
+    return { tag: Tag.FLOAT64, bytes, length: bytes.length };
+  }
+  const bytes = Buffer.from(JSON.stringify(value));
+  return { tag: Tag.JSON, bytes, length: bytes.length };
+}
+
+/** Writes a trace file. Requests are noted as they arrive and written once replied to. */
+export class TraceWriter {
+  private stream: WriteStream;
+  private chunk = Buffer.allocUnsafe(CHUNK_SIZE);
+  private used = 0;
+  private pending = new Map<number, PendingRequest>();
+  private readonly origin = performance.now();
+
+  constructor(
+    path: string,
+    private readonly options: TraceOptions = {},
+  ) {
+    this.stream = createWriteStream(path);
+    const header = Buffer.alloc(HEADER_SIZE);
+    header.write(MAGIC, 0, "latin1");
+    header.writeUInt32LE(VERSION, 8);
+    header.writeDoubleLE(Date.now(), 16);
+    this.stream.write(header);
+  }
+
+  /** Notes the request at desc[base] of a native batch; its extras end at extrasEnd */
+  request(desc: Float64Array, base: number, extras: unknown[], extrasEnd: number): void {
+    const opcode = desc[base + 1];
+    // Retrieve replies answer the bridge's own notifications, not the kernel
+    if (opcode === Opcode.RETRIEVE_REPLY) return;
+    this.pending.set(desc[base], {
+      opcode,
+      args: desc.slice(base + 3, base + DESC_STRIDE),
+      extras: extras.slice(desc[base + 2], extrasEnd),
+      start: (performance.now() - this.origin) * 1000,
+    });
+  }
+
+  reply(reqPtr: number, outcome: ReplyOutcome): void {
+    const req = this.pending.get(reqPtr);
+    if (!req) return;
+    this.pending.delete(reqPtr);
+    const duration = (performance.now() - this.origin) * 1000 - req.start;
+
+    let nargs = req.args.length;
+    while (nargs > 0 && req.args[nargs - 1] === 0) nargs--;
+    const elide = !this.options.recordData && (req.opcode === Opcode.WRITE || req.opcode === Opcode.WRITE_BUF);
+    const extras = req.extras.map((value) => encodeExtra(value, elide));
+    const size = RECORD_SIZE + nargs * 8 + extras.reduce((n, e) => n + 5 + (e.bytes ? e.length : 0), 0);
+
+    const buf = this.reserve(size);
+    let off = buf.offset;
+    const out = buf.chunk;
+    out.writeUInt8(req.opcode, off);
+    out.writeUInt8(nargs, off + 1);
+    out.writeUInt8(extras.length, off + 2);
+    out.writeUInt8(0, off + 3);
+    out.writeInt32LE(outcome.errno, off + 4);
+    out.writeDoubleLE(req.start, off + 8);
+    out.writeDoubleLE(duration, off + 16);
+    out.writeDoubleLE(outcome.size, off + 24);
+    out.writeDoubleLE(outcome.ino, off + 32);
+    out.writeDoubleLE(outcome.fh, off + 40);
+    off += RECORD_SIZE;
+    for (let i = 0; i < nargs; i++, off += 8) out.writeDoubleLE(req.args[i], off);
+    for (const e of extras) {
+      out.writeUInt8(e.tag, off);
+      out.writeUInt32LE(e.length, off + 1);
+      off += 5;
+      if (e.bytes) off += e.bytes.copy(out, off);
+    }
+    if (out !== this.chunk) this.stream.write(out);
+  }
+
+  /** Flushes buffered records and closes the file. Requests still in flight are dropped. */
+  async close(): Promise<void> {
+    this.flush();
+    this.pending.clear();
+    await new Promise<void>((resolve, reject) => {
+      this.stream.once("error", reject);
+      this.stream.end(() => resolve());
+    });
+  }
+
+  // Room for size bytes, in the current chunk or in a buffer of its own that the caller writes out
+  private reserve(size: number): { chunk: Buffer; offset: number } {
+    if (this.used + size > this.chunk.length) this.flush();
+    if (size > this.chunk.length) return { chunk: Buffer.allocUnsafe(size), offset: 0 };
+    const offset = this.used;
+    this.used += size;
+    return { chunk: this.chunk, offset };
+  }
+
+  private flush(): void {
+    if (this.used === 0) return;
+    this.stream.write(this.chunk.subarray(0, this.used));
+    this.chunk = Buffer.allocUnsafe(CHUNK_SIZE);
+    this.used = 0;
+  }
+}
+
+function decodeExtra(tag: Tag, bytes: Buffer, length: number): unknown {
+  switch (tag) {
+    case Tag.STRING:
+      return bytes.toString();
+    case Tag.BUFFER:
+      return Buffer.from(bytes);
+    case Tag.ELIDED:
+      return Buffer.alloc(length);
+    case Tag.FLOAT64: {
+      const out = new Float64Array(length / 8);
+      Buffer.from(out.buffer).set(bytes);
+      return out;
+    }
+    case Tag.JSON:
+      return JSON.parse(bytes.toString());
+    default:
+      return undefined;
+  }
+}
+
+/** Parses a trace file written by TraceWriter */
+export async function readTrace(path: string): Promise<TraceRecord[]> {
+  const data = await readFile(path);
+  if (data.length < HEADER_SIZE || data.toString("latin1", 0, 8) !== MAGIC) throw new Error(`${path} is not a mount0 trace`);
+  const version = data.readUInt32LE(8);
+  if (version !== VERSION) throw new Error(`Unsupported trace version ${version}`);
+
+  const records: TraceRecord[] = [];
+  let off = HEADER_SIZE;
+  while (off + RECORD_SIZE <= data.length) {
+    const nargs = data.readUInt8(off + 1);
+    const nextras = data.readUInt8(off + 2);
+    const record: TraceRecord = {
+      opcode: data.readUInt8(off),
+      errno: data.readInt32LE(off + 4),
+      start: data.readDoubleLE(off + 8),
+      duration: data.readDoubleLE(off + 16),
+      size: data.readDoubleLE(off + 24),
+      ino: data.readDoubleLE(off + 32),
+      fh: data.readDoubleLE(off + 40),
+      args: [],
+      extras: [],
+    };
+    off += RECORD_SIZE;
+    // A trace cut short by a crash ends in a partial record
+    if (off + nargs * 8 > data.length) break;
+    for (let i = 0; i < nargs; i++, off += 8) record.args.push(data.readDoubleLE(off));
+    let complete = true;
+    for (let i = 0; i < nextras && complete; i++) {
+      complete = off + 5 <= data.length;
+      if (!complete) break;
+      const tag = data.readUInt8(off);
+      const length = data.readUInt32LE(off + 1);
+      off += 5;
+      const stored = tag === Tag.ELIDED || tag === Tag.NONE ? 0 : length;
+      complete = off + stored <= data.length;
+      if (complete) record.extras.push(decodeExtra(tag, data.subarray(off, off + stored), length));
+      off += stored;
+    }
+    if (!complete) break;
+    records.push(record);
+  }
+  return records;
+}
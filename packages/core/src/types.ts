@@ -18,6 +18,8 @@ export interface DirEntry {
   name: string;
   mode: number;
   ino: number;
+  /** Full attributes (readdirplus); entries without them are looked up by the kernel */
+  stat?: FileStat;
 }
 
 export interface FileHandle {
@@ -25,3 +27,73 @@ export interface FileHandle {
   path: string;
   flags: number;
 }
+
+/**
+ * Kernel caching policy for a provider or path.
+ * Timeouts are in seconds; anything left unset falls back to the mount-wide policy.
+ */
+export interface CachePolicy {
+  /** How long the kernel may cache name lookups */
+  entryTimeout?: number;
+  /** How long the kernel may cache file attributes */
+  attrTimeout?: number;
+  /** Keep the page cache across opens (FOPEN_KEEP_CACHE) */
+  keepCache?: boolean;
+  /** Bypass the page cache for file I/O (FOPEN_DIRECT_IO) */
+  directIo?: boolean;
+  /** Allow concurrent direct writes to the same file (FOPEN_PARALLEL_DIRECT_WRITES) */
+  parallelDirectWrites?: boolean;
+  /** How long the native cache answers lookup and getattr without calling the provider (0 disables) */
+  nativeCacheTimeout?: number;
+  /** How long the kernel may remember that a name does not exist (0, the default, disables) */
+  negativeTimeout?: number;
+}
+
+/** Classes of requests that queue separately in the native addon, in drain priority order */
+export type QueueLane = "metadata" | "read" | "write" | "background";
+
+export interface LaneStats {
+  /** Requests admitted and not yet replied to, whether queued or in JavaScript */
+  depth: number;
+  /** The part of depth handed to JavaScript */
+  inflight: number;
+  /** Depth at which FUSE threads wait for room (0 = unbounded) */
+  limit: number;
+  /** FUSE threads currently waiting */
+  waiting: number;
+  /** Times since mount a FUSE thread had to wait */
+  throttled: number;
+}
+
+export type QueueStats = Record<QueueLane, LaneStats>;
+
+/** Latency of one phase of a request, in microseconds */
+export interface PhaseStats {
+  count: number;
+  mean: number;
+  p50: number;
+  p90: number;
+  p99: number;
+  max: number;
+}
+
+export interface OpStats {
+  /** Requests handed to JavaScript. Requests answered from the native cache are not counted. */
+  count: number;
+  /** Replies with a non-zero errno */
+  errors: number;
+  /** From the FUSE thread until JavaScript received the request */
+  queue: PhaseStats;
+  /** From delivery until the provider's reply reached the addon */
+  js: PhaseStats;
+  /** Inside the native reply, including the write to /dev/fuse */
+  reply: PhaseStats;
+}
+
+export interface MountStats {
+  /** Keyed by operation name, e.g. "lookup"; operations never seen are left out */
+  ops: Record<string, OpStats>;
+  queues: QueueStats;
+  /** How the kernel delivers requests; "dev_fuse" when io_uring was not requested or not available */
+  transport: "io_uring" | "dev_fuse";
+}
@@ -0,0 +1,119 @@
+import { Worker } from "worker_threads";
+import { FuseConfig } from "./bridge";
+import { FilesystemProvider, ProviderCapabilities } from "./provider";
+
+/**
+ * Serve a mount from worker_threads, each with its own provider instance.
+ *
+ * Workers share nothing: every worker imports `module` and calls its `createProvider`
+ * export. The provider's inode numbers must therefore not depend on the instance: a
+ * lookup answered by one worker hands the kernel an inode that the others are asked
+ * about later, so every worker has to resolve it the same way (derived from `data`, the
+ * backing store's own inode numbers, ...). Providers that number inodes as they see
+ * them, like InodeTable-based wrappers and LocalProvider, can't be split this way.
+ *
+ * With "inode" sharding all requests for an inode (and entry operations for names in a
+ * directory) reach the same worker, so file handles stay local to it. With "roundRobin"
+ * requests are spread evenly and providers must keep no per-handle state either.
+ */
+export interface WorkerOptions {
+  /** Number of worker_threads */
+  count: number;
+  /** Module exporting `createProvider: ProviderFactory`, imported in every worker */
+  module: string | URL;
+  /** How requests are spread over workers (default "inode") */
+  sharding?: "inode" | "roundRobin";
+  /** Passed to createProvider; must be structured-cloneable */
+  data?: unknown;
+}
+
+/** The `createProvider` export of a worker module */
+export type ProviderFactory = (data: unknown, index: number) => FilesystemProvider | Promise<FilesystemProvider>;
+
+export interface WorkerStartup {
+  index: number;
+  module: string;
+  data: unknown;
+}
+
+/** Messages from a worker: once its provider is built and initialized, and once it serves the mount */
+export type WorkerReply = { ready: true; capabilities?: ProviderCapabilities } | { attached: true } | { error: string };
+
+export class WorkerPool {
+  private constructor(
+    private readonly workers: Worker[],
+    /** What the workers' providers declared, for registering ops before the mount */
+    readonly capabilities: ProviderCapabilities | undefined,
+  ) {}
+
+  /** Starts count workers and resolves once each has built and initialized its provider */
+  static async spawn(options: WorkerOptions): Promise<WorkerPool> {
+    const module = options.module instanceof URL ? options.module.href : options.module;
+    const workers: Worker[] = [];
+    for (let index = 0; index < options.count; index++) {
+      const startup: WorkerStartup = { index, module, data: options.data };
+      workers.push(new Worker(new URL("./worker.js", import.meta.url), { workerData: startup }));
+    }
+
+    try {
+      const replies = await Promise.all(workers.map((worker, index) => reply(worker, index)));
+      // Every worker runs the same module; the first one speaks for all
+      const first = replies[0] as { capabilities?: ProviderCapabilities } | undefined;
+      return new WorkerPool(workers, first?.capabilities);
+    } catch (err) {
+      await Promise.all(workers.map((w) => w.terminate()));
+      throw err;
+    }
+  }
+
+  /** Has every worker serve its share of mountId; resolves once all are attached */
+  async attach(mountId: number, config: FuseConfig): Promise<void> {
+    await Promise.all(
+      this.workers.map((worker, index) => {
+        const attached = reply(worker, index);
+        worker.postMessage({ attach: { mountId, config } });
+        return attached;
+      }),
+    );
+  }
+
+  /** Lets each worker destroy its provider and exit. Call after the mount is gone. */
+  async stop(): Promise<void> {
+    await Promise.all(
+      this.workers.map(
+        (worker) =>
+          new Promise<void>((resolve) => {
+            worker.once("exit", () => resolve());
+            worker.postMessage("stop");
+          }),
+      ),
+    );
+  }
+}
+
+// The worker's next message, rejecting on an error report or exit
+function reply(worker: Worker, index: number): Promise<WorkerReply> {
+  return new Promise((resolve, reject) => {
+    const onMessage = (msg: WorkerReply) => {
+      cleanup();
+      if ("error" in msg) reject(new Error(`Worker ${index} failed to start: ${msg.error}`));
+      else resolve(msg);
+    };
+    const onError = (err: Error) => {
+      cleanup();
+      reject(err);
+    };
+    const onExit = (code: number) => {
+      cleanup();
+      reject(new Error(`Worker ${index} exited with code ${code}`));
+    };
+    const cleanup = () => {
+      worker.off("message", onMessage);
+      worker.off("error", onError);
+      worker.off("exit", onExit);
+    };
+    worker.on("message", onMessage);
+    worker.on("error", onError);
+    worker.on("exit", onExit);
+  });
+}
@@ -0,0 +1,38 @@
+// Entry point of the worker_threads started by WorkerPool
+import { parentPort, workerData } from "worker_threads";
+import { FuseBridge, FuseConfig } from "./bridge";
+import { ProviderFactory, WorkerReply, WorkerStartup } from "./worker-pool";
+
+// The mount's INIT and DESTROY requests are answered on the main thread, so each worker
+// initializes its own provider before reporting ready and destroys it on "stop"
+async function main(): Promise<void> {
+  const { index, module, data } = workerData as WorkerStartup;
+  const { createProvider } = (await import(module)) as { createProvider?: ProviderFactory };
+  if (typeof createProvider !== "function") throw new Error(`${module} does not export createProvider`);
+
+  const provider = await createProvider(data, index);
+  await provider.init?.();
+
+  parentPort!.on("message", async (msg: "stop" | { attach: { mountId: number; config: FuseConfig } }) => {
+    if (msg === "stop") {
+      await provider.destroy?.();
+      parentPort!.close();
+      return;
+    }
+    try {
+      new FuseBridge(provider).serveWorker(msg.attach.mountId, index, msg.attach.config);
+      post({ attached: true });
+    } catch (err) {
+      post({ error: err instanceof Error ? err.message : String(err) });
+    }
+  });
+  post({ ready: true, capabilities: provider.capabilities?.() });
+}
+
+function post(msg: WorkerReply): void {
+  parentPort!.postMessage(msg);
+}
+
+main().catch((err) => {
+  post({ error: err instanceof Error ? err.message : String(err) });
+});
@@ -0,0 +1,46 @@
+/**
+ * Batch Decoding Tests
+ */
+
+import { DESC_STRIDE, decodeParams } from "../src/batch";
+import { Opcode } from "../src/opcodes";
+
+function descriptor(requests: Array<[number, Opcode, number, number[]]>): Float64Array {
+  const desc = new Float64Array(requests.length * DESC_STRIDE);
+  requests.forEach(([reqPtr, op, extrasBase, args], k) => {
+    desc.set([reqPtr, op, extrasBase, ...args], k * DESC_STRIDE);
+  });
+  return desc;
+}
+
+describe("decodeParams", () => {
+  test("decodes numeric arguments and extras for each request", () => {
+    const data = Buffer.from("hello");
+    const desc = descriptor([
+      [1, Opcode.LOOKUP, 0, [1]],
+      [2, Opcode.WRITE, 1, [5, 7, 5, 4096]],
+      [3, Opcode.RENAME, 2, [1, 2, 0]],
+    ]);
+    const extras = ["a.txt", data, "old", "new"];
+
+    expect(decodeParams(desc, 0, extras)).toEqual({ parent: 1, name: "a.txt" });
+    expect(decodeParams(desc, DESC_STRIDE, extras)).toEqual({ ino: 5, fh: 7, size: 5, off: 4096, data });
+    expect(decodeParams(desc, 2 * DESC_STRIDE, extras)).toEqual({
+      parent: 1,
+      newparent: 2,
+      flags: 0,
+      name: "old",
+      newname: "new",
+    });
+  });
+
+  test("rebuilds lock objects", () => {
+    const desc = descriptor([[1, Opcode.SETLK, 0, [5, 7, 1, 0, 100, 50, 42, 1]]]);
+    expect(decodeParams(desc, 0, [])).toEqual({
+      ino: 5,
+      fh: 7,
+      lock: { type: 1, whence: 0, start: 100, len: 50, pid: 42 },
+      sleep: 1,
+    });
+  });
+});
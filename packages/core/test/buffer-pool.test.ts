@@ -0,0 +1,58 @@
+/**
+ * BufferPool Tests
+ */
+
+import { BufferPool } from "../src/buffer-pool";
+
+describe("BufferPool", () => {
+  test("acquire returns a view of the requested length", () => {
+    const pool = new BufferPool();
+    const buf = pool.acquire(10000);
+    expect(buf.length).toBe(10000);
+    expect(buf.buffer.byteLength).toBe(16384);
+  });
+
+  test("released buffers are reused for the same size class", () => {
+    const allocate = jest.fn((size: number) => Buffer.allocUnsafeSlow(size));
+    const pool = new BufferPool({ allocate });
+
+    const first = pool.acquire(128 * 1024);
+    pool.release(first);
+    expect(pool.size).toBe(1);
+
+    const second = pool.acquire(100 * 1024);
+    expect(second.buffer).toBe(first.buffer);
+    expect(allocate).toHaveBeenCalledTimes(1);
+    expect(pool.size).toBe(0);
+  });
+
+  test("small requests use the minimum size class", () => {
+    const pool = new BufferPool({ minSize: 4096 });
+    expect(pool.acquire(1).buffer.byteLength).toBe(4096);
+    expect(pool.acquire(0).length).toBe(0);
+  });
+
+  test("requests above maxSize are not pooled", () => {
+    const allocate = jest.fn((size: number) => Buffer.allocUnsafeSlow(size));
+    const pool = new BufferPool({ maxSize: 64 * 1024, allocate });
+
+    const big = pool.acquire(64 * 1024 + 1);
+    expect(big.length).toBe(64 * 1024 + 1);
+    pool.release(big);
+    expect(pool.size).toBe(0);
+  });
+
+  test("free list is capped per size class", () => {
+    const pool = new BufferPool({ maxPerClass: 2 });
+    const bufs = [pool.acquire(4096), pool.acquire(4096), pool.acquire(4096)];
+    bufs.forEach((b) => pool.release(b));
+    expect(pool.size).toBe(2);
+  });
+
+  test("buffers not owned by the pool are ignored", () => {
+    const pool = new BufferPool();
+    pool.release(Buffer.from("hello"));
+    pool.release(Buffer.allocUnsafeSlow(8192).subarray(4096));
+    expect(pool.size).toBe(0);
+  });
+});
@@ -0,0 +1,66 @@
+/**
+ * Directory Cursor Tests
+ */
+
+import { DirectoryCursors, direntSize, fitEntries } from "../src/dir-cursor";
+import { DirEntry } from "../src/types";
+
+function listing(count: number): DirEntry[] {
+  return Array.from({ length: count }, (_, i) => ({ name: `file${i}`, mode: 0o100644, ino: i + 2 }));
+}
+
+describe("direntSize", () => {
+  test("pads entries to 8 bytes", () => {
+    expect(direntSize("a")).toBe(32);
+    expect(direntSize("12345678")).toBe(32);
+    expect(direntSize("123456789")).toBe(40);
+    expect(direntSize("a", true)).toBe(160);
+  });
+});
+
+describe("fitEntries", () => {
+  test("returns only entries that fit in size", () => {
+    const entries = listing(10);
+    const page = fitEntries(entries, 0, 3 * direntSize("file0"));
+    expect(page.map((e) => e.name)).toEqual(["file0", "file1", "file2"]);
+  });
+
+  test("starts at the offset cookie", () => {
+    const entries = listing(10);
+    expect(fitEntries(entries, 8, 4096).map((e) => e.name)).toEqual(["file8", "file9"]);
+    expect(fitEntries(entries, 10, 4096)).toEqual([]);
+  });
+});
+
+describe("DirectoryCursors", () => {
+  test("lists a directory once per handle while paging", async () => {
+    const cursors = new DirectoryCursors();
+    const list = jest.fn().mockResolvedValue(listing(1000));
+    const names: string[] = [];
+
+    let off = 0;
+    for (;;) {
+      const page = await cursors.read(7, off, 4096, list);
+      if (page.length === 0) break;
+      names.push(...page.map((e) => e.name));
+      off += page.length;
+    }
+
+    expect(names).toHaveLength(1000);
+    expect(new Set(names).size).toBe(1000);
+    expect(list).toHaveBeenCalledTimes(1);
+  });
+
+  test("offset 0 and release take a fresh snapshot", async () => {
+    const cursors = new DirectoryCursors();
+    const list = jest.fn().mockResolvedValue(listing(3));
+
+    await cursors.read(1, 0, 4096, list);
+    await cursors.read(1, 0, 4096, list);
+    expect(list).toHaveBeenCalledTimes(2);
+
+    cursors.release(1);
+    await cursors.read(1, 2, 4096, list);
+    expect(list).toHaveBeenCalledTimes(3);
+  });
+});
@@ -2,7 +2,8 @@
  * Filesystem Tests
  */
 
-import { FilesystemProvider } from "../src/provider";
+import { capabilityOps } from "../src/bridge";
+import { FilesystemProvider, KernelNotifier } from "../src/provider";
 import { RouterProvider } from "../src/router";
 import { DirEntry, FileStat } from "../src/types";
 
@@ -62,12 +63,101 @@ describe("RouterProvider", () => {
       const result1 = await router.lookup(1, "data");
       const result2 = await router.lookup(1, "cache");
 
-      expect(result1).toEqual(stat1);
-      expect(result2).toEqual(stat2);
+      expect(result1).toEqual({ ...stat1, ino: expect.any(Number) });
+      expect(result2).toEqual({ ...stat2, ino: expect.any(Number) });
+      expect(result1!.ino).not.toBe(result2!.ino);
       expect(provider1.getattr).toHaveBeenCalledWith(1, 0);
       expect(provider2.getattr).toHaveBeenCalledWith(1, 0);
     });
 
+    test("should give each route its own inode namespace", async () => {
+      const stat: FileStat = {
+        mode: 0o644,
+        size: 0,
+        mtime: 0,
+        ctime: 0,
+        atime: 0,
+        uid: 0,
+        gid: 0,
+        dev: 0,
+        ino: 7,
+        nlink: 1,
+        rdev: 0,
+        blksize: 0,
+        blocks: 0,
+      };
+      const provider1: FilesystemProvider = { lookup: jest.fn().mockResolvedValue(stat), getattr: jest.fn().mockResolvedValue(stat) } as any;
+      const provider2: FilesystemProvider = { lookup: jest.fn().mockResolvedValue(stat), getattr: jest.fn().mockResolvedValue(stat) } as any;
+
+      const router = new RouterProvider([
+        { path: "/a", provider: provider1 },
+        { path: "/b", provider: provider2 },
+      ]);
+      const a = (await router.lookup(1, "a"))!;
+      const b = (await router.lookup(1, "b"))!;
+      expect(a.ino).not.toBe(b.ino);
+      expect(stat.ino).toBe(7);
+
+      await router.getattr(b.ino, 0);
+      expect(provider2.getattr).toHaveBeenLastCalledWith(7, 0);
+      expect(provider1.getattr).toHaveBeenCalledTimes(1);
+    });
+
+    test("should serve the mount root from a route at /", async () => {
+      const rootStat: FileStat = {
+        mode: 0o40755,
+        size: 0,
+        mtime: 0,
+        ctime: 0,
+        atime: 0,
+        uid: 0,
+        gid: 0,
+        dev: 0,
+        ino: 2,
+        nlink: 2,
+        rdev: 0,
+        blksize: 0,
+        blocks: 0,
+      };
+      const fileStat = { ...rootStat, mode: 0o100644, ino: 12 };
+      const root: FilesystemProvider = {
+        lookup: jest.fn().mockResolvedValue(fileStat),
+        getattr: jest.fn().mockResolvedValue(rootStat),
+        readdir: jest.fn().mockResolvedValue([{ name: "file", mode: 0o100644, ino: 12 }]),
+      } as any;
+      const data: FilesystemProvider = { getattr: jest.fn().mockResolvedValue(rootStat) } as any;
+
+      const router = new RouterProvider([
+        { path: "/", provider: root },
+        { path: "/data", provider: data },
+      ]);
+
+      expect(await router.getattr(1, 0)).toEqual({ ...rootStat, ino: 1 });
+      expect(root.getattr).toHaveBeenCalledWith(1, 0);
+      const file = (await router.lookup(1, "file"))!;
+      expect(root.lookup).toHaveBeenCalledWith(1, "file");
+      expect((await router.readdir(1, 0, 4096, 0))[0].ino).toBe(file.ino);
+      await router.lookup(1, "data");
+      expect(data.getattr).toHaveBeenCalledWith(1, 0);
+      expect(root.lookup).toHaveBeenCalledTimes(1);
+    });
+
+    test("should refuse to rename across routes", async () => {
+      const dir = { mode: 0o40755, ino: 2 } as FileStat;
+      const provider1: FilesystemProvider = { getattr: jest.fn().mockResolvedValue(dir), rename: jest.fn() } as any;
+      const provider2: FilesystemProvider = { getattr: jest.fn().mockResolvedValue(dir), rename: jest.fn() } as any;
+
+      const router = new RouterProvider([
+        { path: "/a", provider: provider1 },
+        { path: "/b", provider: provider2 },
+      ]);
+      const a = (await router.lookup(1, "a"))!;
+      const b = (await router.lookup(1, "b"))!;
+
+      await expect(router.rename(a.ino, "x", b.ino, "x", 0)).rejects.toMatchObject({ code: "EXDEV" });
+      expect(provider1.rename).not.toHaveBeenCalled();
+    });
+
     test("should prefer longest matching path", async () => {
       const dataStat: FileStat = {
         mode: 0o755,
@@ -116,7 +206,7 @@ describe("RouterProvider", () => {
       // When looking up 'data' from root, it should match /data (not /data/sub)
       // because lookup(1, 'data') calls matchProvider('/data')
       const dataResult = await router.lookup(1, "data");
-      expect(dataResult).toEqual(dataStat);
+      expect(dataResult).toEqual({ ...dataStat, ino: expect.any(Number) });
       expect(provider1.getattr).toHaveBeenCalledWith(1, 0);
 
       // When looking up 'sub' under the data inode, it should use provider1
@@ -125,8 +215,8 @@ describe("RouterProvider", () => {
         // The inode is registered to provider1, so lookup will use provider1
         provider1.lookup = jest.fn().mockResolvedValue(subStat);
         const subResult = await router.lookup(dataResult.ino, "sub");
-        expect(subResult).toEqual(subStat);
-        expect(provider1.lookup).toHaveBeenCalledWith(dataResult.ino, "sub");
+        expect(subResult).toEqual({ ...subStat, ino: expect.any(Number) });
+        expect(provider1.lookup).toHaveBeenCalledWith(dataStat.ino, "sub");
       }
     });
 
@@ -155,11 +245,11 @@ describe("RouterProvider", () => {
 
       // First lookup to register the inode
       const lookupResult = await router.lookup(1, "data");
-      expect(lookupResult).toEqual(stat);
+      expect(lookupResult).toEqual({ ...stat, ino: expect.any(Number) });
 
-      // Then getattr should use the registered provider
-      const getattrResult = await router.getattr(stat.ino, 0);
-      expect(getattrResult).toEqual(stat);
+      // Then getattr should use the provider the inode belongs to
+      const getattrResult = await router.getattr(lookupResult!.ino, 0);
+      expect(getattrResult).toEqual(lookupResult);
       expect(provider.getattr).toHaveBeenCalledWith(stat.ino, 0);
     });
   });
@@ -198,8 +288,8 @@ describe("RouterProvider", () => {
         const dataStat = await router.lookup(1, "data");
         if (dataStat) {
           const { stat: result } = await router.create(dataStat.ino, "test.txt", 0o644, 0);
-          expect(result).toEqual(createdStat);
-          expect(provider.create).toHaveBeenCalledWith(dataStat.ino, "test.txt", 0o644, 0);
+          expect(result).toEqual({ ...createdStat, ino: expect.any(Number) });
+          expect(provider.create).toHaveBeenCalledWith(createdStat.ino, "test.txt", 0o644, 0);
         }
       }
     });
@@ -234,30 +324,30 @@ describe("RouterProvider", () => {
 
       // Lookup file
       const stat = await router.lookup(1, "data");
-      expect(stat).toEqual(fileStat);
+      expect(stat).toEqual({ ...fileStat, ino: expect.any(Number) });
       expect(stat).not.toBeNull();
 
       if (stat) {
         // Open file
         const fh = await router.open(stat.ino, 0, 0o644);
         expect(fh).toBe(1);
-        expect(provider.open).toHaveBeenCalledWith(stat.ino, 0, 0o644);
+        expect(provider.open).toHaveBeenCalledWith(fileStat.ino, 0, 0o644);
 
         // Write to file
         const writeBuffer = Buffer.from("Hello, World!");
         const bytesWritten = await router.write(stat.ino, fh, writeBuffer, 0, writeBuffer.length);
         expect(bytesWritten).toBe(13);
-        expect(provider.write).toHaveBeenCalledWith(stat.ino, fh, writeBuffer, 0, writeBuffer.length);
+        expect(provider.write).toHaveBeenCalledWith(fileStat.ino, fh, writeBuffer, 0, writeBuffer.length);
 
         // Read from file
         const readBuffer = Buffer.alloc(13);
         const bytesRead = await router.read(stat.ino, fh, readBuffer, 0, 13);
         expect(bytesRead).toBe(13);
-        expect(provider.read).toHaveBeenCalledWith(stat.ino, fh, readBuffer, 0, 13);
+        expect(provider.read).toHaveBeenCalledWith(fileStat.ino, fh, readBuffer, 0, 13);
 
         // Release file
         await router.release(stat.ino, fh);
-        expect(provider.release).toHaveBeenCalledWith(stat.ino, fh);
+        expect(provider.release).toHaveBeenCalledWith(fileStat.ino, fh);
       }
     });
 
@@ -290,23 +380,23 @@ describe("RouterProvider", () => {
 
       // Lookup directory
       const stat = await router.lookup(1, "data");
-      expect(stat).toEqual(dirStat);
+      expect(stat).toEqual({ ...dirStat, ino: expect.any(Number) });
       expect(stat).not.toBeNull();
 
       if (stat) {
         // Create subdirectory
         const createdDir = await router.mkdir(stat.ino, "subdir", 0o755);
-        expect(createdDir).toEqual(dirStat);
-        expect(provider.mkdir).toHaveBeenCalledWith(stat.ino, "subdir", 0o755);
+        expect(createdDir).toEqual(stat);
+        expect(provider.mkdir).toHaveBeenCalledWith(dirStat.ino, "subdir", 0o755);
 
         // Read directory
         const dirEntries = await router.readdir(stat.ino, 0, 4096, 0);
-        expect(dirEntries).toEqual(entries);
-        expect(provider.readdir).toHaveBeenCalledWith(stat.ino, 0, 4096, 0);
+        expect(dirEntries).toEqual([{ ...entries[0], ino: expect.any(Number) }]);
+        expect(provider.readdir).toHaveBeenCalledWith(dirStat.ino, 0, 4096, 0);
 
         // Remove directory
         await router.rmdir(stat.ino, "subdir");
-        expect(provider.rmdir).toHaveBeenCalledWith(stat.ino, "subdir");
+        expect(provider.rmdir).toHaveBeenCalledWith(dirStat.ino, "subdir");
       }
     });
 
@@ -339,13 +429,13 @@ describe("RouterProvider", () => {
 
       // Lookup parent directory
       const parentStat = await router.lookup(1, "data");
-      expect(parentStat).toEqual(fileStat);
+      expect(parentStat).toEqual({ ...fileStat, ino: expect.any(Number) });
       expect(parentStat).not.toBeNull();
 
       if (parentStat) {
         // Create file
         const { stat: createdStat } = await router.create(parentStat.ino, "file.txt", 0o644, 0);
-        expect(createdStat).toEqual(fileStat);
+        expect(createdStat).toEqual(parentStat);
 
         // Get attributes
         const resultStat = await router.getattr(createdStat.ino, 0);
@@ -353,13 +443,64 @@ describe("RouterProvider", () => {
 
         // Rename file
         await router.rename(parentStat.ino, "file.txt", parentStat.ino, "new.txt", 0);
-        expect(provider.rename).toHaveBeenCalledWith(parentStat.ino, "file.txt", parentStat.ino, "new.txt", 0);
+        expect(provider.rename).toHaveBeenCalledWith(fileStat.ino, "file.txt", fileStat.ino, "new.txt", 0);
 
         // Unlink file
         await router.unlink(parentStat.ino, "new.txt");
-        expect(provider.unlink).toHaveBeenCalledWith(parentStat.ino, "new.txt");
+        expect(provider.unlink).toHaveBeenCalledWith(fileStat.ino, "new.txt");
       }
     });
+
+    test("should pass compound results back in kernel inode numbers", async () => {
+      const dir = { mode: 0o40755, ino: 2 } as FileStat;
+      const file = { mode: 0o100644, size: 0, ino: 7 } as FileStat;
+      const compound: FilesystemProvider = {
+        getattr: jest.fn().mockResolvedValue(dir),
+        setattr: jest.fn().mockResolvedValue(file),
+        unlink: jest.fn().mockResolvedValue(7),
+      } as any;
+      const plain: FilesystemProvider = {
+        getattr: jest.fn().mockResolvedValue(dir),
+        setattr: jest.fn().mockResolvedValue(undefined),
+        rmdir: jest.fn().mockResolvedValue(undefined),
+      } as any;
+
+      const router = new RouterProvider([]);
+      router.handle("/a", compound);
+      router.handle("/b", plain);
+      const a = await router.lookup(1, "a");
+      const b = await router.lookup(1, "b");
+      const removed = await router.unlink(a!.ino, "f");
+
+      expect(removed).not.toBe(7);
+      expect(await router.setattr(removed!, 0, 8, file)).toEqual({ ...file, ino: removed });
+      expect(compound.setattr).toHaveBeenCalledWith(7, 0, 8, file);
+      expect(await router.setattr(b!.ino, 0, 8, file)).toBeNull();
+      expect(await router.rmdir(b!.ino, "d")).toBeUndefined();
+    });
+
+    test("should renumber the attributes carried by readdirplus entries", async () => {
+      const dir = { mode: 0o40755, ino: 2 } as FileStat;
+      const file = { mode: 0o100644, size: 5, ino: 7 } as FileStat;
+      const provider: FilesystemProvider = {
+        getattr: jest.fn().mockResolvedValue(dir),
+        readdirplus: jest.fn().mockResolvedValue([
+          { name: "f", mode: file.mode, ino: 7, stat: file },
+          { name: "g", mode: file.mode, ino: 8 },
+        ]),
+      } as any;
+
+      const router = new RouterProvider([]);
+      router.handle("/a", provider);
+      const [root] = await router.readdirplus(1, 1, 4096, 0);
+      expect(root.stat).toEqual({ ...dir, ino: root.ino });
+
+      const [f, g] = await router.readdirplus(root.ino, 1, 4096, 0);
+      expect(f.ino).not.toBe(7);
+      expect(f.stat).toEqual({ ...file, ino: f.ino });
+      expect(g.stat).toBeUndefined();
+      expect(file.ino).toBe(7);
+    });
   });
 
   describe("Error Handling", () => {
@@ -459,4 +600,190 @@ describe("RouterProvider", () => {
       expect(router.providers[1].path).toBe("/data");
     });
   });
+
+  describe("Cache Policy", () => {
+    const stat: FileStat = {
+      mode: 0o100644,
+      size: 0,
+      mtime: 0,
+      ctime: 0,
+      atime: 0,
+      uid: 0,
+      gid: 0,
+      dev: 0,
+      ino: 5,
+      nlink: 1,
+      rdev: 0,
+      blksize: 0,
+      blocks: 0,
+    };
+
+    test("should return the route policy for inodes it serves", async () => {
+      const provider: FilesystemProvider = {
+        lookup: jest.fn().mockResolvedValue(stat),
+        getattr: jest.fn().mockResolvedValue(stat),
+      } as any;
+
+      const router = new RouterProvider([]);
+      router.handle("/static", provider, { cache: { entryTimeout: 3600, keepCache: true } });
+
+      expect(router.cachePolicy(5)).toBeUndefined();
+      const entry = await router.lookup(1, "static");
+      expect(router.cachePolicy(entry!.ino)).toEqual({ entryTimeout: 3600, keepCache: true });
+      expect(router.cachePolicy(1)).toBeUndefined();
+    });
+
+    test("route policy overrides the provider's own policy", async () => {
+      const provider: FilesystemProvider = {
+        lookup: jest.fn().mockResolvedValue(stat),
+        getattr: jest.fn().mockResolvedValue(stat),
+        cachePolicy: jest.fn().mockReturnValue({ attrTimeout: 10, directIo: true }),
+      } as any;
+
+      const router = new RouterProvider([]);
+      router.handle("/", provider, { cache: { directIo: false } });
+      const entry = await router.lookup(1, "file");
+
+      expect(router.cachePolicy(entry!.ino)).toEqual({ attrTimeout: 10, directIo: false });
+      expect(provider.cachePolicy).toHaveBeenCalledWith(5);
+    });
+
+    test("routes opt in to caching misses independently", async () => {
+      const dir = { ...stat, mode: 0o40755 };
+      const cached: FilesystemProvider = { getattr: jest.fn().mockResolvedValue(dir) } as any;
+      const live: FilesystemProvider = { getattr: jest.fn().mockResolvedValue({ ...dir, ino: 6 }) } as any;
+
+      const router = new RouterProvider([]);
+      router.handle("/usr", cached, { cache: { negativeTimeout: 60 } });
+      router.handle("/tmp", live, { cache: { negativeTimeout: 0 } });
+      const usr = await router.lookup(1, "usr");
+      const tmp = await router.lookup(1, "tmp");
+
+      expect(router.cachePolicy(usr!.ino)?.negativeTimeout).toBe(60);
+      expect(router.cachePolicy(tmp!.ino)?.negativeTimeout).toBe(0);
+    });
+
+    test("only passthrough routes expose backing descriptors", async () => {
+      const file = { ...stat, mode: 0o100644 };
+      const local: FilesystemProvider = { getattr: jest.fn().mockResolvedValue(file), backingFd: jest.fn().mockReturnValue(17) } as any;
+      const other: FilesystemProvider = { getattr: jest.fn().mockResolvedValue({ ...file, ino: 6 }), backingFd: jest.fn().mockReturnValue(18) } as any;
+
+      const router = new RouterProvider([]);
+      router.handle("/data", local, { passthrough: true });
+      router.handle("/policy", other);
+      const data = await router.lookup(1, "data");
+      const policy = await router.lookup(1, "policy");
+
+      expect(router.backingFd(data!.ino, 3)).toBe(17);
+      expect(local.backingFd).toHaveBeenCalledWith(5, 3);
+      expect(router.backingFd(policy!.ino, 3)).toBeUndefined();
+      expect(other.backingFd).not.toHaveBeenCalled();
+      expect(router.backingFd(1, 3)).toBeUndefined();
+    });
+
+    test("only routes that count lookups keep names out of the native cache", async () => {
+      const dir = { ...stat, mode: 0o40755 };
+      const wrapper: FilesystemProvider = { getattr: jest.fn().mockResolvedValue(dir), forget: jest.fn() } as any;
+      const leaf: FilesystemProvider = { getattr: jest.fn().mockResolvedValue({ ...dir, ino: 6 }) } as any;
+
+      const router = new RouterProvider([]);
+      router.handle("/cached", wrapper);
+      router.handle("/plain", leaf);
+      const cached = await router.lookup(1, "cached");
+      const plain = await router.lookup(1, "plain");
+
+      expect(router.countsLookups(cached!.ino)).toBe(true);
+      expect(router.countsLookups(plain!.ino)).toBe(false);
+    });
+  });
+
+  describe("Capabilities", () => {
+    test("should offer the ops any route implements", () => {
+      const router = new RouterProvider([]);
+      router.handle("/a", { capabilities: () => ({ readdirplus: true }) } as any);
+      router.handle("/b", { capabilities: () => ({ posixLocks: true, xattr: false }) } as any);
+
+      expect(router.capabilities()).toEqual({ readdirplus: true, posixLocks: true });
+      expect(capabilityOps(router.capabilities())).toBe(0x1 | 0x8);
+    });
+
+    test("should need every op when a route declares nothing", () => {
+      const router = new RouterProvider([]);
+      router.handle("/a", { capabilities: () => ({}) } as any);
+      expect(capabilityOps(router.capabilities())).toBe(0);
+
+      router.handle("/b", {} as any);
+      expect(router.capabilities()).toBeUndefined();
+      expect(capabilityOps(router.capabilities())).toBe(0xfff);
+    });
+
+    test("should answer as the kernel would on routes lacking an op", async () => {
+      const dir = { mode: 0o40755, ino: 1 } as FileStat;
+      const plain = { capabilities: () => ({}), getattr: jest.fn().mockResolvedValue(dir), readdir: jest.fn().mockResolvedValue([{ name: "f", mode: 0o100644, ino: 2 }]), readdirplus: jest.fn(), access: jest.fn(), fallocate: jest.fn(), copy_file_range: jest.fn() } as any;
+
+      const router = new RouterProvider([]);
+      router.handle("/a", { capabilities: () => ({ readdirplus: true, access: true, fallocate: true, copyFileRange: true }) } as any);
+      router.handle("/b", plain);
+      const root = await router.lookup(1, "b");
+
+      const entries = await router.readdirplus(root!.ino, 0, 4096, 0);
+      expect(entries).toEqual([expect.objectContaining({ name: "f" })]);
+      expect(entries[0].stat).toBeUndefined();
+      expect(plain.readdirplus).not.toHaveBeenCalled();
+      await expect(router.access(root!.ino, 4)).resolves.toBeUndefined();
+      await expect(router.fallocate(root!.ino, 0, 0, 1, 0)).rejects.toEqual({ code: "EOPNOTSUPP", errno: -95 });
+      await expect(router.copy_file_range(root!.ino, 0, 0, root!.ino, 0, 0, 1, 0)).rejects.toEqual({ code: "EOPNOTSUPP", errno: -95 });
+      expect(plain.access).not.toHaveBeenCalled();
+      expect(plain.fallocate).not.toHaveBeenCalled();
+      expect(plain.copy_file_range).not.toHaveBeenCalled();
+    });
+  });
+
+  describe("Kernel Notifier", () => {
+    const notifier: KernelNotifier = {
+      invalInode: jest.fn(),
+      invalEntry: jest.fn(),
+      delete: jest.fn(),
+      store: jest.fn(),
+      retrieve: jest.fn(),
+    };
+
+    test("should attach the notifier to every route, including later ones", () => {
+      const first = { attachNotifier: jest.fn() } as any;
+      const second = { attachNotifier: jest.fn() } as any;
+
+      const router = new RouterProvider([]);
+      router.handle("/a", first);
+      router.attachNotifier(notifier);
+      router.handle("/b", second);
+
+      expect(first.attachNotifier).toHaveBeenCalledWith(expect.objectContaining({ invalInode: expect.any(Function) }));
+      expect(second.attachNotifier).toHaveBeenCalledWith(expect.objectContaining({ invalInode: expect.any(Function) }));
+    });
+
+    test("should translate notifications into the route's inode numbers", async () => {
+      const dir = { mode: 0o40755, ino: 2 } as FileStat;
+      const provider = { attachNotifier: jest.fn(), getattr: jest.fn().mockResolvedValue(dir) } as any;
+
+      const router = new RouterProvider([]);
+      router.handle("/a", provider);
+      router.attachNotifier(notifier);
+      const root = await router.lookup(1, "a");
+
+      const routeNotifier: KernelNotifier = provider.attachNotifier.mock.calls[0][0];
+      await routeNotifier.invalEntry(2, "name");
+      expect(notifier.invalEntry).toHaveBeenCalledWith(root!.ino, "name");
+    });
+
+    test("should detach the notifier from removed routes", () => {
+      const provider = { attachNotifier: jest.fn() } as any;
+
+      const router = new RouterProvider([]);
+      router.handle("/a", provider);
+      router.attachNotifier(notifier);
+      router.unhandle("/a");
+
+      expect(provider.attachNotifier).toHaveBeenLastCalledWith(null);
+    });
+  });
 });
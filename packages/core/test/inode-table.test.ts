@@ -0,0 +1,52 @@
+/**
+ * Inode Table Tests
+ */
+
+import { InodeTable } from "../src/inode-table";
+
+describe("InodeTable", () => {
+  test("hands out the same ino for the same backing inode", () => {
+    const table = new InodeTable<number>(1);
+    const a = table.acquire(42, 42);
+    expect(table.acquire(42, 42)).toBe(a);
+    expect(table.acquire(43, 43)).not.toBe(a);
+    expect(table.get(a)).toBe(42);
+    expect(table.get(1)).toBe(1);
+  });
+
+  test("releases an entry once forget drops every lookup", () => {
+    const table = new InodeTable<number>(1);
+    const ino = table.acquire(42, 42);
+    table.acquire(42, 42);
+    expect(table.forget(ino, 1)).toBeUndefined();
+    expect(table.get(ino)).toBe(42);
+    expect(table.forget(ino, 1)).toBe(42);
+    expect(table.get(ino)).toBeUndefined();
+    expect(table.peek(42)).toBeUndefined();
+    expect(table.size).toBe(1);
+  });
+
+  test("never releases the root", () => {
+    const table = new InodeTable<number>(1);
+    expect(table.forget(1, 100)).toBeUndefined();
+    expect(table.get(1)).toBe(1);
+    expect(table.acquire(1, 1)).toBe(1);
+  });
+
+  test("only readdirplus entries take lookup references", () => {
+    const table = new InodeTable<number>(1);
+    const plain = table.entry("a", 42, 42, false);
+    expect(table.entry("a", 42, 42, true)).toBe(plain);
+    expect(table.entry("..", 7, 7, true)).toBe(table.entry("..", 7, 7, false));
+    expect(table.forget(plain, 1)).toBe(42);
+  });
+
+  test("bounds entries the kernel holds no reference to", () => {
+    const table = new InodeTable<number>(1);
+    const held = table.acquire(1_000_000, 0);
+    for (let i = 0; i < 10_000; i++) table.assign(i + 2, i);
+    expect(table.size).toBeLessThanOrEqual(4096 + 2);
+    expect(table.get(held)).toBe(0);
+    expect(table.peek(10_001)).toBeDefined();
+  });
+});
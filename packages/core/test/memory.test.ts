@@ -122,10 +122,12 @@ describe("MemoryProvider", () => {
       expect(offset1.length).toBe(all.length - 1);
     });
 
-    test("readdirplus delegates to readdir", async () => {
-      await provider.create(1, "x.txt", 0o100644, 0);
+    test("readdirplus lists entries with their attributes", async () => {
+      const { stat } = await provider.create(1, "x.txt", 0o100644, 0);
       const entries = await provider.readdirplus(1, 0, 4096, 0);
-      expect(entries.map((e) => e.name)).toContain("x.txt");
+      const entry = entries.find((e) => e.name === "x.txt");
+      expect(entry?.stat).toEqual(stat);
+      expect((await provider.readdir(1, 0, 4096, 0)).find((e) => e.name === "x.txt")?.stat).toBeUndefined();
     });
 
     test("rmdir removes empty directory", async () => {
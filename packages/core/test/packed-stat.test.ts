@@ -0,0 +1,49 @@
+/**
+ * Packed Stat Tests
+ */
+
+import { STAT_FIELDS, StatField, createPackedStat, isPackedStat, packStat, statIno, unpackStat } from "../src/packed-stat";
+import { FileStat } from "../src/types";
+
+const stat: FileStat = {
+  mode: 0o100644,
+  size: 5 * 1024 * 1024 * 1024,
+  mtime: 1700000000.25,
+  ctime: 1700000000,
+  atime: -1.5,
+  uid: 1000,
+  gid: 1000,
+  dev: 0,
+  ino: 42,
+  nlink: 1,
+  rdev: 0,
+  blksize: 4096,
+  blocks: 10485760,
+};
+
+describe("packStat", () => {
+  test("round-trips a FileStat", () => {
+    expect(unpackStat(packStat(stat))).toEqual(stat);
+  });
+
+  test("stores times as nanoseconds", () => {
+    const packed = packStat(stat);
+    expect(packed[StatField.MTIME_NS]).toBe(1700000000250000000n);
+    expect(BigInt.asIntN(64, packed[StatField.ATIME_NS])).toBe(-1500000000n);
+  });
+
+  test("fills a caller-provided buffer", () => {
+    const out = createPackedStat();
+    expect(packStat(stat, out)).toBe(out);
+    expect(out).toHaveLength(STAT_FIELDS);
+  });
+});
+
+describe("statIno", () => {
+  test("reads either representation", () => {
+    expect(statIno(stat)).toBe(42);
+    expect(statIno(packStat(stat))).toBe(42);
+    expect(isPackedStat(stat)).toBe(false);
+    expect(isPackedStat(new BigUint64Array(2))).toBe(false);
+  });
+});
@@ -0,0 +1,62 @@
+/**
+ * Replay Tests
+ */
+
+import { Opcode } from "../src/opcodes";
+import { FilesystemProvider } from "../src/provider";
+import { replayTrace } from "../src/replay";
+import { TraceRecord } from "../src/trace";
+import { FileStat } from "../src/types";
+
+const delay = (ms: number) => new Promise((resolve) => setTimeout(resolve, ms));
+
+function record(opcode: Opcode, args: number[], extras: unknown[], start: number, duration: number, reply: { ino?: number; fh?: number } = {}): TraceRecord {
+  return { opcode, args, extras, start, duration, errno: 0, size: 0, ino: reply.ino ?? 0, fh: reply.fh ?? 0 };
+}
+
+describe("replayTrace", () => {
+  test("maps inodes and handles from earlier replies before issuing dependent requests", async () => {
+    const provider: FilesystemProvider = {
+      lookup: jest.fn(async () => {
+        await delay(10);
+        return { mode: 0o100644, size: 5, ino: 1042 } as FileStat;
+      }),
+      open: jest.fn(async () => {
+        await delay(10);
+        return 9;
+      }),
+      read: jest.fn().mockResolvedValue(0),
+      release: jest.fn().mockResolvedValue(undefined),
+    } as any;
+
+    const result = await replayTrace(provider, [
+      record(Opcode.LOOKUP, [1], ["a.txt"], 0, 10, { ino: 42 }),
+      record(Opcode.OPEN, [42, 0], [], 20, 10, { fh: 7 }),
+      record(Opcode.READ, [42, 7, 4096, 0], [], 40, 5),
+      record(Opcode.RELEASE, [42, 7], [], 50, 5),
+    ]);
+
+    expect(result).toMatchObject({ requests: 4, errors: 0, mismatches: 0 });
+    expect(provider.open).toHaveBeenCalledWith(1042, 0);
+    expect(provider.read).toHaveBeenCalledWith(1042, 9, expect.any(Buffer), 0, 4096);
+    expect(provider.release).toHaveBeenCalledWith(1042, 9);
+  });
+
+  test("still overlaps requests that overlapped when recorded", async () => {
+    let inFlight = 0;
+    let most = 0;
+    const provider: FilesystemProvider = {
+      getattr: jest.fn(async () => {
+        most = Math.max(most, ++inFlight);
+        await delay(5);
+        inFlight--;
+        return { mode: 0o40755, ino: 1 } as FileStat;
+      }),
+    } as any;
+
+    const result = await replayTrace(provider, [record(Opcode.GETATTR, [1, 0], [], 0, 10), record(Opcode.GETATTR, [1, 0], [], 1, 10), record(Opcode.GETATTR, [1, 0], [], 2, 10)]);
+
+    expect(result.requests).toBe(3);
+    expect(most).toBe(3);
+  });
+});
@@ -0,0 +1,121 @@
+/**
+ * Trace Tests
+ */
+
+import { mkdtempSync, readFileSync, rmSync, writeFileSync } from "fs";
+import { tmpdir } from "os";
+import { join } from "path";
+import { DESC_STRIDE } from "../src/batch";
+import { Opcode } from "../src/opcodes";
+import { TraceWriter, interceptReplies, readTrace, replyOutcome } from "../src/trace";
+import { FileStat } from "../src/types";
+
+const stat = (ino: number): FileStat => ({
+  mode: 0o100644,
+  size: 5,
+  mtime: 0,
+  ctime: 0,
+  atime: 0,
+  uid: 0,
+  gid: 0,
+  dev: 0,
+  ino,
+  nlink: 1,
+  rdev: 0,
+  blksize: 4096,
+  blocks: 1,
+});
+
+function request(writer: TraceWriter, reqPtr: number, op: Opcode, args: number[], extras: unknown[] = []): void {
+  const desc = new Float64Array(DESC_STRIDE);
+  desc.set([reqPtr, op, 0, ...args]);
+  writer.request(desc, 0, extras, extras.length);
+}
+
+describe("replyOutcome", () => {
+  test("extracts errnos, sizes, inodes and handles", () => {
+    expect(replyOutcome("reply_err", [1, 13])).toEqual({ errno: 13, size: 0, ino: 0, fh: 0 });
+    expect(replyOutcome("reply_negative_entry", [1])).toMatchObject({ errno: 2 });
+    expect(replyOutcome("reply_lookup", [1, stat(42)])).toMatchObject({ ino: 42 });
+    expect(replyOutcome("reply_create", [1, stat(43), 9])).toMatchObject({ ino: 43, fh: 9 });
+    expect(replyOutcome("reply_read", [1, Buffer.alloc(100)])).toMatchObject({ size: 100 });
+    expect(replyOutcome("reply_unlink", [1, -39])).toMatchObject({ errno: 39 });
+    expect(replyOutcome("reply_lseek", [1, 4096])).toEqual({ errno: 0, size: 0, ino: 0, fh: 0 });
+  });
+});
+
+describe("TraceWriter", () => {
+  let dir: string;
+
+  beforeEach(() => {
+    dir = mkdtempSync(join(tmpdir(), "mount0-trace-"));
+  });
+
+  afterEach(() => {
+    rmSync(dir, { recursive: true, force: true });
+  });
+
+  test("round-trips requests and their replies", async () => {
+    const path = join(dir, "t.trace");
+    const writer = new TraceWriter(path);
+    const native = interceptReplies({}, (reqPtr, outcome) => writer.reply(reqPtr, outcome)) as Record<string, (...args: unknown[]) => void>;
+
+    request(writer, 1, Opcode.LOOKUP, [1], ["a.txt"]);
+    request(writer, 2, Opcode.SETATTR, [42, 8, 0], [{ size: 0 }]);
+    request(writer, 3, Opcode.FORGET_MULTI, [1], [new Float64Array([42]), new Float64Array([2])]);
+    native.reply_lookup(1, stat(42));
+    native.reply_err(2, 1);
+    native.reply_none(3);
+    await writer.close();
+
+    const records = await readTrace(path);
+    expect(records).toHaveLength(3);
+    expect(records[0]).toMatchObject({ opcode: Opcode.LOOKUP, args: [1], extras: ["a.txt"], errno: 0, ino: 42 });
+    expect(records[1]).toMatchObject({ opcode: Opcode.SETATTR, args: [42, 8], extras: [{ size: 0 }], errno: 1 });
+    expect(records[2].extras).toEqual([new Float64Array([42]), new Float64Array([2])]);
+    expect(records[0].duration).toBeGreaterThanOrEqual(0);
+  });
+
+  test("keeps only the length of write payloads unless asked", async () => {
+    for (const recordData of [false, true]) {
+      const path = join(dir, `w${recordData}.trace`);
+      const writer = new TraceWriter(path, { recordData });
+      request(writer, 1, Opcode.WRITE, [42, 7, 3, 0], [Buffer.from("abc")]);
+      writer.reply(1, replyOutcome("reply_write", [1, 3]));
+      await writer.close();
+
+      const [record] = await readTrace(path);
+      expect(record.size).toBe(3);
+      expect(record.extras[0]).toEqual(recordData ? Buffer.from("abc") : Buffer.alloc(3));
+    }
+  });
+
+  test("drops a record cut short anywhere in its arguments", async () => {
+    const write = async (path: string, records: number) => {
+      const writer = new TraceWriter(path);
+      request(writer, 1, Opcode.GETATTR, [1, 0]);
+      writer.reply(1, replyOutcome("reply_getattr", [1, stat(1)]));
+      if (records > 1) {
+        request(writer, 2, Opcode.LOOKUP, [1], ["a.txt"]);
+        writer.reply(2, replyOutcome("reply_err", [2, 2]));
+      }
+      await writer.close();
+      return readFileSync(path);
+    };
+    const first = await write(join(dir, "one.trace"), 1);
+    const path = join(dir, "two.trace");
+    const full = await write(path, 2);
+    expect(await readTrace(path)).toHaveLength(2);
+
+    for (let cut = first.length + 1; cut < full.length; cut++) {
+      writeFileSync(path, full.subarray(0, cut));
+      expect(await readTrace(path)).toHaveLength(1);
+    }
+  });
+
+  test("rejects files that are not traces", async () => {
+    const path = join(dir, "not.trace");
+    writeFileSync(path, "hello world, this is not a trace");
+    await expect(readTrace(path)).rejects.toThrow("not a mount0 trace");
+  });
+});
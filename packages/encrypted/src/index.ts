@@ -1,4 +1,4 @@
-import { DirEntry, FileStat, FilesystemProvider, Flock, Statfs } from "@mount0/core";
+import { DirEntry, FileStat, FilesystemProvider, Flock, InodeTable, ProviderCapabilities, Statfs } from "@mount0/core";
 import { createCipheriv, createDecipheriv, randomBytes, scrypt } from "crypto";
 import { promisify } from "util";
 
@@ -18,9 +18,7 @@ export class EncryptedProvider implements FilesystemProvider {
   private keyLength: number;
   private key: Buffer | null = null;
   private salt: Buffer | null = null;
-  private inoToProviderIno: Map<number, number> = new Map();
-  private providerInoToIno: Map<number, number> = new Map();
-  private nextIno: number = 2;
+  private inodes = new InodeTable<number>(1);
 
   constructor(config: EncryptedProviderConfig) {
     this.provider = config.provider;
@@ -72,20 +70,18 @@ export class EncryptedProvider implements FilesystemProvider {
   }
 
   private getProviderIno(ino: number): number {
-    return this.inoToProviderIno.get(ino) || ino;
+    return this.inodes.get(ino) ?? ino;
   }
 
-  private setInoMapping(ino: number, providerIno: number): void {
-    this.inoToProviderIno.set(ino, providerIno);
-    this.providerInoToIno.set(providerIno, ino);
+  capabilities(): ProviderCapabilities | undefined {
+    return this.provider.capabilities?.();
   }
 
   async lookup(parent: number, name: string): Promise<FileStat | null> {
     const providerParent = this.getProviderIno(parent);
     const stat = await this.provider.lookup(providerParent, name);
     if (stat) {
-      const ino = this.nextIno++;
-      this.setInoMapping(ino, stat.ino);
+      const ino = this.inodes.acquire(stat.ino, stat.ino);
       return { ...stat, ino };
     }
     return null;
@@ -98,25 +94,21 @@ export class EncryptedProvider implements FilesystemProvider {
     const providerIno = this.getProviderIno(ino);
     const stat = await this.provider.getattr(providerIno, fh);
     if (stat) {
-      this.setInoMapping(ino, stat.ino);
       return { ...stat, ino };
     }
     return null;
   }
 
-  async setattr(ino: number, fh: number, to_set: number, attr: FileStat): Promise<void> {
+  async setattr(ino: number, fh: number, to_set: number, attr: FileStat): Promise<FileStat | null> {
     const providerIno = this.getProviderIno(ino);
-    return this.provider.setattr(providerIno, fh, to_set, attr);
+    const stat = await this.provider.setattr(providerIno, fh, to_set, attr);
+    return stat ? { ...stat, ino } : null;
   }
 
   async readdir(ino: number, fh: number, size: number, off: number): Promise<DirEntry[]> {
     const providerIno = this.getProviderIno(ino);
     const entries = await this.provider.readdir(providerIno, fh, size, off);
-    return entries.map((entry) => {
-      const ino = this.nextIno++;
-      this.setInoMapping(ino, entry.ino);
-      return { ...entry, ino };
-    });
+    return entries.map((entry) => ({ ...entry, ino: this.inodes.entry(entry.name, entry.ino, entry.ino, false) }));
   }
 
   async opendir(ino: number, flags: number): Promise<number> {
@@ -181,51 +173,48 @@ export class EncryptedProvider implements FilesystemProvider {
   async create(parent: number, name: string, mode: number, flags: number): Promise<{ stat: FileStat; fh: number }> {
     const providerParent = this.getProviderIno(parent);
     const result = await this.provider.create(providerParent, name, mode, flags);
-    const ino = this.nextIno++;
-    this.setInoMapping(ino, result.stat.ino);
+    const ino = this.inodes.acquire(result.stat.ino, result.stat.ino);
     return { stat: { ...result.stat, ino }, fh: result.fh };
   }
 
   async mknod(parent: number, name: string, mode: number, rdev: number): Promise<FileStat> {
     const providerParent = this.getProviderIno(parent);
     const stat = await this.provider.mknod(providerParent, name, mode, rdev);
-    const ino = this.nextIno++;
-    this.setInoMapping(ino, stat.ino);
+    const ino = this.inodes.acquire(stat.ino, stat.ino);
     return { ...stat, ino };
   }
 
   async mkdir(parent: number, name: string, mode: number): Promise<FileStat> {
     const providerParent = this.getProviderIno(parent);
     const stat = await this.provider.mkdir(providerParent, name, mode);
-    const ino = this.nextIno++;
-    this.setInoMapping(ino, stat.ino);
+    const ino = this.inodes.acquire(stat.ino, stat.ino);
     return { ...stat, ino };
   }
 
-  async unlink(parent: number, name: string): Promise<void> {
+  async unlink(parent: number, name: string): Promise<number | undefined> {
     const providerParent = this.getProviderIno(parent);
-    return this.provider.unlink(providerParent, name);
+    const removed = await this.provider.unlink(providerParent, name);
+    return removed ? this.inodes.peek(removed) : undefined;
   }
 
-  async rmdir(parent: number, name: string): Promise<void> {
+  async rmdir(parent: number, name: string): Promise<number | undefined> {
     const providerParent = this.getProviderIno(parent);
-    return this.provider.rmdir(providerParent, name);
+    const removed = await this.provider.rmdir(providerParent, name);
+    return removed ? this.inodes.peek(removed) : undefined;
   }
 
   async link(ino: number, newparent: number, newname: string): Promise<FileStat> {
     const providerIno = this.getProviderIno(ino);
     const providerNewParent = this.getProviderIno(newparent);
     const stat = await this.provider.link(providerIno, providerNewParent, newname);
-    const newIno = this.nextIno++;
-    this.setInoMapping(newIno, stat.ino);
+    const newIno = this.inodes.acquire(stat.ino, stat.ino);
     return { ...stat, ino: newIno };
   }
 
   async symlink(link: string, parent: number, name: string): Promise<FileStat> {
     const providerParent = this.getProviderIno(parent);
     const stat = await this.provider.symlink(link, providerParent, name);
-    const ino = this.nextIno++;
-    this.setInoMapping(ino, stat.ino);
+    const ino = this.inodes.acquire(stat.ino, stat.ino);
     return { ...stat, ino };
   }
 
@@ -308,10 +297,10 @@ export class EncryptedProvider implements FilesystemProvider {
   async readdirplus(ino: number, fh: number, size: number, offset: number): Promise<DirEntry[]> {
     const providerIno = this.getProviderIno(ino);
     const entries = await this.provider.readdirplus(providerIno, fh, size, offset);
+    // Entries without attributes reach the kernel without a node, so only those with a stat take a lookup reference
     return entries.map((entry) => {
-      const ino = this.nextIno++;
-      this.setInoMapping(ino, entry.ino);
-      return { ...entry, ino };
+      const ino = this.inodes.entry(entry.name, entry.ino, entry.ino, !!entry.stat);
+      return entry.stat ? { ...entry, ino, stat: { ...entry.stat, ino } } : { ...entry, ino };
     });
   }
 
@@ -329,8 +318,20 @@ export class EncryptedProvider implements FilesystemProvider {
   async tmpfile(parent: number, mode: number, flags: number): Promise<{ stat: FileStat; fh: number }> {
     const providerParent = this.getProviderIno(parent);
     const result = await this.provider.tmpfile(providerParent, mode, flags);
-    const ino = this.nextIno++;
-    this.setInoMapping(ino, result.stat.ino);
+    const ino = this.inodes.acquire(result.stat.ino, result.stat.ino);
     return { stat: { ...result.stat, ino }, fh: result.fh };
   }
+
+  async forget(ino: number, nlookup: number): Promise<void> {
+    const providerIno = this.inodes.get(ino);
+    if (providerIno === undefined) return;
+    this.inodes.forget(ino, nlookup);
+    await this.provider.forget?.(providerIno, nlookup);
+  }
+
+  async forget_multi(forgets: Array<{ ino: number; nlookup: number }>): Promise<void> {
+    for (const forget of forgets) {
+      await this.forget(forget.ino, forget.nlookup);
+    }
+  }
 }
@@ -1,14 +1,36 @@
-import { DirEntry, FileStat, FilesystemProvider, Flock, Statfs } from "@mount0/core";
-import { Dirent } from "fs";
+import { DirectoryCursors, DirEntry, FileStat, FilesystemProvider, Flock, ProviderCapabilities, Statfs } from "@mount0/core";
+import { Dirent, Stats } from "fs";
 import * as fs from "fs/promises";
 import * as path from "path";
 
+// Largest buffer copy_file_range holds at once
+const COPY_CHUNK = 1024 * 1024;
+
+function toFileStat(stats: Stats): FileStat {
+  return {
+    mode: stats.mode,
+    size: stats.size,
+    mtime: Math.floor(stats.mtimeMs / 1000),
+    ctime: Math.floor(stats.ctimeMs / 1000),
+    atime: Math.floor(stats.atimeMs / 1000),
+    uid: stats.uid,
+    gid: stats.gid,
+    dev: stats.dev,
+    ino: stats.ino,
+    nlink: stats.nlink,
+    rdev: stats.rdev,
+    blksize: stats.blksize,
+    blocks: stats.blocks,
+  };
+}
+
 export class LocalProvider implements FilesystemProvider {
   private root: string;
   private inoToPath: Map<number, string> = new Map();
   private pathToIno: Map<string, number> = new Map();
   private openFiles: Map<number, Map<number, fs.FileHandle>> = new Map(); // ino -> fh -> handle
   private nextFh: number = 1;
+  private dirCursors = new DirectoryCursors();
 
   constructor(root: string) {
     this.root = path.resolve(root);
@@ -38,27 +60,18 @@ export class LocalProvider implements FilesystemProvider {
     return parentPath === "/" ? `/${name}` : `${parentPath}/${name}`;
   }
 
+  // xattrs, locks, lseek, bmap, fallocate modes and tmpfile are only stubs here
+  capabilities(): ProviderCapabilities {
+    return { readdirplus: true, copyFileRange: true, access: true };
+  }
+
   async lookup(parent: number, name: string): Promise<FileStat | null> {
     const filePath = this.pathFromParent(parent, name);
     const fullPath = this.resolvePath(filePath);
     try {
       const stats = await fs.stat(fullPath);
       this.setPath(stats.ino, filePath);
-      return {
-        mode: stats.mode,
-        size: stats.size,
-        mtime: Math.floor(stats.mtimeMs / 1000),
-        ctime: Math.floor(stats.ctimeMs / 1000),
-        atime: Math.floor(stats.atimeMs / 1000),
-        uid: stats.uid,
-        gid: stats.gid,
-        dev: stats.dev,
-        ino: stats.ino,
-        nlink: stats.nlink,
-        rdev: stats.rdev,
-        blksize: stats.blksize,
-        blocks: stats.blocks,
-      };
+      return toFileStat(stats);
       // eslint-disable-next-line @typescript-eslint/no-explicit-any
     } catch (err: any) {
       if (err.code === "ENOENT") {
@@ -74,21 +87,7 @@ export class LocalProvider implements FilesystemProvider {
     try {
       const stats = await fs.stat(fullPath);
       this.setPath(stats.ino, filePath);
-      return {
-        mode: stats.mode,
-        size: stats.size,
-        mtime: Math.floor(stats.mtimeMs / 1000),
-        ctime: Math.floor(stats.ctimeMs / 1000),
-        atime: Math.floor(stats.atimeMs / 1000),
-        uid: stats.uid,
-        gid: stats.gid,
-        dev: stats.dev,
-        ino: stats.ino,
-        nlink: stats.nlink,
-        rdev: stats.rdev,
-        blksize: stats.blksize,
-        blocks: stats.blocks,
-      };
+      return toFileStat(stats);
       // eslint-disable-next-line @typescript-eslint/no-explicit-any
     } catch (err: any) {
       if (err.code === "ENOENT") {
@@ -98,25 +97,32 @@ export class LocalProvider implements FilesystemProvider {
     }
   }
 
-  async readdir(ino: number, _fh: number, size: number, offset: number): Promise<DirEntry[]> {
+  async readdir(ino: number, fh: number, size: number, offset: number): Promise<DirEntry[]> {
+    return this.dirCursors.read(fh, offset, size, () => this.listDir(ino));
+  }
+
+  // Every entry is stat'ed for its mode anyway, so readdirplus hands the kernel the
+  // full attributes and spares it a lookup per entry
+  private async listDir(ino: number, plus = false): Promise<DirEntry[]> {
     const filePath = this.getPath(ino);
     const fullPath = this.resolvePath(filePath);
     const entries = await fs.readdir(fullPath, { withFileTypes: true });
 
-    const result = await Promise.all(
+    return Promise.all(
       entries.map(async (entry: Dirent) => {
         const entryPath = filePath === "/" ? `/${entry.name}` : `${filePath}/${entry.name}`;
         const entryFullPath = this.resolvePath(entryPath);
         const stats = await fs.stat(entryFullPath);
         this.setPath(stats.ino, entryPath);
-        return {
+        const dirent: DirEntry = {
           name: entry.name,
           mode: stats.mode,
           ino: stats.ino,
         };
+        if (plus) dirent.stat = toFileStat(stats);
+        return dirent;
       })
     );
-    return result.slice(offset);
   }
 
   async open(ino: number, flags: number, mode?: number): Promise<number> {
@@ -131,6 +137,10 @@ export class LocalProvider implements FilesystemProvider {
     return fh;
   }
 
+  backingFd(ino: number, fh: number): number | undefined {
+    return this.openFiles.get(ino)?.get(fh)?.fd;
+  }
+
   async read(ino: number, fh: number, buffer: Buffer, offset: number, length: number): Promise<number> {
     const handles = this.openFiles.get(ino);
     if (!handles) throw new Error("File not open");
@@ -170,26 +180,12 @@ export class LocalProvider implements FilesystemProvider {
     }
     this.openFiles.get(stats.ino)!.set(fh, fileHandle);
     return {
-      stat: {
-        mode: stats.mode,
-        size: stats.size,
-        mtime: Math.floor(stats.mtimeMs / 1000),
-        ctime: Math.floor(stats.ctimeMs / 1000),
-        atime: Math.floor(stats.atimeMs / 1000),
-        uid: stats.uid,
-        gid: stats.gid,
-        dev: stats.dev,
-        ino: stats.ino,
-        nlink: stats.nlink,
-        rdev: stats.rdev,
-        blksize: stats.blksize,
-        blocks: stats.blocks,
-      },
+      stat: toFileStat(stats),
       fh,
     };
   }
 
-  async unlink(parent: number, name: string): Promise<void> {
+  async unlink(parent: number, name: string): Promise<number | undefined> {
     const filePath = this.pathFromParent(parent, name);
     const fullPath = this.resolvePath(filePath);
     await fs.unlink(fullPath);
@@ -198,6 +194,7 @@ export class LocalProvider implements FilesystemProvider {
       this.inoToPath.delete(ino);
       this.pathToIno.delete(filePath);
     }
+    return ino;
   }
 
   async mkdir(parent: number, name: string, mode: number): Promise<FileStat> {
@@ -206,24 +203,10 @@ export class LocalProvider implements FilesystemProvider {
     await fs.mkdir(fullPath, mode);
     const stats = await fs.stat(fullPath);
     this.setPath(stats.ino, filePath);
-    return {
-      mode: stats.mode,
-      size: stats.size,
-      mtime: Math.floor(stats.mtimeMs / 1000),
-      ctime: Math.floor(stats.ctimeMs / 1000),
-      atime: Math.floor(stats.atimeMs / 1000),
-      uid: stats.uid,
-      gid: stats.gid,
-      dev: stats.dev,
-      ino: stats.ino,
-      nlink: stats.nlink,
-      rdev: stats.rdev,
-      blksize: stats.blksize,
-      blocks: stats.blocks,
-    };
+    return toFileStat(stats);
   }
 
-  async rmdir(parent: number, name: string): Promise<void> {
+  async rmdir(parent: number, name: string): Promise<number | undefined> {
     const filePath = this.pathFromParent(parent, name);
     const fullPath = this.resolvePath(filePath);
     await fs.rmdir(fullPath);
@@ -232,6 +215,7 @@ export class LocalProvider implements FilesystemProvider {
       this.inoToPath.delete(ino);
       this.pathToIno.delete(filePath);
     }
+    return ino;
   }
 
   async rename(parent: number, name: string, newparent: number, newname: string, _flags: number): Promise<void> {
@@ -279,6 +263,7 @@ export class LocalProvider implements FilesystemProvider {
   }
 
   async releasedir(ino: number, fh: number): Promise<void> {
+    this.dirCursors.release(fh);
     return this.release(ino, fh);
   }
 
@@ -318,21 +303,7 @@ export class LocalProvider implements FilesystemProvider {
     }
     const stats = await fs.stat(fullPath);
     this.setPath(stats.ino, filePath);
-    return {
-      mode: stats.mode,
-      size: stats.size,
-      mtime: Math.floor(stats.mtimeMs / 1000),
-      ctime: Math.floor(stats.ctimeMs / 1000),
-      atime: Math.floor(stats.atimeMs / 1000),
-      uid: stats.uid,
-      gid: stats.gid,
-      dev: stats.dev,
-      ino: stats.ino,
-      nlink: stats.nlink,
-      rdev: stats.rdev,
-      blksize: stats.blksize,
-      blocks: stats.blocks,
-    };
+    return toFileStat(stats);
   }
 
   // Link operations
@@ -344,21 +315,7 @@ export class LocalProvider implements FilesystemProvider {
     await fs.link(oldFull, newFull);
     const stats = await fs.stat(newFull);
     this.setPath(stats.ino, newPath);
-    return {
-      mode: stats.mode,
-      size: stats.size,
-      mtime: Math.floor(stats.mtimeMs / 1000),
-      ctime: Math.floor(stats.ctimeMs / 1000),
-      atime: Math.floor(stats.atimeMs / 1000),
-      uid: stats.uid,
-      gid: stats.gid,
-      dev: stats.dev,
-      ino: stats.ino,
-      nlink: stats.nlink,
-      rdev: stats.rdev,
-      blksize: stats.blksize,
-      blocks: stats.blocks,
-    };
+    return toFileStat(stats);
   }
 
   async symlink(link: string, parent: number, name: string): Promise<FileStat> {
@@ -367,21 +324,7 @@ export class LocalProvider implements FilesystemProvider {
     await fs.symlink(link, fullPath);
     const stats = await fs.lstat(fullPath);
     this.setPath(stats.ino, filePath);
-    return {
-      mode: stats.mode,
-      size: stats.size,
-      mtime: Math.floor(stats.mtimeMs / 1000),
-      ctime: Math.floor(stats.ctimeMs / 1000),
-      atime: Math.floor(stats.atimeMs / 1000),
-      uid: stats.uid,
-      gid: stats.gid,
-      dev: stats.dev,
-      ino: stats.ino,
-      nlink: stats.nlink,
-      rdev: stats.rdev,
-      blksize: stats.blksize,
-      blocks: stats.blocks,
-    };
+    return toFileStat(stats);
   }
 
   async readlink(ino: number): Promise<string> {
@@ -490,31 +433,31 @@ export class LocalProvider implements FilesystemProvider {
   }
 
   async readdirplus(ino: number, fh: number, size: number, off: number): Promise<DirEntry[]> {
-    // Same as readdir for now
-    return this.readdir(ino, fh, size, off);
-  }
-
-  async copy_file_range(ino_in: number, _fh_in: number, off_in: number, ino_out: number, _fh_out: number, off_out: number, len: number, _flags: number): Promise<number> {
-    const inPath = this.getPath(ino_in);
-    const outPath = this.getPath(ino_out);
-    const inFull = this.resolvePath(inPath);
-    const outFull = this.resolvePath(outPath);
-
-    const inHandle = await fs.open(inFull, "r");
-    const outHandle = await fs.open(outFull, "r+");
-    try {
-      const buf = Buffer.alloc(len);
-      const { bytesRead } = await inHandle.read(buf, 0, len, off_in);
-      if (bytesRead > 0) {
-        await outHandle.write(buf, 0, bytesRead, off_out);
+    return this.dirCursors.read(fh, off, size, () => this.listDir(ino, true), true);
+  }
+
+  // Copies between the open handles a bounded chunk at a time, so a large range doesn't need a buffer its size
+  async copy_file_range(ino_in: number, fh_in: number, off_in: number, ino_out: number, fh_out: number, off_out: number, len: number, _flags: number): Promise<number> {
+    const inHandle = this.openFiles.get(ino_in)?.get(fh_in);
+    const outHandle = this.openFiles.get(ino_out)?.get(fh_out);
+    if (!inHandle || !outHandle) throw { code: "EBADF", errno: -9 };
+
+    const buf = Buffer.allocUnsafe(Math.min(len, COPY_CHUNK));
+    let copied = 0;
+    while (copied < len) {
+      const { bytesRead } = await inHandle.read(buf, 0, Math.min(buf.length, len - copied), off_in + copied);
+      if (bytesRead === 0) break;
+      let written = 0;
+      while (written < bytesRead) {
+        const { bytesWritten } = await outHandle.write(buf, written, bytesRead - written, off_out + copied + written);
+        written += bytesWritten;
       }
-      return bytesRead;
-    } finally {
-      await inHandle.close();
-      await outHandle.close();
+      copied += bytesRead;
     }
+    return copied;
   }
 
+
   async lseek(ino: number, fh: number, _off: number, _whence: number): Promise<number> {
     const handles = this.openFiles.get(ino);
     if (!handles) throw new Error("File not open");
@@ -1,8 +1,10 @@
-import { DirEntry, FileStat, FilesystemProvider, Flock, Statfs } from "@mount0/core";
+import { DirectoryCursors, DirEntry, FileStat, FilesystemProvider, Flock, ProviderCapabilities, Statfs } from "@mount0/core";
 
 interface MemoryNode {
   stat: FileStat;
   content?: Buffer;
+  // Backing store for content, grown geometrically by growContent()
+  backing?: Buffer;
   children?: Map<string, MemoryNode>;
 }
 
@@ -14,6 +16,7 @@ export class MemoryProvider implements FilesystemProvider {
   private openFiles: Map<number, Map<number, MemoryNode>> = new Map(); // ino -> fh -> node
   private nextFh: number = 1;
   private inoCounter: number;
+  private dirCursors = new DirectoryCursors();
 
   constructor() {
     this.inoCounter = 1;
@@ -44,6 +47,25 @@ export class MemoryProvider implements FilesystemProvider {
     return this.inoToNode.get(ino) || null;
   }
 
+  // Extends node.content to at least size bytes. The backing store doubles when it
+  // runs out so sequential writes don't copy the whole file on every request.
+  private growContent(node: MemoryNode, size: number): Buffer {
+    const content = node.content ?? Buffer.alloc(0);
+    if (size <= content.length) return content;
+
+    let backing = node.backing?.buffer === content.buffer && node.backing.byteOffset === content.byteOffset ? node.backing : content;
+    if (size > backing.length) {
+      const grown = Buffer.alloc(Math.max(size, backing.length * 2));
+      content.copy(grown);
+      backing = grown;
+    } else {
+      backing.fill(0, content.length, size);
+    }
+    node.backing = backing;
+    node.content = backing.subarray(0, size);
+    return node.content;
+  }
+
   private setNode(ino: number, node: MemoryNode, path: string): void {
     this.inoToNode.set(ino, node);
     this.inoToPath.set(ino, path);
@@ -55,6 +77,10 @@ export class MemoryProvider implements FilesystemProvider {
     return parentPath === "/" ? `/${name}` : `${parentPath}/${name}`;
   }
 
+  capabilities(): ProviderCapabilities {
+    return { readdirplus: true, copyFileRange: true, access: true };
+  }
+
   async lookup(parent: number, name: string): Promise<FileStat | null> {
     const parentNode = this.getNode(parent);
     if (!parentNode?.children) return null;
@@ -72,20 +98,25 @@ export class MemoryProvider implements FilesystemProvider {
     return node ? { ...node.stat } : null;
   }
 
-  async readdir(ino: number, _fh: number, size: number, offset: number): Promise<DirEntry[]> {
+  async readdir(ino: number, fh: number, size: number, offset: number): Promise<DirEntry[]> {
+    return this.dirCursors.read(fh, offset, size, () => this.listDir(ino));
+  }
+
+  private async listDir(ino: number, plus = false): Promise<DirEntry[]> {
     const node = this.getNode(ino);
     if (!node?.children) return [];
 
-    const entries = Array.from(node.children.entries()).map(([name, child]) => {
+    return Array.from(node.children.entries()).map(([name, child]) => {
       const path = this.pathFromParent(ino, name);
       this.setNode(child.stat.ino, child, path);
-      return {
+      const dirent: DirEntry = {
         name,
         mode: child.stat.mode,
         ino: child.stat.ino,
       };
+      if (plus) dirent.stat = { ...child.stat };
+      return dirent;
     });
-    return entries.slice(offset);
   }
 
   async open(ino: number, _flags: number, _mode?: number): Promise<number> {
@@ -122,14 +153,9 @@ export class MemoryProvider implements FilesystemProvider {
     const node = handles.get(fh);
     if (!node) throw new Error("File handle not found");
 
-    if (!node.content) node.content = Buffer.alloc(0);
-
-    const newSize = Math.max(node.content.length, offset + length);
-    const newContent = Buffer.alloc(newSize);
-    node.content.copy(newContent);
-    buffer.copy(newContent, offset, 0, length);
-    node.content = newContent;
-    node.stat.size = newSize;
+    const content = this.growContent(node, offset + length);
+    buffer.copy(content, offset, 0, length);
+    node.stat.size = content.length;
     node.stat.mtime = Math.floor(Date.now() / 1000);
 
     return length;
@@ -181,7 +207,7 @@ export class MemoryProvider implements FilesystemProvider {
     return { stat: { ...node.stat }, fh };
   }
 
-  async unlink(parent: number, name: string): Promise<void> {
+  async unlink(parent: number, name: string): Promise<number | undefined> {
     const parentNode = this.getNode(parent);
     if (!parentNode?.children) throw new Error("Directory not found");
     const node = parentNode.children.get(name);
@@ -195,6 +221,7 @@ export class MemoryProvider implements FilesystemProvider {
       }
     }
     parentNode.children.delete(name);
+    return node?.stat.ino;
   }
 
   async mkdir(parent: number, name: string, mode: number): Promise<FileStat> {
@@ -231,7 +258,7 @@ export class MemoryProvider implements FilesystemProvider {
     return { ...node.stat };
   }
 
-  async rmdir(parent: number, name: string): Promise<void> {
+  async rmdir(parent: number, name: string): Promise<number> {
     const parentNode = this.getNode(parent);
     if (!parentNode?.children) throw new Error("Directory not found");
     const node = parentNode.children.get(name);
@@ -246,6 +273,7 @@ export class MemoryProvider implements FilesystemProvider {
       this.pathToIno.delete(path);
     }
     parentNode.children.delete(name);
+    return ino;
   }
 
   async rename(parent: number, name: string, newparent: number, newname: string, _flags: number): Promise<void> {
@@ -270,7 +298,7 @@ export class MemoryProvider implements FilesystemProvider {
     this.pathToIno.set(newPath, ino);
   }
 
-  async setattr(ino: number, _fh: number, to_set: number, attr: FileStat): Promise<void> {
+  async setattr(ino: number, _fh: number, to_set: number, attr: FileStat): Promise<FileStat> {
     const node = this.getNode(ino);
     if (!node) throw new Error("File not found");
     const FUSE_SET_ATTR_SIZE = 8;
@@ -281,12 +309,10 @@ export class MemoryProvider implements FilesystemProvider {
     const FUSE_SET_ATTR_MTIME = 32;
     if (to_set & FUSE_SET_ATTR_SIZE) {
       const newSize = attr.size;
-      if (node.content) {
-        const newContent = Buffer.alloc(newSize);
-        node.content.copy(newContent, 0, 0, Math.min(node.content.length, newSize));
-        node.content = newContent;
+      if (node.content && newSize <= node.content.length) {
+        node.content = node.content.subarray(0, newSize);
       } else {
-        node.content = Buffer.alloc(newSize);
+        this.growContent(node, newSize);
       }
       node.stat.size = newSize;
     }
@@ -296,6 +322,7 @@ export class MemoryProvider implements FilesystemProvider {
     if (to_set & FUSE_SET_ATTR_ATIME) node.stat.atime = attr.atime;
     if (to_set & FUSE_SET_ATTR_MTIME) node.stat.mtime = attr.mtime;
     else node.stat.mtime = Math.floor(Date.now() / 1000);
+    return { ...node.stat };
   }
 
   async release(ino: number, fh: number): Promise<void> {
@@ -313,6 +340,7 @@ export class MemoryProvider implements FilesystemProvider {
   }
 
   async releasedir(ino: number, fh: number): Promise<void> {
+    this.dirCursors.release(fh);
     return this.release(ino, fh);
   }
 
@@ -431,16 +459,11 @@ export class MemoryProvider implements FilesystemProvider {
     const node = handles.get(fh);
     if (!node) throw new Error("File handle not found");
 
-    if (!node.content) node.content = Buffer.alloc(0);
-    const newSize = Math.max(node.content.length, offset + length);
-    const newContent = Buffer.alloc(newSize);
-    node.content.copy(newContent);
-    node.content = newContent;
-    node.stat.size = newSize;
+    node.stat.size = this.growContent(node, offset + length).length;
   }
 
   async readdirplus(ino: number, fh: number, size: number, off: number): Promise<DirEntry[]> {
-    return this.readdir(ino, fh, size, off);
+    return this.dirCursors.read(fh, off, size, () => this.listDir(ino, true), true);
   }
 
   async copy_file_range(ino_in: number, fh_in: number, off_in: number, ino_out: number, fh_out: number, off_out: number, len: number, _flags: number): Promise<number> {
@@ -448,16 +471,13 @@ export class MemoryProvider implements FilesystemProvider {
     const outNode = this.getNode(ino_out);
     if (!inNode?.content || !outNode) throw new Error("Invalid nodes");
 
-    if (!outNode.content) outNode.content = Buffer.alloc(0);
     const available = inNode.content.length - off_in;
     const toCopy = Math.min(len, available);
     if (toCopy > 0) {
-      const newSize = Math.max(outNode.content.length, off_out + toCopy);
-      const newContent = Buffer.alloc(newSize);
-      outNode.content.copy(newContent);
-      inNode.content.copy(newContent, off_out, off_in, off_in + toCopy);
-      outNode.content = newContent;
-      outNode.stat.size = newSize;
+      const source = inNode.content;
+      const content = this.growContent(outNode, off_out + toCopy);
+      source.copy(content, off_out, off_in, off_in + toCopy);
+      outNode.stat.size = content.length;
     }
     return toCopy;
   }
@@ -39,7 +39,7 @@ export class FirstProvider implements FilesystemProvider {
     return this.executeFirst((p) => p.getattr(ino, fh));
   }
 
-  async setattr(ino: number, fh: number, to_set: number, attr: FileStat): Promise<void> {
+  async setattr(ino: number, fh: number, to_set: number, attr: FileStat): Promise<FileStat | null | void> {
     return this.executeFirst((p) => p.setattr(ino, fh, to_set, attr));
   }
 
@@ -99,11 +99,11 @@ export class FirstProvider implements FilesystemProvider {
   }
 
   // Remove operations
-  async unlink(parent: number, name: string): Promise<void> {
+  async unlink(parent: number, name: string): Promise<number | void> {
     return this.executeFirst((p) => p.unlink(parent, name));
   }
 
-  async rmdir(parent: number, name: string): Promise<void> {
+  async rmdir(parent: number, name: string): Promise<number | void> {
     return this.executeFirst((p) => p.rmdir(parent, name));
   }
 
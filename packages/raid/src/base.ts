@@ -1,13 +1,22 @@
-import { DirEntry, FileStat, FilesystemProvider, Flock, Statfs } from "@mount0/core";
+import { DirEntry, DirectoryCursors, FileStat, FilesystemProvider, Flock, InodeTable, ProviderCapabilities, Statfs } from "@mount0/core";
+
+// Reply size asked of a member for each page of a directory listing
+const LIST_PAGE = 64 * 1024;
+
+// A RAID inode: each member's ino for the file, and how many lookups of it each member
+// has answered, which is all a forget may hand back to that member
+interface RaidInode {
+  inos: number[];
+  lookups: number[];
+}
 
 export abstract class BaseRaidProvider implements FilesystemProvider {
   protected providers: FilesystemProvider[];
   protected stripeSize: number;
-  protected inoToProviderInos: Map<number, number[]> = new Map(); // RAID ino -> provider inos
-  protected providerInoToRaidIno: Map<number, number> = new Map(); // provider ino -> RAID ino
+  protected inodes: InodeTable<RaidInode>;
   protected openFiles: Map<number, Map<number, number[]>> = new Map(); // RAID ino -> fh -> provider fhs
   protected nextFh: number = 1;
-  protected nextIno: number = 2; // Start at 2 (1 is root)
+  protected dirCursors = new DirectoryCursors();
 
   constructor(providers: FilesystemProvider[], stripeSize: number = 64 * 1024) {
     if (providers.length < 2) {
@@ -15,17 +24,42 @@ export abstract class BaseRaidProvider implements FilesystemProvider {
     }
     this.providers = providers;
     this.stripeSize = stripeSize;
+    this.inodes = new InodeTable<RaidInode>({ inos: providers.map(() => 1), lookups: [] });
   }
 
   protected getProviderInos(ino: number): number[] {
-    return this.inoToProviderInos.get(ino) || [];
+    return this.inodes.get(ino)?.inos || [];
+  }
+
+  // Members number their inodes independently, so a RAID inode is keyed by the first
+  // member holding the file together with that member's ino
+  private inodeKey(providerInos: number[]): number {
+    const i = providerInos.findIndex((ino) => ino !== undefined);
+    return providerInos[i] * this.providers.length + i;
   }
 
-  protected setProviderInos(ino: number, providerInos: number[]): void {
-    this.inoToProviderInos.set(ino, providerInos);
-    providerInos.forEach((pino) => {
-      this.providerInoToRaidIno.set(pino, ino);
+  // Members a lookup or listing didn't reach keep the ino already known for them. With
+  // lookups set, every member in providerInos answered one more lookup.
+  private merged(key: number, providerInos: number[], lookups: boolean): RaidInode {
+    const known = this.inodes.get(this.inodes.peek(key) ?? 0);
+    const merged: RaidInode = { inos: known?.inos.slice() ?? [], lookups: known?.lookups.slice() ?? [] };
+    providerInos.forEach((ino, i) => {
+      merged.inos[i] = ino;
+      if (lookups) merged.lookups[i] = (merged.lookups[i] ?? 0) + 1;
     });
+    return merged;
+  }
+
+  /** The RAID ino for a file the members just looked up (or created) */
+  protected acquireIno(providerInos: number[]): number {
+    const key = this.inodeKey(providerInos);
+    return this.inodes.acquire(key, this.merged(key, providerInos, true));
+  }
+
+  /** The RAID ino for a file the members only listed */
+  protected assignIno(providerInos: number[]): number {
+    const key = this.inodeKey(providerInos);
+    return this.inodes.assign(key, this.merged(key, providerInos, false));
   }
 
   protected getProviderFhs(ino: number, fh: number): number[] {
@@ -36,43 +70,33 @@ export abstract class BaseRaidProvider implements FilesystemProvider {
     return providerFhs;
   }
 
-  async lookup(parent: number, name: string): Promise<FileStat | null> {
-    if (parent === 1) {
-      // Root directory - try to find in any provider
-      for (const provider of this.providers) {
-        try {
-          const stat = await provider.lookup(1, name);
-          if (stat) {
-            const raidIno = this.nextIno++;
-            this.setProviderInos(raidIno, [stat.ino]);
-            return { ...stat, ino: raidIno };
-          }
-        } catch {
-          continue;
-        }
-      }
-      return null;
-    }
+  // xattrs, fallocate and access are forwarded, so they need every member to implement them
+  capabilities(): ProviderCapabilities {
+    const members = this.providers.map((p) => p.capabilities?.());
+    const all = (name: keyof ProviderCapabilities) => members.every((caps) => !caps || caps[name]);
+    return { fallocate: all("fallocate"), xattr: all("xattr"), access: all("access") };
+  }
 
+  // Resolves the name on every member, so each member is later addressed by its own ino
+  async lookup(parent: number, name: string): Promise<FileStat | null> {
     const providerInos = this.getProviderInos(parent);
     if (providerInos.length === 0) return null;
 
-    for (const providerIno of providerInos) {
-      for (const provider of this.providers) {
-        try {
-          const stat = await provider.lookup(providerIno, name);
-          if (stat) {
-            const raidIno = this.nextIno++;
-            const newProviderInos = [stat.ino];
-            this.setProviderInos(raidIno, newProviderInos);
-            return { ...stat, ino: raidIno };
-          }
-        } catch {
-          continue;
+    const inos: number[] = [];
+    let found: FileStat | null = null;
+    for (let i = 0; i < this.providers.length && i < providerInos.length; i++) {
+      if (providerInos[i] === undefined) continue;
+      try {
+        const stat = await this.providers[i].lookup(providerInos[i], name);
+        if (stat) {
+          inos[i] = stat.ino;
+          found ??= stat;
         }
+      } catch {
+        continue;
       }
     }
-    return null;
+    return found && { ...found, ino: this.acquireIno(inos) };
   }
 
   async getattr(ino: number, _fh: number): Promise<FileStat | null> {
@@ -97,16 +121,15 @@ export abstract class BaseRaidProvider implements FilesystemProvider {
     const providerInos = this.getProviderInos(ino);
     if (providerInos.length === 0) return null;
 
-    for (const providerIno of providerInos) {
-      for (const provider of this.providers) {
-        try {
-          const stat = await provider.getattr(providerIno, 0);
-          if (stat) {
-            return { ...stat, ino };
-          }
-        } catch {
-          continue;
+    for (let i = 0; i < this.providers.length && i < providerInos.length; i++) {
+      if (providerInos[i] === undefined) continue;
+      try {
+        const stat = await this.providers[i].getattr(providerInos[i], 0);
+        if (stat) {
+          return { ...stat, ino };
         }
+      } catch {
+        continue;
       }
     }
     return null;
@@ -118,54 +141,70 @@ export abstract class BaseRaidProvider implements FilesystemProvider {
   }
 
   async readdir(ino: number, fh: number, size: number, offset: number): Promise<DirEntry[]> {
-    if (ino === 1) {
-      const entriesMap = new Map<string, DirEntry>();
-      for (const provider of this.providers) {
-        try {
-          const entries = await provider.readdir(1, 0, size, 0);
-          for (const entry of entries) {
-            if (!entriesMap.has(entry.name)) {
-              const raidIno = this.nextIno++;
-              this.setProviderInos(raidIno, [entry.ino]);
-              entriesMap.set(entry.name, { ...entry, ino: raidIno });
-            }
-          }
-        } catch {
-          continue;
-        }
-      }
-      return Array.from(entriesMap.values()).slice(offset);
-    }
+    return this.dirCursors.read(fh, offset, size, () => this.list(ino, fh));
+  }
 
+  // Merges the members' full listings by name, recording each member's ino for the entry.
+  // Members page their replies, so each is read through its own handle until it runs out.
+  private async list(ino: number, fh: number): Promise<DirEntry[]> {
     const providerInos = this.getProviderInos(ino);
     if (providerInos.length === 0) return [];
+    const providerFhs = this.openFiles.get(ino)?.get(fh) ?? [];
 
-    const entriesMap = new Map<string, DirEntry>();
-    for (const providerIno of providerInos) {
-      for (const provider of this.providers) {
-        try {
-          const entries = await provider.readdir(providerIno, 0, size, 0);
+    const entriesMap = new Map<string, { entry: DirEntry; inos: number[] }>();
+    for (let i = 0; i < this.providers.length && i < providerInos.length; i++) {
+      if (providerInos[i] === undefined) continue;
+      try {
+        for (let off = 0; ; ) {
+          const entries = await this.providers[i].readdir(providerInos[i], providerFhs[i] ?? 0, LIST_PAGE, off);
+          if (entries.length === 0) break;
           for (const entry of entries) {
-            if (!entriesMap.has(entry.name)) {
-              const raidIno = this.nextIno++;
-              this.setProviderInos(raidIno, [entry.ino]);
-              entriesMap.set(entry.name, { ...entry, ino: raidIno });
-            }
+            const known = entriesMap.get(entry.name) ?? { entry, inos: [] };
+            known.inos[i] = entry.ino;
+            entriesMap.set(entry.name, known);
           }
-        } catch {
-          continue;
+          off += entries.length;
         }
+      } catch {
+        continue;
       }
     }
-    return Array.from(entriesMap.values()).slice(offset);
+    return Array.from(entriesMap.values(), ({ entry, inos }) => ({ ...entry, ino: this.assignIno(inos) }));
   }
 
+  // Members get their own directory handles, which their listings are paged through
   async opendir(ino: number, flags: number): Promise<number> {
-    return this.open(ino, flags);
+    const providerInos = this.getProviderInos(ino);
+    const providerFhs: number[] = [];
+    await Promise.all(
+      providerInos.map(async (providerIno, i) => {
+        if (providerIno === undefined) return;
+        try {
+          providerFhs[i] = await this.providers[i].opendir(providerIno, flags);
+        } catch {
+          // Listed without a handle
+        }
+      })
+    );
+    const fh = this.nextFh++;
+    if (!this.openFiles.has(ino)) {
+      this.openFiles.set(ino, new Map());
+    }
+    this.openFiles.get(ino)!.set(fh, providerFhs);
+    return fh;
   }
 
   async releasedir(ino: number, fh: number): Promise<void> {
-    return this.release(ino, fh);
+    this.dirCursors.release(fh);
+    const fileHandles = this.openFiles.get(ino);
+    const providerFhs = fileHandles?.get(fh);
+    if (!fileHandles || !providerFhs) return;
+    const providerInos = this.getProviderInos(ino);
+    await Promise.allSettled(providerFhs.map((pfh, i) => (providerInos[i] !== undefined ? this.providers[i].releasedir(providerInos[i], pfh) : undefined)));
+    fileHandles.delete(fh);
+    if (fileHandles.size === 0) {
+      this.openFiles.delete(ino);
+    }
   }
 
   async fsyncdir(ino: number, fh: number, datasync: number): Promise<void> {
@@ -189,14 +228,13 @@ export abstract class BaseRaidProvider implements FilesystemProvider {
 
     for (let i = 0; i < this.providers.length && i < providerInos.length; i++) {
       try {
-        const fh = await this.providers[i].open(providerInos[i], flags, mode);
-        providerFhs.push(fh);
+        providerFhs[i] = await this.providers[i].open(providerInos[i], flags, mode);
       } catch (error) {
         errors.push(error as Error);
       }
     }
 
-    if (providerFhs.length === 0) {
+    if (providerFhs.every((pfh) => pfh === undefined)) {
       throw new Error(`Failed to open: ${errors.map((e) => e.message).join(", ")}`);
     }
 
@@ -283,9 +321,7 @@ export abstract class BaseRaidProvider implements FilesystemProvider {
       throw new Error("Failed to create file on any provider");
     }
 
-    const raidIno = this.nextIno++;
-    const newProviderInos = stats.map((s) => s.ino);
-    this.setProviderInos(raidIno, newProviderInos);
+    const raidIno = this.acquireIno(stats.map((s) => s.ino));
 
     const fh = this.nextFh++;
     if (!this.openFiles.has(raidIno)) {
@@ -314,9 +350,7 @@ export abstract class BaseRaidProvider implements FilesystemProvider {
       throw new Error("Failed to create node on any provider");
     }
 
-    const raidIno = this.nextIno++;
-    const newProviderInos = stats.map((s) => s.ino);
-    this.setProviderInos(raidIno, newProviderInos);
+    const raidIno = this.acquireIno(stats.map((s) => s.ino));
     return { ...stats[0], ino: raidIno };
   }
 
@@ -338,9 +372,7 @@ export abstract class BaseRaidProvider implements FilesystemProvider {
       throw new Error("Failed to create directory on any provider");
     }
 
-    const raidIno = this.nextIno++;
-    const newProviderInos = stats.map((s) => s.ino);
-    this.setProviderInos(raidIno, newProviderInos);
+    const raidIno = this.acquireIno(stats.map((s) => s.ino));
     return { ...stats[0], ino: raidIno };
   }
 
@@ -377,9 +409,7 @@ export abstract class BaseRaidProvider implements FilesystemProvider {
       throw new Error("Failed to link on any provider");
     }
 
-    const raidIno = this.nextIno++;
-    const linkedProviderInos = stats.map((s) => s.ino);
-    this.setProviderInos(raidIno, linkedProviderInos);
+    const raidIno = this.acquireIno(stats.map((s) => s.ino));
     return { ...stats[0], ino: raidIno };
   }
 
@@ -401,9 +431,7 @@ export abstract class BaseRaidProvider implements FilesystemProvider {
       throw new Error("Failed to create symlink on any provider");
     }
 
-    const raidIno = this.nextIno++;
-    const newProviderInos = stats.map((s) => s.ino);
-    this.setProviderInos(raidIno, newProviderInos);
+    const raidIno = this.acquireIno(stats.map((s) => s.ino));
     return { ...stats[0], ino: raidIno };
   }
 
@@ -473,15 +501,17 @@ export abstract class BaseRaidProvider implements FilesystemProvider {
 
   async access(ino: number, mask: number): Promise<void> {
     const providerInos = this.getProviderInos(ino);
+    // Allowed when any member allows it; otherwise the last member's refusal stands
+    let denied: unknown = { code: "EACCES", errno: -13 };
     for (let i = 0; i < this.providers.length && i < providerInos.length; i++) {
       try {
         await this.providers[i].access(providerInos[i], mask);
         return;
-      } catch {
-        continue;
+      } catch (error) {
+        if (typeof (error as { errno?: unknown })?.errno === "number") denied = error;
       }
     }
-    throw new Error("Access denied on all providers");
+    throw denied;
   }
 
   async statfs(ino: number, fh: number): Promise<Statfs> {
@@ -543,8 +573,10 @@ export abstract class BaseRaidProvider implements FilesystemProvider {
     );
   }
 
+  // A member's attributes don't describe the array's file, so entries carry none and
+  // the kernel looks each one up
   async readdirplus(ino: number, fh: number, size: number, offset: number): Promise<DirEntry[]> {
-    return this.readdir(ino, fh, size, offset);
+    return this.dirCursors.read(fh, offset, size, () => this.list(ino, fh), true);
   }
 
   async copy_file_range(_ino_in: number, _fh_in: number, _off_in: number, _ino_out: number, _fh_out: number, _off_out: number, _len: number, _flags: number): Promise<number> {
@@ -558,4 +590,25 @@ export abstract class BaseRaidProvider implements FilesystemProvider {
   async tmpfile(parent: number, _mode: number, _flags: number): Promise<{ stat: FileStat; fh: number }> {
     return this.create(parent, `.tmp.${Date.now()}`, _mode, _flags);
   }
+
+  // Each member gets back at most the lookups it answered for this inode
+  async forget(ino: number, nlookup: number): Promise<void> {
+    const inode = this.inodes.get(ino);
+    if (!inode) return;
+    this.inodes.forget(ino, nlookup);
+    await Promise.allSettled(
+      inode.inos.map((providerIno, i) => {
+        const n = Math.min(nlookup, inode.lookups[i] ?? 0);
+        if (n === 0) return;
+        inode.lookups[i] -= n;
+        return this.providers[i].forget?.(providerIno, n);
+      }),
+    );
+  }
+
+  async forget_multi(forgets: Array<{ ino: number; nlookup: number }>): Promise<void> {
+    for (const forget of forgets) {
+      await this.forget(forget.ino, forget.nlookup);
+    }
+  }
 }
@@ -20,7 +20,7 @@ export class Raid0Provider extends BaseRaidProvider {
   async rmdir(parent: number, name: string): Promise<void> {
     const providerInos = this.getProviderInos(parent);
     if (providerInos.length === 0) throw new Error("Parent not found");
-    return this.providers[0].rmdir(providerInos[0], name);
+    await this.providers[0].rmdir(providerInos[0], name);
   }
 
   async rename(parent: number, name: string, newparent: number, newname: string, flags: number): Promise<void> {
@@ -31,9 +31,7 @@ export class Raid1Provider extends BaseRaidProvider {
       throw new Error("Failed to create file on any provider");
     }
 
-    const raidIno = this.nextIno++;
-    const newProviderInos = stats.map((s) => s.ino);
-    this.setProviderInos(raidIno, newProviderInos);
+    const raidIno = this.acquireIno(stats.map((s) => s.ino));
 
     const fh = this.nextFh++;
     if (!this.openFiles.has(raidIno)) {
@@ -1,4 +1,4 @@
-import { DirEntry, FileStat, FilesystemProvider, Flock, Statfs } from "@mount0/core";
+import { DirEntry, FileStat, FilesystemProvider, Flock, ProviderCapabilities, Statfs } from "@mount0/core";
 
 export interface S3Config {
   bucket: string;
@@ -17,6 +17,10 @@ export class S3Provider implements FilesystemProvider {
     };
   }
 
+  capabilities(): ProviderCapabilities {
+    return {};
+  }
+
   async lookup(_parent: number, _name: string): Promise<FileStat | null> {
     throw new Error("S3Provider not implemented");
   }
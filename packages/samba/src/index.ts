@@ -1,4 +1,4 @@
-import { DirEntry, FileStat, FilesystemProvider, Flock, Statfs } from "@mount0/core";
+import { DirEntry, FileStat, FilesystemProvider, Flock, ProviderCapabilities, Statfs } from "@mount0/core";
 
 export interface SambaConfig {
   host: string;
@@ -14,6 +14,10 @@ export class SambaProvider implements FilesystemProvider {
     this.config = config;
   }
 
+  capabilities(): ProviderCapabilities {
+    return {};
+  }
+
   async lookup(_parent: number, _name: string): Promise<FileStat | null> {
     throw new Error("SambaProvider not implemented");
   }
@@ -1,4 +1,4 @@
-import { DirEntry, FileStat, FilesystemProvider, Flock, Statfs } from "@mount0/core";
+import { DirEntry, FileStat, FilesystemProvider, Flock, ProviderCapabilities, Statfs } from "@mount0/core";
 
 export interface SshConfig {
   host: string;
@@ -18,6 +18,10 @@ export class SshProvider implements FilesystemProvider {
     };
   }
 
+  capabilities(): ProviderCapabilities {
+    return {};
+  }
+
   async lookup(_parent: number, _name: string): Promise<FileStat | null> {
     throw new Error("SshProvider not implemented");
   }
@@ -1,4 +1,4 @@
-import { DirEntry, FileStat, FilesystemProvider, Flock, Statfs } from "@mount0/core";
+import { DirEntry, FileStat, FilesystemProvider, Flock, ProviderCapabilities, Statfs } from "@mount0/core";
 
 export interface WebdavConfig {
   url: string;
@@ -13,6 +13,10 @@ export class WebdavProvider implements FilesystemProvider {
     this.config = config;
   }
 
+  capabilities(): ProviderCapabilities {
+    return {};
+  }
+
   async lookup(_parent: number, _name: string): Promise<FileStat | null> {
     throw new Error("WebdavProvider not implemented");
   }